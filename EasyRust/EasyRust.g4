@@ -14,6 +14,12 @@ statement
     | ifStmt
     | exprStmt
     | returnStmt  // Añadido para reconocer declaraciones de retorno
+    | importStmt
+    ;
+
+// Importa las funciones de otro archivo (ruta relativa al que importa)
+importStmt
+    : 'import' STRING ';'
     ;
 
 // Declaración de variable con tipo
@@ -23,16 +29,21 @@ variableDecl
 
 // Declaración de función con retorno opcional
 functionDecl
-    : 'f' IDENTIFIER '(' parameters? ')' ':' type '{' statement* '}'
+    : attribute* 'f' IDENTIFIER '(' parameters? ')' ':' type '{' statement* '}'
+    ;
+
+// Atributo de función: #[inline], #[inline(always)], #[inline(never)], #[cold]
+attribute
+    : '#' '[' name=IDENTIFIER ('(' arg=IDENTIFIER ')')? ']'
     ;
 
 // Sentencia de retorno
 returnStmt
     : 'return' expr ';'
     ;
-// Asignación de variable
+// Asignación de variable o de un elemento de un arreglo
 assignmentStmt
-    : IDENTIFIER '=' expr ';'
+    : IDENTIFIER ('[' index=expr ']')? '=' value=expr ';'
     ;
 
 // Parámetros de función con tipos
@@ -75,6 +86,9 @@ expr
     : functionCall                       # CallFunction
     | IDENTIFIER                         # Identifier
     | '(' expr ')'                       # Parens
+    | '[' expr ';' expr ']'              # ArrayRepeat
+    | '[' expr (',' expr)* ']'           # ArrayList
+    | expr '[' expr ']'                  # Index
     | expr op=('*'|'/') expr             # MulDiv
     | expr op=('+'|'-') expr             # AddSub
     | NUMBER                             # Number
@@ -109,6 +123,8 @@ type
     | 'bool'
     | 'string'
     | 'void'
+    | '[' type ';' NUMBER ']' // Arreglo de tamaño fijo
+    | '[' type ']'            // Arreglo dinámico
     | IDENTIFIER // Para tipos personalizados
     ;
 ADD   : '+' ;
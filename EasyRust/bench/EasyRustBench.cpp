@@ -0,0 +1,526 @@
+// Banco de pruebas de EasyRust: velocidad de cada fase del compilador (líneas
+// por segundo) y tiempo de ejecución de los binarios generados en cada nivel
+// de optimización, sobre el corpus de bench/corpus y programas sintéticos.
+//
+//   easyrust-bench [--json] [--repeat=<n>] [--functions=<n>] [--depth=<n>] [--no-run] [--pgo] [--partitions]
+//                  [corpus]
+//
+// Cada medición es el mínimo de <n> repeticiones para que la salida sea estable.
+// --pgo compara además cada programa del corpus en -O2 con y sin perfil (PGO).
+// --partitions mide la compilación -O2 del programa de <n> funciones con 1, 2,
+// 4, ... particiones en paralelo (--partitions=<k> del compilador).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "EasyRustBackend.h"
+#include "EasyRustCompiler.h"
+#include "EasyRustOptions.h"
+#include "EasyRustStats.h"
+
+using namespace std;
+
+struct BenchProgram {
+    string name;
+    string source;
+    bool runnable; // Los sintéticos solo miden la compilación
+};
+
+struct BenchRow {
+    string program;
+    string level;
+    uint64_t lines = 0;
+    map<string, double> phaseMs;
+    optional<double> runMs;
+};
+
+// Parseo del mismo programa con LL completo y con SLL + reintento LL
+struct ParseRow {
+    string program;
+    uint64_t lines = 0;
+    double llMs = 0;
+    double twoStageMs = 0;
+    uint64_t fallbacks = 0;
+};
+
+// Ejecución en -O2 sin perfil y con el perfil de una ejecución instrumentada
+struct PGORow {
+    string program;
+    double plainMs = 0;
+    double profiledMs = 0;
+};
+
+// Compilación -O2 del programa sintético de funciones con <partitions> partes en paralelo
+struct PartitionRow {
+    unsigned partitions = 1;
+    unsigned objects = 0;
+    double ms = 0;
+};
+
+static const vector<string> Phases = {"lex", "parse", "ast", "fold", "codegen", "verify", "optimize", "backend"};
+
+// <count> funciones independientes; main llama solo a la última
+static string generateFunctions(unsigned count) {
+    ostringstream out;
+    for (unsigned i = 0; i < count; i++) {
+        out << "f fn" << i << "(a : int, b : int) : int {\n"
+            << "    let r : int = a * " << i % 97 << " + b - " << i % 13 << ";\n"
+            << "    return r;\n"
+            << "}\n";
+    }
+    out << "let x : int = fn" << count - 1 << "(3, 4);\n"
+        << "print(x);\n";
+    return out.str();
+}
+
+// <depth> if anidados (cada rama tiene una sola sentencia)
+static string generateNestedIf(unsigned depth) {
+    ostringstream out;
+    out << "let x : int = " << depth << ";\n";
+    for (unsigned i = 0; i < depth; i++)
+        out << string(i * 4, ' ') << "if (x > " << i << ") {\n";
+    out << string(depth * 4, ' ') << "x = x - 1;\n";
+    for (unsigned i = depth; i-- > 0;)
+        out << string(i * 4, ' ') << "}\n";
+    out << "print(x);\n";
+    return out.str();
+}
+
+// <depth> while anidados que se ejecutan una vez cada uno
+static string generateNestedWhile(unsigned depth) {
+    ostringstream out;
+    for (unsigned i = 0; i < depth; i++)
+        out << "let w" << i << " : int = 0;\n";
+    for (unsigned i = 0; i < depth; i++)
+        out << string(i * 4, ' ') << "while (w" << i << " < 1) {\n";
+    for (unsigned i = depth; i-- > 0;) {
+        out << string((i + 1) * 4, ' ') << "w" << i << " = w" << i << " + 1;\n"
+            << string(i * 4, ' ') << "}\n";
+    }
+    out << "print(w0);\n";
+    return out.str();
+}
+
+static uint64_t countLines(const string &source) {
+    uint64_t lines = count(source.begin(), source.end(), '\n');
+    if (!source.empty() && source.back() != '\n')
+        lines++;
+    return lines;
+}
+
+// Compila <repeat> veces y conserva el mínimo de cada fase
+static bool measureCompile(const BenchProgram &program, const EasyRustOptions &options,
+                           EasyRustBackend &backend, unsigned repeat, map<string, double> &best,
+                           string &error) {
+    for (unsigned r = 0; r < repeat; r++) {
+        EasyRustStats stats(program.name);
+        llvm::SmallVector<char, 0> object;
+        ostringstream log;
+        if (!EasyRustCompiler::compileToObject(program.source, options, backend, "", object, log, error, &stats))
+            return false;
+        for (const auto &[phase, ms] : stats.phaseWallMs()) {
+            auto found = best.find(phase);
+            if (found == best.end() || ms < found->second)
+                best[phase] = ms;
+        }
+    }
+    return true;
+}
+
+// Mínimo de <repeat> parseos (solo lex + parse + codegen) en el modo indicado
+static double measureParse(const BenchProgram &program, EasyRustCompiler::ParseMode mode, unsigned repeat) {
+    double best = numeric_limits<double>::max();
+    for (unsigned r = 0; r < repeat; r++) {
+        EasyRustStats stats(program.name);
+        EasyRustCompiler::generateModule(program.source, EasyRustOptions(), &stats, mode);
+        best = min(best, stats.phaseWallMs()["parse"]);
+    }
+    return best;
+}
+
+// Compila y enlaza <base>.out
+static bool buildExecutable(const BenchProgram &program, const EasyRustOptions &options, EasyRustBackend &backend,
+                            const string &base, string &error) {
+    llvm::SmallVector<char, 0> object;
+    ostringstream log;
+    if (!EasyRustCompiler::compileToObject(program.source, options, backend, "", object, log, error))
+        return false;
+    string objFile = base + ".o";
+    return EasyRustBackend::writeFile(objFile, llvm::StringRef(object.data(), object.size()), error) &&
+           EasyRustBackend::link({objFile}, base + ".out", error, options.profileGenerate);
+}
+
+// Mide la ejecución de un binario (stdout a /dev/null)
+static bool timeExecutable(const BenchProgram &program, const string &execFile, unsigned repeat, double &bestMs,
+                           string &error) {
+    bestMs = numeric_limits<double>::max();
+    optional<llvm::StringRef> redirects[] = {nullopt, llvm::StringRef("/dev/null"), nullopt};
+    for (unsigned r = 0; r < repeat; r++) {
+        auto start = chrono::steady_clock::now();
+        string message;
+        int status = llvm::sys::ExecuteAndWait(execFile, {execFile}, nullopt, redirects, 0, 0, &message);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (status != 0) {
+            error = program.name + " terminó con código " + to_string(status) +
+                    (message.empty() ? "" : ": " + message);
+            return false;
+        }
+        bestMs = min(bestMs, ms);
+    }
+    return true;
+}
+
+// Genera el ejecutable en <dir> y mide su ejecución
+static bool measureRun(const BenchProgram &program, const EasyRustOptions &options, EasyRustBackend &backend,
+                       const string &dir, unsigned repeat, double &bestMs, string &error) {
+    string base = dir + "/" + program.name + "-" + options.optLevelName;
+    return buildExecutable(program, options, backend, base, error) &&
+           timeExecutable(program, base + ".out", repeat, bestMs, error);
+}
+
+// Instrumenta, ejecuta una vez para obtener el perfil, lo combina con
+// llvm-profdata y compara -O2 con y sin el perfil
+static bool measurePGO(const BenchProgram &program, const string &profdata, EasyRustBackend &backend,
+                       const string &dir, unsigned repeat, PGORow &row, string &error) {
+    EasyRustOptions options;
+    options.optLevel = llvm::OptimizationLevel::O2;
+    options.optLevelName = "O2";
+    options.internalLinkage = true;
+    string base = dir + "/" + program.name + "-pgo";
+    if (!measureRun(program, options, backend, dir, repeat, row.plainMs, error))
+        return false;
+
+    double instrumentedMs = 0;
+    options.profileGenerate = true;
+    options.profileOutput = base + ".profraw";
+    if (!buildExecutable(program, options, backend, base + "-gen", error) ||
+        !timeExecutable(program, base + "-gen.out", 1, instrumentedMs, error))
+        return false;
+
+    string merged = base + ".profdata";
+    string message;
+    if (llvm::sys::ExecuteAndWait(profdata, {profdata, "merge", "-o", merged, options.profileOutput}, nullopt, {},
+                                  0, 0, &message) != 0) {
+        error = "llvm-profdata falló" + (message.empty() ? "" : ": " + message);
+        return false;
+    }
+
+    options.profileGenerate = false;
+    options.profileUse = merged;
+    return buildExecutable(program, options, backend, base + "-use", error) &&
+           timeExecutable(program, base + "-use.out", repeat, row.profiledMs, error);
+}
+
+// Compila <repeat> veces (generación, división, optimización y backend) y conserva el mínimo
+static bool measurePartitions(const BenchProgram &program, unsigned partitions, EasyRustBackend &backend,
+                              unsigned repeat, PartitionRow &row, string &error) {
+    EasyRustOptions options;
+    options.optLevel = llvm::OptimizationLevel::O2;
+    options.optLevelName = "O2";
+    options.partitions = partitions; // Funciones externas, como en la tabla de fases: ninguna se descarta
+    row = {partitions, 0, numeric_limits<double>::max()};
+    for (unsigned r = 0; r < repeat; r++) {
+        vector<EasyRustCompiler::ObjectFile> objects;
+        ostringstream log;
+        auto start = chrono::steady_clock::now();
+        if (!EasyRustCompiler::compileToObjects(program.source, options, backend, "", objects, log, error))
+            return false;
+        row.ms = min(row.ms, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        row.objects = objects.size();
+    }
+    return true;
+}
+
+static double linesPerSecond(uint64_t lines, double ms) {
+    return ms > 0 ? lines / (ms / 1000.0) : 0;
+}
+
+static void printTable(const vector<BenchRow> &rows, const vector<ParseRow> &parseRows,
+                       const vector<PGORow> &pgoRows, const vector<PartitionRow> &partitionRows) {
+    cout << left << setw(22) << "programa" << setw(6) << "nivel" << right << setw(8) << "lineas";
+    for (const string &phase : Phases)
+        cout << setw(12) << phase;
+    cout << setw(12) << "ejec. ms" << "\n";
+    cout << string(22 + 6 + 8 + 12 * (Phases.size() + 1), '-') << "\n";
+
+    cout << fixed;
+    for (const BenchRow &row : rows) {
+        cout << left << setw(22) << row.program << setw(6) << row.level << right << setw(8) << row.lines;
+        for (const string &phase : Phases) {
+            auto found = row.phaseMs.find(phase);
+            if (found == row.phaseMs.end())
+                cout << setw(12) << "-";
+            else
+                cout << setw(12) << setprecision(0) << linesPerSecond(row.lines, found->second);
+        }
+        if (row.runMs)
+            cout << setw(12) << setprecision(2) << *row.runMs;
+        else
+            cout << setw(12) << "-";
+        cout << "\n";
+    }
+    cout << "(fases en líneas/s; ejecución: mínimo de las repeticiones)\n\n";
+
+    cout << left << setw(22) << "programa" << right << setw(8) << "lineas" << setw(12) << "LL ms"
+         << setw(12) << "SLL+LL ms" << setw(10) << "mejora" << setw(12) << "reintentos" << "\n";
+    cout << string(22 + 8 + 12 + 12 + 10 + 12, '-') << "\n";
+    for (const ParseRow &row : parseRows) {
+        cout << left << setw(22) << row.program << right << setw(8) << row.lines << setprecision(2)
+             << setw(12) << row.llMs << setw(12) << row.twoStageMs
+             << setw(9) << (row.twoStageMs > 0 ? row.llMs / row.twoStageMs : 0) << "x"
+             << setw(12) << row.fallbacks << "\n";
+    }
+
+    if (!pgoRows.empty()) {
+        cout << "\n" << left << setw(22) << "programa" << right << setw(12) << "O2 ms" << setw(12) << "O2+PGO ms"
+             << setw(10) << "mejora" << "\n";
+        cout << string(22 + 12 + 12 + 10, '-') << "\n";
+        for (const PGORow &row : pgoRows) {
+            cout << left << setw(22) << row.program << right << setprecision(2) << setw(12) << row.plainMs
+                 << setw(12) << row.profiledMs << setw(9)
+                 << (row.profiledMs > 0 ? row.plainMs / row.profiledMs : 0) << "x\n";
+        }
+    }
+
+    if (partitionRows.empty())
+        return;
+    cout << "\n" << right << setw(12) << "particiones" << setw(10) << "objetos" << setw(12) << "O2 ms"
+         << setw(10) << "escala" << "\n";
+    cout << string(12 + 10 + 12 + 10, '-') << "\n";
+    for (const PartitionRow &row : partitionRows) {
+        cout << setw(12) << row.partitions << setw(10) << row.objects << setprecision(2) << setw(12) << row.ms
+             << setw(9) << (row.ms > 0 ? partitionRows.front().ms / row.ms : 0) << "x\n";
+    }
+}
+
+static void printJSON(const vector<BenchRow> &rows, const vector<ParseRow> &parseRows,
+                      const vector<PGORow> &pgoRows, const vector<PartitionRow> &partitionRows) {
+    llvm::json::Array results;
+    for (const BenchRow &row : rows) {
+        llvm::json::Object phases;
+        for (const auto &[phase, ms] : row.phaseMs)
+            phases[phase] = llvm::json::Object{{"ms", ms}, {"lines_per_sec", linesPerSecond(row.lines, ms)}};
+        llvm::json::Object result{
+            {"program", row.program},
+            {"level", row.level},
+            {"lines", static_cast<int64_t>(row.lines)},
+            {"phases", std::move(phases)}};
+        if (row.runMs)
+            result["run_ms"] = *row.runMs;
+        results.push_back(std::move(result));
+    }
+    llvm::json::Array parse;
+    for (const ParseRow &row : parseRows)
+        parse.push_back(llvm::json::Object{
+            {"program", row.program},
+            {"lines", static_cast<int64_t>(row.lines)},
+            {"ll_ms", row.llMs},
+            {"two_stage_ms", row.twoStageMs},
+            {"ll_fallbacks", static_cast<int64_t>(row.fallbacks)}});
+    llvm::json::Array pgo;
+    for (const PGORow &row : pgoRows)
+        pgo.push_back(llvm::json::Object{
+            {"program", row.program},
+            {"o2_ms", row.plainMs},
+            {"o2_pgo_ms", row.profiledMs}});
+    llvm::json::Array partitions;
+    for (const PartitionRow &row : partitionRows)
+        partitions.push_back(llvm::json::Object{
+            {"partitions", static_cast<int64_t>(row.partitions)},
+            {"objects", static_cast<int64_t>(row.objects)},
+            {"o2_ms", row.ms}});
+    llvm::json::Value report = llvm::json::Object{{"results", std::move(results)},
+                                                  {"parse", std::move(parse)},
+                                                  {"pgo", std::move(pgo)},
+                                                  {"partitions", std::move(partitions)}};
+    llvm::outs() << llvm::formatv("{0:2}", report) << "\n";
+}
+
+static unsigned parseCount(const string &arg, const string &prefix) {
+    try {
+        return stoul(arg.substr(prefix.size()));
+    } catch (const exception &) {
+        cerr << "Error: Valor no válido en " << arg << endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    bool json = false;
+    bool run = true;
+    bool pgo = false;
+    bool partitionScaling = false;
+    unsigned repeat = 3;
+    unsigned functions = 10000;
+    unsigned depth = 200;
+    string corpusDir = "bench/corpus";
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--json")
+            json = true;
+        else if (arg == "--no-run")
+            run = false;
+        else if (arg == "--pgo")
+            pgo = true;
+        else if (arg == "--partitions")
+            partitionScaling = true;
+        else if (arg.rfind("--repeat=", 0) == 0)
+            repeat = max(1u, parseCount(arg, "--repeat="));
+        else if (arg.rfind("--functions=", 0) == 0)
+            functions = max(1u, parseCount(arg, "--functions="));
+        else if (arg.rfind("--depth=", 0) == 0)
+            depth = max(1u, parseCount(arg, "--depth="));
+        else if (!arg.empty() && arg[0] == '-') {
+            cerr << "Uso: " << argv[0]
+                 << " [--json] [--repeat=<n>] [--functions=<n>] [--depth=<n>] [--no-run] [--pgo] [--partitions]"
+                 << " [corpus]"
+                 << endl;
+            return EXIT_FAILURE;
+        } else
+            corpusDir = arg;
+    }
+
+    // Corpus (en orden alfabético) y programas sintéticos
+    vector<BenchProgram> programs;
+    vector<string> files;
+    string error;
+    if (!EasyRustCompiler::expandInputs({corpusDir}, files, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+    for (const string &file : files) {
+        BenchProgram program{filesystem::path(file).stem().string(), "", true};
+        if (!EasyRustCompiler::readSource(file, program.source)) {
+            cerr << "Error: No se pudo abrir el archivo " << file << endl;
+            return EXIT_FAILURE;
+        }
+        programs.push_back(std::move(program));
+    }
+    size_t functionsProgram = programs.size();
+    programs.push_back({"gen-funciones-" + to_string(functions), generateFunctions(functions), false});
+    programs.push_back({"gen-if-" + to_string(depth), generateNestedIf(depth), false});
+    programs.push_back({"gen-while-" + to_string(depth), generateNestedWhile(depth), false});
+
+    llvm::SmallString<128> tempDir;
+    if (run && llvm::sys::fs::createUniqueDirectory("easyrust-bench", tempDir)) {
+        cerr << "Error: No se pudo crear el directorio temporal" << endl;
+        return EXIT_FAILURE;
+    }
+
+    EasyRustBackend::initializeTargets();
+    vector<BenchRow> rows;
+    int failures = 0;
+    for (const char *level : {"O0", "O1", "O2", "O3"}) {
+        EasyRustOptions options;
+        EasyRustOptions::parseOptLevel(string("-") + level, options.optLevel);
+        options.optLevelName = level;
+        EasyRustBackend backend;
+        if (!backend.init(options.optLevel, error)) {
+            cerr << "Error: " << error << endl;
+            return EXIT_FAILURE;
+        }
+
+        for (const BenchProgram &program : programs) {
+            BenchRow row{program.name, level, countLines(program.source), {}, nullopt};
+            if (!measureCompile(program, options, backend, repeat, row.phaseMs, error)) {
+                cerr << "Error: " << program.name << " (-" << level << "): " << error << endl;
+                failures++;
+                continue;
+            }
+            double runMs = 0;
+            if (run && program.runnable) {
+                if (measureRun(program, options, backend, tempDir.str().str(), repeat, runMs, error))
+                    row.runMs = runMs;
+                else {
+                    cerr << "Error: " << program.name << " (-" << level << "): " << error << endl;
+                    failures++;
+                }
+            }
+            rows.push_back(std::move(row));
+        }
+    }
+
+    // Con y sin perfil (PGO), solo para los programas que se ejecutan
+    vector<PGORow> pgoRows;
+    if (run && pgo) {
+        auto profdata = llvm::sys::findProgramByName("llvm-profdata");
+        EasyRustBackend backend;
+        if (!profdata) {
+            cerr << "Error: --pgo necesita llvm-profdata en el PATH" << endl;
+            failures++;
+        } else if (!backend.init(llvm::OptimizationLevel::O2, error)) {
+            cerr << "Error: " << error << endl;
+            return EXIT_FAILURE;
+        } else {
+            for (const BenchProgram &program : programs) {
+                if (!program.runnable)
+                    continue;
+                PGORow row{program.name};
+                if (measurePGO(program, *profdata, backend, tempDir.str().str(), repeat, row, error))
+                    pgoRows.push_back(row);
+                else {
+                    cerr << "Error: " << program.name << " (PGO): " << error << endl;
+                    failures++;
+                }
+            }
+        }
+    }
+    if (run)
+        llvm::sys::fs::remove_directories(tempDir);
+
+    // Escalado con el número de particiones (potencias de dos hasta los núcleos, al menos 8)
+    vector<PartitionRow> partitionRows;
+    if (partitionScaling) {
+        EasyRustBackend backend;
+        if (!backend.init(llvm::OptimizationLevel::O2, error)) {
+            cerr << "Error: " << error << endl;
+            return EXIT_FAILURE;
+        }
+        unsigned maxPartitions = max(8u, thread::hardware_concurrency());
+        for (unsigned partitions = 1; partitions <= maxPartitions; partitions *= 2) {
+            PartitionRow row;
+            if (measurePartitions(programs[functionsProgram], partitions, backend, repeat, row, error))
+                partitionRows.push_back(row);
+            else {
+                cerr << "Error: " << programs[functionsProgram].name << " (" << partitions
+                     << " particiones): " << error << endl;
+                failures++;
+            }
+        }
+    }
+
+    // Parseo en dos etapas frente a LL completo
+    vector<ParseRow> parseRows;
+    for (const BenchProgram &program : programs) {
+        ParseRow row{program.name, countLines(program.source)};
+        row.llMs = measureParse(program, EasyRustCompiler::ParseMode::LL, repeat);
+        uint64_t before = EasyRustCompiler::parseCounters().llFallback;
+        row.twoStageMs = measureParse(program, EasyRustCompiler::ParseMode::TwoStage, repeat);
+        row.fallbacks = EasyRustCompiler::parseCounters().llFallback - before;
+        parseRows.push_back(row);
+    }
+
+    if (json)
+        printJSON(rows, parseRows, pgoRows, partitionRows);
+    else
+        printTable(rows, parseRows, pgoRows, partitionRows);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
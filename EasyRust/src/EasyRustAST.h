@@ -0,0 +1,487 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Casting.h"
+
+// AST tipado de EasyRust. Lo construye EasyRustASTBuilder en una pasada sobre
+// el árbol de parseo de ANTLR (que se libera después) y lo recorre
+// EasyRustDriver para generar el IR.
+//
+// Todos los nodos, listas y cadenas viven en el arena de EasyRustAST::Context:
+// son trivialmente destructibles y se liberan juntos al destruir el contexto.
+namespace EasyRustAST
+{
+    struct Location
+    {
+        unsigned line = 0;
+        unsigned column = 0;
+    };
+
+    // Identificador internado: índice denso en la tabla de nombres del Context.
+    // Dos símbolos son el mismo nombre si y solo si tienen el mismo id.
+    struct Symbol
+    {
+        unsigned id = ~0u;
+
+        bool operator==(Symbol other) const { return id == other.id; }
+        bool operator!=(Symbol other) const { return id != other.id; }
+    };
+
+    // Tipos del lenguaje; Unknown para nombres de tipo no soportados
+    enum class TypeKind
+    {
+        Int,
+        Float,
+        Bool,
+        String,
+        Void,
+        Array,
+        Unknown
+    };
+
+    inline TypeKind typeKindFromName(llvm::StringRef name)
+    {
+        if (name == "int")
+            return TypeKind::Int;
+        if (name == "float")
+            return TypeKind::Float;
+        if (name == "bool")
+            return TypeKind::Bool;
+        if (name == "string")
+            return TypeKind::String;
+        if (name == "void")
+            return TypeKind::Void;
+        return TypeKind::Unknown;
+    }
+
+    inline const char *typeKindName(TypeKind kind)
+    {
+        switch (kind)
+        {
+        case TypeKind::Int:
+            return "int";
+        case TypeKind::Float:
+            return "float";
+        case TypeKind::Bool:
+            return "bool";
+        case TypeKind::String:
+            return "string";
+        case TypeKind::Void:
+            return "void";
+        case TypeKind::Array:
+            return "array";
+        case TypeKind::Unknown:
+            break;
+        }
+        return "?";
+    }
+
+    // Tipo escrito en el código: el nombre original se conserva para los mensajes de error.
+    // Arreglos: `[elemento; N]` (tamaño fijo) o `[elemento]` (dinámico, arrayLength = -1).
+    struct TypeSpec
+    {
+        TypeKind kind = TypeKind::Unknown;
+        llvm::StringRef spelling;
+        TypeKind element = TypeKind::Unknown;
+        int64_t arrayLength = -1;
+
+        bool isFixedArray() const { return kind == TypeKind::Array && arrayLength >= 0; }
+    };
+
+    // ---------------------------------------------------------------- Expresiones
+
+    enum class ExprKind
+    {
+        Call,
+        Identifier,
+        Binary,
+        Number,
+        Boolean,
+        String,
+        Index,
+        ArrayRepeat,
+        ArrayList
+    };
+
+    struct Expr
+    {
+        ExprKind kind;
+        Location loc;
+
+        Expr(ExprKind kind, Location loc) : kind(kind), loc(loc) {}
+    };
+
+    struct CallExpr : Expr
+    {
+        Symbol callee;
+        llvm::ArrayRef<Expr *> args;
+
+        CallExpr(Location loc, Symbol callee, llvm::ArrayRef<Expr *> args)
+            : Expr(ExprKind::Call, loc), callee(callee), args(args) {}
+        static bool classof(const Expr *e) { return e->kind == ExprKind::Call; }
+    };
+
+    struct IdentifierExpr : Expr
+    {
+        Symbol name;
+
+        IdentifierExpr(Location loc, Symbol name)
+            : Expr(ExprKind::Identifier, loc), name(name) {}
+        static bool classof(const Expr *e) { return e->kind == ExprKind::Identifier; }
+    };
+
+    // '+', '-', '*' o '/'
+    struct BinaryExpr : Expr
+    {
+        char op;
+        Expr *lhs;
+        Expr *rhs;
+
+        BinaryExpr(Location loc, char op, Expr *lhs, Expr *rhs)
+            : Expr(ExprKind::Binary, loc), op(op), lhs(lhs), rhs(rhs) {}
+        static bool classof(const Expr *e) { return e->kind == ExprKind::Binary; }
+    };
+
+    // Literal numérico: con punto decimal es float, si no int
+    struct NumberExpr : Expr
+    {
+        bool isFloat;
+        int64_t intValue;
+        double floatValue;
+        llvm::StringRef text;
+
+        NumberExpr(Location loc, llvm::StringRef text, bool isFloat, int64_t intValue, double floatValue)
+            : Expr(ExprKind::Number, loc), isFloat(isFloat), intValue(intValue), floatValue(floatValue), text(text) {}
+        static bool classof(const Expr *e) { return e->kind == ExprKind::Number; }
+    };
+
+    struct BooleanExpr : Expr
+    {
+        bool value;
+
+        BooleanExpr(Location loc, bool value) : Expr(ExprKind::Boolean, loc), value(value) {}
+        static bool classof(const Expr *e) { return e->kind == ExprKind::Boolean; }
+    };
+
+    // Literal de cadena, ya sin comillas
+    struct StringExpr : Expr
+    {
+        llvm::StringRef value;
+
+        StringExpr(Location loc, llvm::StringRef value) : Expr(ExprKind::String, loc), value(value) {}
+        static bool classof(const Expr *e) { return e->kind == ExprKind::String; }
+    };
+
+    // base[index]
+    struct IndexExpr : Expr
+    {
+        Expr *base;
+        Expr *index;
+
+        IndexExpr(Location loc, Expr *base, Expr *index)
+            : Expr(ExprKind::Index, loc), base(base), index(index) {}
+        static bool classof(const Expr *e) { return e->kind == ExprKind::Index; }
+    };
+
+    // [value; count]
+    struct ArrayRepeatExpr : Expr
+    {
+        Expr *value;
+        Expr *count;
+
+        ArrayRepeatExpr(Location loc, Expr *value, Expr *count)
+            : Expr(ExprKind::ArrayRepeat, loc), value(value), count(count) {}
+        static bool classof(const Expr *e) { return e->kind == ExprKind::ArrayRepeat; }
+    };
+
+    // [a, b, c]
+    struct ArrayListExpr : Expr
+    {
+        llvm::ArrayRef<Expr *> elements;
+
+        ArrayListExpr(Location loc, llvm::ArrayRef<Expr *> elements)
+            : Expr(ExprKind::ArrayList, loc), elements(elements) {}
+        static bool classof(const Expr *e) { return e->kind == ExprKind::ArrayList; }
+    };
+
+    // Condición de if/while/for: '(' lhs op rhs ')'
+    struct Condition
+    {
+        Location loc;
+        llvm::StringRef op;
+        Expr *lhs;
+        Expr *rhs;
+    };
+
+    // ---------------------------------------------------------------- Sentencias
+
+    enum class StmtKind
+    {
+        VarDecl,
+        Assign,
+        IndexAssign,
+        Function,
+        Print,
+        For,
+        While,
+        If,
+        Expr,
+        Return,
+        Block,
+        Import
+    };
+
+    struct Stmt
+    {
+        StmtKind kind;
+        Location loc;
+
+        Stmt(StmtKind kind, Location loc) : kind(kind), loc(loc) {}
+    };
+
+    struct VarDeclStmt : Stmt
+    {
+        Symbol name;
+        TypeSpec type;
+        Expr *init;
+
+        VarDeclStmt(Location loc, Symbol name, TypeSpec type, Expr *init)
+            : Stmt(StmtKind::VarDecl, loc), name(name), type(type), init(init) {}
+        static bool classof(const Stmt *s) { return s->kind == StmtKind::VarDecl; }
+    };
+
+    struct AssignStmt : Stmt
+    {
+        Symbol name;
+        Expr *value;
+
+        AssignStmt(Location loc, Symbol name, Expr *value)
+            : Stmt(StmtKind::Assign, loc), name(name), value(value) {}
+        static bool classof(const Stmt *s) { return s->kind == StmtKind::Assign; }
+    };
+
+    // array[index] = value
+    struct IndexAssignStmt : Stmt
+    {
+        Symbol array;
+        Expr *index;
+        Expr *value;
+
+        IndexAssignStmt(Location loc, Symbol array, Expr *index, Expr *value)
+            : Stmt(StmtKind::IndexAssign, loc), array(array), index(index), value(value) {}
+        static bool classof(const Stmt *s) { return s->kind == StmtKind::IndexAssign; }
+    };
+
+    struct Param
+    {
+        Symbol name;
+        TypeSpec type;
+    };
+
+    // Atributos escritos antes de `f`
+    enum FunctionAttribute : unsigned
+    {
+        AttrInline = 1,       // #[inline]: sugerencia al inliner
+        AttrAlwaysInline = 2, // #[inline(always)]
+        AttrNoInline = 4,     // #[inline(never)]
+        AttrCold = 8          // #[cold]: se llama poco, se optimiza por tamaño
+    };
+
+    struct FunctionDecl : Stmt
+    {
+        Symbol name;
+        TypeSpec returnType;
+        llvm::ArrayRef<Param> params;
+        llvm::ArrayRef<Stmt *> body;
+
+        unsigned attributes; // FunctionAttribute, combinados con |
+
+        // Texto de la declaración en el fuente, en caracteres (puntos de
+        // código) [sourceBegin, sourceEnd); lo usa --incremental
+        unsigned sourceBegin = 0;
+        unsigned sourceEnd = 0;
+
+        FunctionDecl(Location loc, Symbol name, TypeSpec returnType,
+                     llvm::ArrayRef<Param> params, llvm::ArrayRef<Stmt *> body, unsigned attributes = 0)
+            : Stmt(StmtKind::Function, loc), name(name), returnType(returnType), params(params), body(body),
+              attributes(attributes) {}
+        static bool classof(const Stmt *s) { return s->kind == StmtKind::Function; }
+    };
+
+    struct PrintStmt : Stmt
+    {
+        Expr *value;
+
+        PrintStmt(Location loc, Expr *value) : Stmt(StmtKind::Print, loc), value(value) {}
+        static bool classof(const Stmt *s) { return s->kind == StmtKind::Print; }
+    };
+
+    // for var = init; cond; stepVar++ { body }
+    struct ForStmt : Stmt
+    {
+        Symbol var;
+        Expr *init;
+        Condition *cond;
+        Symbol stepVar;
+        llvm::ArrayRef<Stmt *> body;
+
+        ForStmt(Location loc, Symbol var, Expr *init, Condition *cond, Symbol stepVar,
+                llvm::ArrayRef<Stmt *> body)
+            : Stmt(StmtKind::For, loc), var(var), init(init), cond(cond), stepVar(stepVar), body(body) {}
+        static bool classof(const Stmt *s) { return s->kind == StmtKind::For; }
+    };
+
+    struct WhileStmt : Stmt
+    {
+        Condition *cond;
+        llvm::ArrayRef<Stmt *> body;
+
+        WhileStmt(Location loc, Condition *cond, llvm::ArrayRef<Stmt *> body)
+            : Stmt(StmtKind::While, loc), cond(cond), body(body) {}
+        static bool classof(const Stmt *s) { return s->kind == StmtKind::While; }
+    };
+
+    struct IfStmt : Stmt
+    {
+        Condition *cond;
+        llvm::ArrayRef<Stmt *> thenBody;
+        llvm::ArrayRef<Stmt *> elseBody;
+        bool hasElse;
+
+        IfStmt(Location loc, Condition *cond, llvm::ArrayRef<Stmt *> thenBody, llvm::ArrayRef<Stmt *> elseBody,
+               bool hasElse)
+            : Stmt(StmtKind::If, loc), cond(cond), thenBody(thenBody), elseBody(elseBody), hasElse(hasElse) {}
+        static bool classof(const Stmt *s) { return s->kind == StmtKind::If; }
+    };
+
+    struct ExprStmt : Stmt
+    {
+        Expr *expr;
+
+        ExprStmt(Location loc, Expr *expr) : Stmt(StmtKind::Expr, loc), expr(expr) {}
+        static bool classof(const Stmt *s) { return s->kind == StmtKind::Expr; }
+    };
+
+    struct ReturnStmt : Stmt
+    {
+        Expr *value;
+
+        ReturnStmt(Location loc, Expr *value) : Stmt(StmtKind::Return, loc), value(value) {}
+        static bool classof(const Stmt *s) { return s->kind == StmtKind::Return; }
+    };
+
+    // Bloque con su propio ámbito (lo que queda de un if con condición constante)
+    struct BlockStmt : Stmt
+    {
+        llvm::ArrayRef<Stmt *> body;
+
+        BlockStmt(Location loc, llvm::ArrayRef<Stmt *> body) : Stmt(StmtKind::Block, loc), body(body) {}
+        static bool classof(const Stmt *s) { return s->kind == StmtKind::Block; }
+    };
+
+    // import "ruta.hrust"; (solo en el nivel superior)
+    struct ImportStmt : Stmt
+    {
+        llvm::StringRef path;
+
+        ImportStmt(Location loc, llvm::StringRef path) : Stmt(StmtKind::Import, loc), path(path) {}
+        static bool classof(const Stmt *s) { return s->kind == StmtKind::Import; }
+    };
+
+    // ---------------------------------------------------------------- Arena
+
+    // Dueño de todos los nodos de un programa y de la tabla de identificadores
+    class Context
+    {
+    private:
+        llvm::BumpPtrAllocator arena;
+        llvm::ArrayRef<Stmt *> program;
+        uint64_t nodeCount = 0;
+        llvm::StringMap<unsigned> symbolIds;
+        std::vector<llvm::StringRef> symbolNames; // Apuntan a las claves de symbolIds
+
+    public:
+        Context() = default;
+        Context(const Context &) = delete;
+        Context &operator=(const Context &) = delete;
+
+        template <typename T, typename... Args>
+        T *create(Args &&...args)
+        {
+            static_assert(std::is_trivially_destructible_v<T>, "Los nodos del AST no se destruyen");
+            nodeCount++;
+            return new (arena.Allocate<T>()) T(std::forward<Args>(args)...);
+        }
+
+        llvm::StringRef copyString(llvm::StringRef text)
+        {
+            if (text.empty())
+                return {};
+            char *data = arena.Allocate<char>(text.size());
+            std::copy(text.begin(), text.end(), data);
+            return llvm::StringRef(data, text.size());
+        }
+
+        template <typename T>
+        llvm::ArrayRef<T> copyArray(const std::vector<T> &items)
+        {
+            if (items.empty())
+                return {};
+            T *data = arena.Allocate<T>(items.size());
+            std::uninitialized_copy(items.begin(), items.end(), data);
+            return llvm::ArrayRef<T>(data, items.size());
+        }
+
+        // Cada nombre se hashea una sola vez, al construir el AST
+        Symbol intern(llvm::StringRef name)
+        {
+            auto inserted = symbolIds.try_emplace(name, static_cast<unsigned>(symbolNames.size()));
+            if (inserted.second)
+                symbolNames.push_back(inserted.first->getKey());
+            return Symbol{inserted.first->second};
+        }
+
+        llvm::StringRef name(Symbol symbol) const
+        {
+            return symbolNames[symbol.id];
+        }
+
+        unsigned getSymbolCount() const
+        {
+            return static_cast<unsigned>(symbolNames.size());
+        }
+
+        void setProgram(llvm::ArrayRef<Stmt *> statements)
+        {
+            program = statements;
+        }
+
+        llvm::ArrayRef<Stmt *> getProgram() const
+        {
+            return program;
+        }
+
+        uint64_t getNodeCount() const
+        {
+            return nodeCount;
+        }
+
+        // Bytes reservados por el arena
+        size_t getMemoryUsage() const
+        {
+            return arena.getTotalMemory();
+        }
+    };
+}
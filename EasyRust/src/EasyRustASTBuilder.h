@@ -0,0 +1,320 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "antlr4-runtime.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include "EasyRustParser.h"
+
+#include "EasyRustAST.h"
+#include "EasyRustDiagnostics.h"
+#include "EasyRustTrace.h"
+
+// Construye el AST tipado en una sola pasada sobre el árbol de parseo. Las
+// construcciones incompletas (el parser se recupera de errores de sintaxis)
+// se descartan para que la generación de código no vea nodos a medias.
+class EasyRustASTBuilder
+{
+private:
+    EasyRustAST::Context &ast;
+    unsigned errorCount = 0;
+
+    static EasyRustAST::Location locationOf(antlr4::ParserRuleContext *ctx)
+    {
+        antlr4::Token *token = ctx->getStart();
+        return {static_cast<unsigned>(token->getLine()), static_cast<unsigned>(token->getCharPositionInLine())};
+    }
+
+    EasyRustAST::Symbol symbol(antlr4::tree::TerminalNode *node)
+    {
+        return ast.intern(node->getText());
+    }
+
+    EasyRustAST::TypeSpec typeSpec(EasyRustParser::TypeContext *ctx)
+    {
+        std::string spelling = ctx->getText();
+        EasyRustAST::TypeSpec spec{EasyRustAST::typeKindFromName(spelling), ast.copyString(spelling)};
+        if (EasyRustParser::TypeContext *element = ctx->type())
+        {
+            // Arreglo; no hay arreglos de arreglos ni de void
+            spec.kind = EasyRustAST::TypeKind::Array;
+            spec.element = element->type() ? EasyRustAST::TypeKind::Unknown
+                                           : EasyRustAST::typeKindFromName(element->getText());
+            if (spec.element == EasyRustAST::TypeKind::Void)
+                spec.element = EasyRustAST::TypeKind::Unknown;
+            // Un tamaño que no cabe en int64 es un error, no una excepción
+            if (ctx->NUMBER() && llvm::StringRef(ctx->NUMBER()->getText()).getAsInteger(10, spec.arrayLength))
+            {
+                EasyRustAST::Location loc = locationOf(ctx);
+                EasyRustDiagnostics::stream() << "Error: línea " << loc.line << ":" << loc.column
+                                              << " tamaño de arreglo fuera de rango: " << ctx->getText() << "\n";
+                errorCount++;
+                spec.arrayLength = -1;
+                spec.element = EasyRustAST::TypeKind::Unknown;
+            }
+        }
+        return spec;
+    }
+
+    std::vector<EasyRustAST::Stmt *> buildStatements(const std::vector<EasyRustParser::StatementContext *> &statements)
+    {
+        std::vector<EasyRustAST::Stmt *> result;
+        result.reserve(statements.size());
+        for (EasyRustParser::StatementContext *stmt : statements)
+            if (EasyRustAST::Stmt *node = buildStatement(stmt))
+                result.push_back(node);
+        return result;
+    }
+
+    EasyRustAST::Condition *buildCondition(EasyRustParser::ConditionContext *ctx)
+    {
+        if (!ctx || !ctx->comparisonOp())
+            return nullptr;
+        EasyRustAST::Expr *lhs = buildExpr(ctx->expr(0));
+        EasyRustAST::Expr *rhs = buildExpr(ctx->expr(1));
+        if (!lhs || !rhs)
+            return nullptr;
+        return ast.create<EasyRustAST::Condition>(
+            EasyRustAST::Condition{locationOf(ctx), ast.copyString(ctx->comparisonOp()->getText()), lhs, rhs});
+    }
+
+    EasyRustAST::Stmt *buildFunction(EasyRustParser::FunctionDeclContext *ctx)
+    {
+        if (!ctx->IDENTIFIER() || !ctx->type())
+            return nullptr;
+        std::vector<EasyRustAST::Param> params;
+        if (ctx->parameters())
+        {
+            for (EasyRustParser::ParameterContext *param : ctx->parameters()->parameter())
+            {
+                if (!param->IDENTIFIER() || !param->type())
+                    return nullptr;
+                params.push_back({symbol(param->IDENTIFIER()), typeSpec(param->type())});
+            }
+        }
+        unsigned attributes = 0;
+        for (EasyRustParser::AttributeContext *attribute : ctx->attribute())
+            attributes |= functionAttribute(attribute);
+        auto *function = ast.create<EasyRustAST::FunctionDecl>(
+            locationOf(ctx), symbol(ctx->IDENTIFIER()), typeSpec(ctx->type()), ast.copyArray(params),
+            ast.copyArray(buildStatements(ctx->statement())), attributes);
+        function->sourceBegin = static_cast<unsigned>(ctx->getStart()->getStartIndex());
+        if (ctx->getStop())
+            function->sourceEnd = static_cast<unsigned>(ctx->getStop()->getStopIndex() + 1);
+        return function;
+    }
+
+    // Los atributos desconocidos se ignoran con una advertencia
+    static unsigned functionAttribute(EasyRustParser::AttributeContext *ctx)
+    {
+        std::string name = ctx->name ? ctx->name->getText() : "";
+        std::string arg = ctx->arg ? ctx->arg->getText() : "";
+        if (name == "inline" && arg.empty())
+            return EasyRustAST::AttrInline;
+        if (name == "inline" && arg == "always")
+            return EasyRustAST::AttrAlwaysInline;
+        if (name == "inline" && arg == "never")
+            return EasyRustAST::AttrNoInline;
+        if (name == "cold" && arg.empty())
+            return EasyRustAST::AttrCold;
+        EasyRustDiagnostics::stream() << "Advertencia: atributo desconocido " << ctx->getText() << " en la línea "
+                                      << ctx->getStart()->getLine() << "\n";
+        return 0;
+    }
+
+    EasyRustAST::Stmt *buildIf(EasyRustParser::IfStmtContext *ctx)
+    {
+        EasyRustAST::Condition *cond = buildCondition(ctx->condition());
+        if (!cond)
+            return nullptr;
+
+        // Las sentencias de ambas ramas llegan en una sola lista: se separan
+        // por la posición del token 'else'
+        std::vector<EasyRustParser::StatementContext *> thenStmts, elseStmts;
+        bool hasElse = false;
+        for (antlr4::tree::ParseTree *child : ctx->children)
+        {
+            if (auto *terminal = dynamic_cast<antlr4::tree::TerminalNode *>(child))
+            {
+                if (terminal->getText() == "else")
+                    hasElse = true;
+            }
+            else if (auto *stmt = dynamic_cast<EasyRustParser::StatementContext *>(child))
+            {
+                (hasElse ? elseStmts : thenStmts).push_back(stmt);
+            }
+        }
+        return ast.create<EasyRustAST::IfStmt>(locationOf(ctx), cond, ast.copyArray(buildStatements(thenStmts)),
+                                               ast.copyArray(buildStatements(elseStmts)), hasElse);
+    }
+
+    EasyRustAST::Stmt *buildStatement(EasyRustParser::StatementContext *ctx)
+    {
+        EasyRustAST::Location loc = locationOf(ctx);
+        if (auto *decl = ctx->variableDecl())
+        {
+            EasyRustAST::Expr *init = buildExpr(decl->expr());
+            if (!decl->IDENTIFIER() || !decl->type() || !init)
+                return nullptr;
+            return ast.create<EasyRustAST::VarDeclStmt>(loc, symbol(decl->IDENTIFIER()), typeSpec(decl->type()), init);
+        }
+        if (auto *assign = ctx->assignmentStmt())
+        {
+            EasyRustAST::Expr *value = buildExpr(assign->value);
+            if (!assign->IDENTIFIER() || !value)
+                return nullptr;
+            if (assign->index)
+            {
+                EasyRustAST::Expr *index = buildExpr(assign->index);
+                return index ? ast.create<EasyRustAST::IndexAssignStmt>(loc, symbol(assign->IDENTIFIER()), index, value)
+                             : nullptr;
+            }
+            return ast.create<EasyRustAST::AssignStmt>(loc, symbol(assign->IDENTIFIER()), value);
+        }
+        if (auto *function = ctx->functionDecl())
+            return buildFunction(function);
+        if (auto *print = ctx->printStmt())
+        {
+            EasyRustAST::Expr *value = buildExpr(print->expr());
+            return value ? ast.create<EasyRustAST::PrintStmt>(loc, value) : nullptr;
+        }
+        if (auto *loop = ctx->forLoop())
+        {
+            EasyRustAST::Expr *init = buildExpr(loop->expr());
+            EasyRustAST::Condition *cond = buildCondition(loop->condition());
+            if (loop->IDENTIFIER().size() != 2 || !init || !cond)
+                return nullptr;
+            return ast.create<EasyRustAST::ForStmt>(loc, symbol(loop->IDENTIFIER(0)), init, cond,
+                                                    symbol(loop->IDENTIFIER(1)),
+                                                    ast.copyArray(buildStatements(loop->statement())));
+        }
+        if (auto *loop = ctx->whileLoop())
+        {
+            EasyRustAST::Condition *cond = buildCondition(loop->condition());
+            if (!cond)
+                return nullptr;
+            return ast.create<EasyRustAST::WhileStmt>(loc, cond, ast.copyArray(buildStatements(loop->statement())));
+        }
+        if (auto *ifStmt = ctx->ifStmt())
+            return buildIf(ifStmt);
+        if (auto *exprStmt = ctx->exprStmt())
+        {
+            EasyRustAST::Expr *expr = buildExpr(exprStmt->expr());
+            return expr ? ast.create<EasyRustAST::ExprStmt>(loc, expr) : nullptr;
+        }
+        if (auto *ret = ctx->returnStmt())
+        {
+            EasyRustAST::Expr *value = buildExpr(ret->expr());
+            return value ? ast.create<EasyRustAST::ReturnStmt>(loc, value) : nullptr;
+        }
+        if (auto *importStmt = ctx->importStmt())
+        {
+            if (!importStmt->STRING())
+                return nullptr;
+            std::string path = importStmt->STRING()->getText();
+            return ast.create<EasyRustAST::ImportStmt>(loc, ast.copyString(path.substr(1, path.size() - 2)));
+        }
+        return nullptr;
+    }
+
+    EasyRustAST::Expr *buildExpr(EasyRustParser::ExprContext *ctx)
+    {
+        if (!ctx)
+            return nullptr;
+        EasyRustAST::Location loc = locationOf(ctx);
+
+        if (auto *call = dynamic_cast<EasyRustParser::CallFunctionContext *>(ctx))
+        {
+            EasyRustParser::FunctionCallContext *fc = call->functionCall();
+            if (!fc || !fc->IDENTIFIER())
+                return nullptr;
+            std::vector<EasyRustAST::Expr *> args;
+            if (fc->arguments())
+            {
+                for (EasyRustParser::ExprContext *arg : fc->arguments()->expr())
+                {
+                    EasyRustAST::Expr *value = buildExpr(arg);
+                    if (!value)
+                        return nullptr;
+                    args.push_back(value);
+                }
+            }
+            return ast.create<EasyRustAST::CallExpr>(loc, symbol(fc->IDENTIFIER()), ast.copyArray(args));
+        }
+        if (auto *id = dynamic_cast<EasyRustParser::IdentifierContext *>(ctx))
+            return id->IDENTIFIER() ? ast.create<EasyRustAST::IdentifierExpr>(loc, symbol(id->IDENTIFIER())) : nullptr;
+        if (auto *parens = dynamic_cast<EasyRustParser::ParensContext *>(ctx))
+            return buildExpr(parens->expr());
+        if (auto *index = dynamic_cast<EasyRustParser::IndexContext *>(ctx))
+        {
+            EasyRustAST::Expr *base = buildExpr(index->expr(0));
+            EasyRustAST::Expr *position = buildExpr(index->expr(1));
+            return base && position ? ast.create<EasyRustAST::IndexExpr>(loc, base, position) : nullptr;
+        }
+        if (auto *repeat = dynamic_cast<EasyRustParser::ArrayRepeatContext *>(ctx))
+        {
+            EasyRustAST::Expr *value = buildExpr(repeat->expr(0));
+            EasyRustAST::Expr *count = buildExpr(repeat->expr(1));
+            return value && count ? ast.create<EasyRustAST::ArrayRepeatExpr>(loc, value, count) : nullptr;
+        }
+        if (auto *list = dynamic_cast<EasyRustParser::ArrayListContext *>(ctx))
+        {
+            std::vector<EasyRustAST::Expr *> elements;
+            for (EasyRustParser::ExprContext *element : list->expr())
+            {
+                EasyRustAST::Expr *value = buildExpr(element);
+                if (!value)
+                    return nullptr;
+                elements.push_back(value);
+            }
+            return ast.create<EasyRustAST::ArrayListExpr>(loc, ast.copyArray(elements));
+        }
+        if (auto *mulDiv = dynamic_cast<EasyRustParser::MulDivContext *>(ctx))
+            return buildBinary(loc, mulDiv->op, mulDiv->expr(0), mulDiv->expr(1));
+        if (auto *addSub = dynamic_cast<EasyRustParser::AddSubContext *>(ctx))
+            return buildBinary(loc, addSub->op, addSub->expr(0), addSub->expr(1));
+        if (auto *number = dynamic_cast<EasyRustParser::NumberContext *>(ctx))
+        {
+            std::string numText = number->NUMBER()->getText();
+            if (numText.find('.') != std::string::npos)
+                return ast.create<EasyRustAST::NumberExpr>(loc, ast.copyString(numText), true, 0, std::stod(numText));
+            return ast.create<EasyRustAST::NumberExpr>(loc, ast.copyString(numText), false, std::stoi(numText), 0.0);
+        }
+        if (auto *boolean = dynamic_cast<EasyRustParser::BooleanContext *>(ctx))
+            return ast.create<EasyRustAST::BooleanExpr>(loc, boolean->getText() == "true");
+        if (auto *str = dynamic_cast<EasyRustParser::StringContext *>(ctx))
+        {
+            // Literal sin las comillas
+            std::string value = str->getText();
+            if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+                value = value.substr(1, value.size() - 2);
+            return ast.create<EasyRustAST::StringExpr>(loc, ast.copyString(value));
+        }
+        return nullptr;
+    }
+
+    EasyRustAST::Expr *buildBinary(EasyRustAST::Location loc, antlr4::Token *op, EasyRustParser::ExprContext *lhsCtx,
+                                   EasyRustParser::ExprContext *rhsCtx)
+    {
+        EasyRustAST::Expr *lhs = buildExpr(lhsCtx);
+        EasyRustAST::Expr *rhs = buildExpr(rhsCtx);
+        if (!op || !lhs || !rhs)
+            return nullptr;
+        return ast.create<EasyRustAST::BinaryExpr>(loc, op->getText()[0], lhs, rhs);
+    }
+
+public:
+    explicit EasyRustASTBuilder(EasyRustAST::Context &ast) : ast(ast) {}
+
+    // Retorna false si hubo errores (ya reportados)
+    bool build(EasyRustParser::ProgramContext *program)
+    {
+        ER_TRACE_SCOPE(Parse, "buildAST");
+        ast.setProgram(ast.copyArray(buildStatements(program->statement())));
+        ER_TRACE(Parse, 2, "AST: " << ast.getNodeCount() << " nodos, " << ast.getSymbolCount() << " identificadores, "
+                                   << ast.getMemoryUsage() << " bytes");
+        return errorCount == 0;
+    }
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Passes/OptimizationLevel.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/TargetParser/Host.h"
+
+// Genera código objeto directamente desde el módulo con un TargetMachine
+// del mismo proceso (reemplaza a `llc`) y enlaza con una sola llamada.
+class EasyRustBackend
+{
+private:
+    std::string triple;
+    std::string cpu;
+    std::unique_ptr<llvm::TargetMachine> targetMachine;
+
+    static llvm::CodeGenOptLevel toCodeGenLevel(llvm::OptimizationLevel level)
+    {
+        if (level == llvm::OptimizationLevel::O0)
+            return llvm::CodeGenOptLevel::None;
+        if (level == llvm::OptimizationLevel::O1)
+            return llvm::CodeGenOptLevel::Less;
+        if (level == llvm::OptimizationLevel::O3)
+            return llvm::CodeGenOptLevel::Aggressive;
+        return llvm::CodeGenOptLevel::Default;
+    }
+
+public:
+    // Inicializa el target nativo una sola vez por proceso (seguro entre hilos)
+    static void initializeTargets()
+    {
+        static std::once_flag initialized;
+        std::call_once(initialized, []
+                       {
+            llvm::InitializeNativeTarget();
+            llvm::InitializeNativeTargetAsmPrinter();
+            llvm::InitializeNativeTargetAsmParser(); });
+    }
+
+    // Crea el TargetMachine para el host. Retorna false y llena `error` si falla.
+    bool init(llvm::OptimizationLevel level, std::string &error)
+    {
+        initializeTargets();
+
+        triple = llvm::sys::getDefaultTargetTriple();
+        const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple, error);
+        if (!target)
+            return false;
+
+        cpu = llvm::sys::getHostCPUName().str();
+        llvm::TargetOptions targetOptions;
+        // Reloc::Static equivale al antiguo `clang ... -no-pie`
+        targetMachine.reset(target->createTargetMachine(
+            triple, cpu, "", targetOptions,
+            llvm::Reloc::Static, std::nullopt, toCodeGenLevel(level)));
+        if (!targetMachine)
+        {
+            error = "No se pudo crear el TargetMachine para " + triple;
+            return false;
+        }
+        return true;
+    }
+
+    llvm::TargetMachine *getTargetMachine() const
+    {
+        return targetMachine.get();
+    }
+
+    const std::string &getTriple() const
+    {
+        return triple;
+    }
+
+    const std::string &getCPU() const
+    {
+        return cpu;
+    }
+
+    // Fija el triple y el data layout del módulo; debe hacerse antes de optimizar
+    void prepareModule(llvm::Module &module) const
+    {
+        module.setTargetTriple(triple);
+        module.setDataLayout(targetMachine->createDataLayout());
+    }
+
+    // Emite el código objeto del módulo en un buffer de memoria
+    bool emitObject(llvm::Module &module, llvm::SmallVectorImpl<char> &buffer, std::string &error)
+    {
+        llvm::raw_svector_ostream os(buffer);
+        llvm::legacy::PassManager codegenPasses;
+        if (targetMachine->addPassesToEmitFile(codegenPasses, os, nullptr,
+                                               llvm::CodeGenFileType::ObjectFile))
+        {
+            error = "El TargetMachine no puede emitir archivos objeto";
+            return false;
+        }
+        codegenPasses.run(module);
+        return true;
+    }
+
+    static bool writeFile(const std::string &filename, llvm::StringRef data, std::string &error)
+    {
+        std::error_code ec;
+        llvm::raw_fd_ostream out(filename, ec, llvm::sys::fs::OF_None);
+        if (ec)
+        {
+            error = ec.message();
+            return false;
+        }
+        out << data;
+        return true;
+    }
+
+    // Enlaza los objetos en un ejecutable con una sola invocación del enlazador.
+    // Con `profileRuntime` se agrega el runtime de perfiles de compiler-rt, que
+    // registra con atexit la escritura del perfil crudo (.profraw).
+    static bool link(const std::vector<std::string> &objectFiles, const std::string &execFile,
+                     std::string &error, bool profileRuntime = false)
+    {
+        auto linker = llvm::sys::findProgramByName("clang");
+        if (!linker && !profileRuntime)
+            linker = llvm::sys::findProgramByName("cc");
+        if (!linker)
+        {
+            error = profileRuntime ? "El ejecutable instrumentado necesita clang para enlazar el runtime de perfiles"
+                                   : "No se encontró un enlazador (clang o cc)";
+            return false;
+        }
+
+        std::vector<llvm::StringRef> args = {*linker};
+        for (const auto &obj : objectFiles)
+            args.push_back(obj);
+        args.push_back("-o");
+        args.push_back(execFile);
+        args.push_back("-no-pie");
+        if (profileRuntime)
+            args.push_back("-fprofile-generate");
+
+        int rc = llvm::sys::ExecuteAndWait(*linker, args, std::nullopt, {}, 0, 0, &error);
+        if (rc != 0)
+        {
+            if (error.empty())
+                error = "El enlazador terminó con código " + std::to_string(rc);
+            return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SHA256.h"
+
+// Versión del compilador; forma parte de la clave de la caché, así que debe
+// cambiar cuando cambie el código generado por EasyRustDriver.
+#define EASYRUST_COMPILER_VERSION "easyrust-0.11"
+
+// Caché en disco de objetos ya optimizados, direccionada por contenido.
+// La clave es el SHA-256 del código fuente, la versión del compilador, la
+// configuración de optimización y el triple/CPU del target. Cada entrada es
+// un archivo `<clave>.o`; su fecha de modificación se actualiza en cada
+// acierto y se usa para desalojar en orden LRU cuando se supera el límite.
+// El tamaño total se mide una vez y se lleva en memoria; el directorio solo
+// se recorre al superar el límite (y ese recorrido corrige lo que hayan
+// agregado otros procesos).
+class EasyRustCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+private:
+    std::filesystem::path dir;
+    uint64_t maxBytes;
+    Stats session;    // Solo esta ejecución
+    Stats cumulative; // Acumulado en <dir>/stats la última vez que se leyó
+    Stats pending;    // De esta ejecución, todavía no sumado a <dir>/stats
+    uint64_t totalBytes = 0;
+    bool totalKnown = false;
+    std::mutex mutex; // Estadísticas, tamaño y desalojo compartidos entre hilos (lote y servidor)
+
+    std::filesystem::path entryPath(const std::string &key) const
+    {
+        return dir / (key + ".o");
+    }
+
+    void loadStats()
+    {
+        cumulative = Stats();
+        std::ifstream in(dir / "stats");
+        in >> cumulative.hits >> cumulative.misses >> cumulative.evictions;
+    }
+
+    // Suma lo pendiente a <dir>/stats después de cada operación, así el
+    // servidor (que no destruye su caché) también cuenta. Lee, suma y
+    // reemplaza con rename bajo un flock de <dir>/stats.lock para que los
+    // procesos que comparten la caché no se pisen. Se llama con `mutex` tomado.
+    void saveStats()
+    {
+        if (!pending.hits && !pending.misses && !pending.evictions)
+            return;
+        int fd = ::open((dir / "stats.lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return;
+        if (::flock(fd, LOCK_EX) == 0)
+        {
+            loadStats();
+            Stats saved = cumulative;
+            saved.hits += pending.hits;
+            saved.misses += pending.misses;
+            saved.evictions += pending.evictions;
+            std::filesystem::path tmp = dir / ("stats.tmp" + std::to_string(llvm::sys::Process::getProcessId()));
+            std::error_code ec;
+            {
+                std::ofstream out(tmp, std::ios::trunc);
+                out << saved.hits << " " << saved.misses << " " << saved.evictions << "\n";
+                if (!out)
+                    ec = std::make_error_code(std::errc::io_error);
+            }
+            if (!ec)
+                std::filesystem::rename(tmp, dir / "stats", ec);
+            if (ec)
+                std::filesystem::remove(tmp, ec);
+            else
+            {
+                cumulative = saved;
+                pending = Stats();
+            }
+            ::flock(fd, LOCK_UN);
+        }
+        ::close(fd);
+    }
+
+    // Tamaño de todas las entradas, para el total en memoria
+    uint64_t scanSize() const
+    {
+        uint64_t total = 0;
+        std::error_code ec;
+        for (const auto &item : std::filesystem::directory_iterator(dir, ec))
+            if (item.is_regular_file(ec) && item.path().extension() == ".o")
+                total += item.file_size(ec);
+        return total;
+    }
+
+public:
+    EasyRustCache(std::string directory, uint64_t maxBytes)
+        : dir(std::move(directory)), maxBytes(maxBytes)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        loadStats();
+    }
+
+    ~EasyRustCache()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        saveStats();
+    }
+
+    // $EASYRUST_CACHE_DIR, $XDG_CACHE_HOME/easyrust o ~/.cache/easyrust
+    static std::string defaultDirectory()
+    {
+        if (const char *env = std::getenv("EASYRUST_CACHE_DIR"))
+            return env;
+        if (const char *xdg = std::getenv("XDG_CACHE_HOME"))
+            return std::string(xdg) + "/easyrust";
+        if (const char *home = std::getenv("HOME"))
+            return std::string(home) + "/.cache/easyrust";
+        return ".easyrust-cache";
+    }
+
+    static std::string computeKey(const std::string &source, const std::string &optSettings,
+                                  const std::string &target)
+    {
+        llvm::SHA256 hasher;
+        // Separadores con longitud para que ("ab","c") y ("a","bc") no colisionen
+        auto add = [&](const std::string &part)
+        {
+            hasher.update(std::to_string(part.size()) + ":");
+            hasher.update(part);
+        };
+        add(EASYRUST_COMPILER_VERSION);
+        add(LLVM_VERSION_STRING);
+        add(optSettings);
+        add(target);
+        add(source);
+        auto digest = hasher.final();
+        return llvm::toHex(digest, true);
+    }
+
+    // Retorna true y llena `data` si la entrada existe
+    bool lookup(const std::string &key, std::string &data)
+    {
+        std::filesystem::path path = entryPath(key);
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open())
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            session.misses++;
+            pending.misses++;
+            saveStats();
+            return false;
+        }
+        std::ostringstream buffer;
+        buffer << in.rdbuf();
+        data = buffer.str();
+
+        // Marcar como usada recientemente
+        std::error_code ec;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+        std::lock_guard<std::mutex> lock(mutex);
+        session.hits++;
+        pending.hits++;
+        saveStats();
+        return true;
+    }
+
+    // Escribe la entrada de forma atómica (archivo temporal + rename) y desaloja si hace falta
+    bool store(const std::string &key, const char *data, size_t size)
+    {
+        std::filesystem::path path = entryPath(key);
+        std::filesystem::path tmp = path;
+        tmp += ".tmp" + std::to_string(llvm::sys::Process::getProcessId()) + "-" +
+               std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out.is_open())
+                return false;
+            out.write(data, size);
+            if (!out)
+                return false;
+        }
+        std::error_code ec;
+        uint64_t replaced = std::filesystem::file_size(path, ec);
+        if (ec)
+            replaced = 0;
+        std::filesystem::rename(tmp, path, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!totalKnown)
+        {
+            totalBytes = scanSize(); // Ya incluye la entrada nueva
+            totalKnown = true;
+        }
+        else
+        {
+            totalBytes += size;
+            totalBytes -= std::min(replaced, totalBytes);
+        }
+        if (totalBytes > maxBytes)
+            evict();
+        saveStats();
+        return true;
+    }
+
+private:
+    // Elimina las entradas menos usadas hasta quedar por debajo del límite y
+    // recalcula el total. Se llama con `mutex` tomado.
+    void evict()
+    {
+        struct Entry
+        {
+            std::filesystem::path path;
+            std::filesystem::file_time_type time;
+            uint64_t size;
+        };
+        std::vector<Entry> entries;
+        uint64_t total = 0;
+        std::error_code ec;
+        for (const auto &item : std::filesystem::directory_iterator(dir, ec))
+        {
+            if (!item.is_regular_file() || item.path().extension() != ".o")
+                continue;
+            uint64_t size = item.file_size(ec);
+            entries.push_back({item.path(), item.last_write_time(ec), size});
+            total += size;
+        }
+        totalBytes = total;
+        if (total <= maxBytes)
+            return;
+
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+                  { return a.time < b.time; });
+        for (const Entry &entry : entries)
+        {
+            if (total <= maxBytes)
+                break;
+            if (std::filesystem::remove(entry.path, ec))
+            {
+                total -= entry.size;
+                session.evictions++;
+                pending.evictions++;
+            }
+        }
+        totalBytes = total;
+    }
+
+public:
+    const Stats &getSessionStats() const
+    {
+        return session;
+    }
+
+    void printStats(std::ostream &os) const
+    {
+        os << "Caché " << dir.string() << ":\n"
+           << "  esta ejecución: " << session.hits << " aciertos, " << session.misses
+           << " fallos, " << session.evictions << " desalojos\n"
+           << "  acumulado:      " << cumulative.hits + pending.hits << " aciertos, "
+           << cumulative.misses + pending.misses << " fallos, "
+           << cumulative.evictions + pending.evictions << " desalojos\n";
+    }
+};
@@ -0,0 +1,1105 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "EasyRustLexer.h"
+#include "EasyRustParser.h"
+#include "EasyRustASTBuilder.h"
+#include "EasyRustDriver.h"
+#include "EasyRustBackend.h"
+#include "EasyRustCache.h"
+#include "EasyRustConstantFolder.h"
+#include "EasyRustDiagnostics.h"
+#include "EasyRustIncremental.h"
+#include "EasyRustOptimizer.h"
+#include "EasyRustOptions.h"
+#include "EasyRustPartitioner.h"
+#include "EasyRustProgram.h"
+#include "EasyRustStats.h"
+
+// Pipeline de compilación de un archivo: parseo, AST, IR, optimización,
+// backend y enlace. Cada llamada crea su propio EasyRustDriver (y por lo tanto
+// su propio LLVMContext) y su propio TargetMachine, de modo que varias
+// compilaciones pueden correr en hilos distintos.
+class EasyRustCompiler
+{
+public:
+    // Resultado de compilar un archivo; los mensajes se acumulan aquí para
+    // imprimirlos en orden aunque la compilación sea concurrente.
+    struct FileResult
+    {
+        bool ok = false;
+        std::string log;
+        std::string errors;
+        std::string stats; // Registro JSON con --stats=json
+    };
+
+    // Objeto en memoria y el archivo .o donde se escribe
+    using ObjectFile = std::pair<std::string, llvm::SmallVector<char, 0>>;
+
+    // Nodos del árbol de parseo (reglas y terminales)
+    static uint64_t countParseTreeNodes(antlr4::tree::ParseTree *tree)
+    {
+        uint64_t count = 1;
+        for (antlr4::tree::ParseTree *child : tree->children)
+            count += countParseTreeNodes(child);
+        return count;
+    }
+
+    // Estrategia de parseo: TwoStage intenta primero con predicción SLL (más
+    // rápida) y solo si falla vuelve a parsear con LL completo
+    enum class ParseMode
+    {
+        TwoStage,
+        LL
+    };
+
+    // Contadores del proceso: parseos resueltos con SLL y reintentos con LL
+    struct ParseCounters
+    {
+        std::atomic<uint64_t> sll{0};
+        std::atomic<uint64_t> llFallback{0};
+    };
+
+    static ParseCounters &parseCounters()
+    {
+        static ParseCounters counters;
+        return counters;
+    }
+
+    // Errores léxicos y de sintaxis de ANTLR, al destino de diagnósticos del
+    // hilo (ConsoleErrorListener escribe directo en std::cerr)
+    class SyntaxErrorListener : public antlr4::BaseErrorListener
+    {
+    public:
+        void syntaxError(antlr4::Recognizer *, antlr4::Token *, size_t line, size_t charPositionInLine,
+                         const std::string &msg, std::exception_ptr) override
+        {
+            EasyRustDiagnostics::stream() << "Error: línea " << line << ":" << charPositionInLine << " " << msg
+                                          << "\n";
+        }
+    };
+
+    static SyntaxErrorListener &syntaxErrorListener()
+    {
+        static SyntaxErrorListener listener;
+        return listener;
+    }
+
+    static EasyRustParser::ProgramContext *parseProgram(EasyRustParser &parser, ParseMode mode, bool &fallback)
+    {
+        fallback = false;
+        if (mode == ParseMode::TwoStage)
+        {
+            // Etapa 1: SLL sin reportar errores; ante el primero se abandona
+            parser.getInterpreter<antlr4::atn::ParserATNSimulator>()->setPredictionMode(antlr4::atn::PredictionMode::SLL);
+            parser.removeErrorListeners();
+            parser.setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+            try
+            {
+                EasyRustParser::ProgramContext *tree = parser.program();
+                parseCounters().sll++;
+                return tree;
+            }
+            catch (const antlr4::ParseCancellationException &)
+            {
+                // Error de sintaxis real o ambigüedad que SLL no resuelve
+                fallback = true;
+                parseCounters().llFallback++;
+            }
+            parser.reset(); // También rebobina el flujo de tokens
+            parser.addErrorListener(&syntaxErrorListener());
+            parser.setErrorHandler(std::make_shared<antlr4::DefaultErrorStrategy>());
+        }
+
+        // Etapa 2 (o modo LL): predicción completa con recuperación y reporte de errores
+        parser.getInterpreter<antlr4::atn::ParserATNSimulator>()->setPredictionMode(antlr4::atn::PredictionMode::LL);
+        return parser.program();
+    }
+
+    // Parsea el código fuente y construye (y pliega) el AST. Retorna false si
+    // hubo errores léxicos, de sintaxis o al construir el AST: el AST omitiría
+    // las sentencias rotas y se compilaría un programa truncado.
+    static bool buildAST(const std::string &source, EasyRustAST::Context &ast, const EasyRustOptions &options,
+                         EasyRustStats *stats = nullptr, ParseMode mode = ParseMode::TwoStage)
+    {
+        {
+            antlr4::ANTLRInputStream input(source);
+            EasyRustLexer lexer(&input);
+            lexer.removeErrorListeners();
+            lexer.addErrorListener(&syntaxErrorListener());
+            antlr4::CommonTokenStream tokens(&lexer);
+            {
+                // Tokenizar todo antes de parsear para medir el lexer por separado
+                EasyRustStats::Scope phase(stats, "lex");
+                ER_TRACE_SCOPE(Parse, "lex");
+                tokens.fill();
+            }
+
+            EasyRustParser parser(&tokens);
+            parser.removeErrorListeners();
+            parser.addErrorListener(&syntaxErrorListener());
+            EasyRustParser::ProgramContext *tree;
+            bool fallback;
+            {
+                EasyRustStats::Scope phase(stats, "parse");
+                ER_TRACE_SCOPE(Parse, "parse");
+                tree = parseProgram(parser, mode, fallback);
+            }
+            ER_TRACE(Parse, 2, tokens.size() << " tokens, " << parser.getNumberOfSyntaxErrors()
+                                             << " errores de sintaxis" << (fallback ? ", reintento con LL" : ""));
+            if (lexer.getNumberOfSyntaxErrors() > 0 || parser.getNumberOfSyntaxErrors() > 0)
+                return false;
+            bool built;
+            {
+                EasyRustStats::Scope phase(stats, "ast");
+                built = EasyRustASTBuilder(ast).build(tree);
+            }
+            if (!built)
+                return false;
+
+            if (stats)
+            {
+                stats->setCounter("source_bytes", source.size());
+                stats->setCounter("tokens", tokens.size());
+                stats->setCounter("parse_tree_nodes", countParseTreeNodes(tree));
+                stats->setCounter("parse_ll_fallback", fallback ? 1 : 0);
+            }
+        } // Aquí se liberan el árbol de parseo, los tokens y el parser
+
+        if (stats)
+        {
+            stats->setCounter("ast_nodes", ast.getNodeCount());
+            stats->setCounter("ast_bytes", ast.getMemoryUsage());
+        }
+        if (options.foldConstants)
+        {
+            EasyRustConstantFolder::Result folded;
+            {
+                EasyRustStats::Scope phase(stats, "fold");
+                folded = EasyRustConstantFolder(ast).run();
+            }
+            if (stats)
+            {
+                stats->setCounter("fold_nodes_removed", folded.nodesRemoved);
+                stats->setCounter("fold_propagated", folded.propagated);
+            }
+        }
+        return true;
+    }
+
+    // Un programa con errores de sintaxis o de generación, o cuyo módulo no pasa
+    // la verificación, no se optimiza ni se guarda en la caché: los pases y el backend asumen IR
+    // válido (antes opt lo rechazaba y la compilación fallaba)
+    static constexpr const char *CodegenFailed = "La generación del IR falló";
+
+    // Parsea el código fuente, construye el AST, genera el módulo LLVM y lo
+    // verifica; nullptr si hubo errores de sintaxis o de generación (ya se informaron)
+    static std::unique_ptr<EasyRustDriver> generateModule(const std::string &source,
+                                                          const EasyRustOptions &options,
+                                                          EasyRustStats *stats = nullptr,
+                                                          ParseMode mode = ParseMode::TwoStage)
+    {
+        EasyRustAST::Context ast;
+        if (!buildAST(source, ast, options, stats, mode))
+            return nullptr;
+
+        auto driver = std::make_unique<EasyRustDriver>(options.directSSA);
+        bool generated;
+        {
+            EasyRustStats::Scope phase(stats, "codegen");
+            generated = generateIR(ast, *driver, options, stats);
+            if (options.internalLinkage)
+                driver->internalizeUserFunctions();
+        }
+        {
+            EasyRustStats::Scope phase(stats, "verify");
+            if (!generated || !driver->verify())
+                return nullptr;
+        }
+        if (stats)
+            stats->recordModule(driver->getModule());
+        return driver;
+    }
+
+    // Funciones de nivel superior por hilo como mínimo: con menos, crear los
+    // contextos y unir los fragmentos cuesta más de lo que se gana
+    static constexpr size_t MinFunctionsPerShard = 32;
+
+    // Genera el IR del programa en `driver`. Con --codegen-threads cada hilo
+    // genera con su propio driver (y LLVMContext) los cuerpos de una parte de
+    // las funciones sobre el mismo AST, que solo se lee; todas las funciones
+    // ya están declaradas en cada fragmento y los fragmentos se unen por
+    // bitcode en el módulo de `driver`, que además genera main. Retorna false
+    // si algún fragmento informó errores.
+    static bool generateIR(const EasyRustAST::Context &ast, EasyRustDriver &driver, const EasyRustOptions &options,
+                           EasyRustStats *stats = nullptr)
+    {
+        size_t functions = llvm::count_if(ast.getProgram(), [](const EasyRustAST::Stmt *stmt)
+                                          { return llvm::isa<EasyRustAST::FunctionDecl>(stmt); });
+        unsigned threads = options.codegenThreads ? options.codegenThreads
+                                                  : std::max(1u, std::thread::hardware_concurrency());
+        unsigned shards = std::min<size_t>(threads, functions / MinFunctionsPerShard);
+        if (shards < 2)
+        {
+            driver.codegen(ast);
+            return driver.getErrorCount() == 0;
+        }
+
+        // Los diagnósticos se guardan por función (EasyRustDriver::setDiagnosticSections)
+        // y al terminar se agregan a los de este hilo en el orden del programa,
+        // como sin fragmentos; lo que un hilo informe fuera de ellas va al final
+        std::vector<std::string> bitcode(shards), messages(shards), sections(functions + 2);
+        std::vector<unsigned> errors(shards, 0);
+        std::vector<std::thread> workers;
+        for (unsigned shard = 1; shard < shards; shard++)
+            workers.emplace_back([&, shard]
+                                 {
+                                     EasyRustDiagnostics::Capture capture(messages[shard]);
+                                     EasyRustDriver worker(options.directSSA);
+                                     worker.setDiagnosticSections(&sections);
+                                     worker.codegen(ast, true, shard, shards);
+                                     errors[shard] = worker.getErrorCount();
+                                     bitcode[shard] = worker.writeBitcode();
+                                 });
+        driver.setDiagnosticSections(&sections);
+        driver.codegen(ast, true, 0, shards);
+        driver.setDiagnosticSections(nullptr);
+        for (std::thread &worker : workers)
+            worker.join();
+        for (const std::string &text : sections)
+            EasyRustDiagnostics::stream() << text;
+        for (const std::string &text : messages)
+            EasyRustDiagnostics::stream() << text;
+
+        bool ok = driver.getErrorCount() == 0 && llvm::all_of(errors, [](unsigned count) { return count == 0; });
+        std::string error;
+        for (unsigned shard = 1; shard < shards; shard++)
+        {
+            if (!driver.linkShard(bitcode[shard], error))
+            {
+                EasyRustDiagnostics::stream() << "Error: " << error << "\n";
+                ok = false;
+            }
+        }
+        driver.finishModule();
+        if (stats)
+            stats->setCounter("codegen_shards", shards);
+        return ok;
+    }
+
+    static bool readSource(const std::string &inputFile, std::string &source)
+    {
+        if (inputFile.empty())
+        {
+            source.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+            return true;
+        }
+        std::ifstream ifile(inputFile, std::ios::binary);
+        if (!ifile.is_open())
+            return false;
+        source.assign(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    // Expande directorios a sus archivos .hrust (recursivamente y en orden
+    // alfabético) para que la salida del lote sea determinista
+    static bool expandInputs(const std::vector<std::string> &inputs, std::vector<std::string> &files,
+                             std::string &error)
+    {
+        for (const std::string &input : inputs)
+        {
+            std::error_code ec;
+            if (!std::filesystem::is_directory(input, ec))
+            {
+                files.push_back(input);
+                continue;
+            }
+            std::vector<std::string> found;
+            for (const auto &entry : std::filesystem::recursive_directory_iterator(input, ec))
+                if (entry.is_regular_file() && entry.path().extension() == ".hrust")
+                    found.push_back(entry.path().string());
+            if (ec)
+            {
+                error = "No se pudo leer el directorio " + input + ": " + ec.message();
+                return false;
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        }
+        return true;
+    }
+
+    // "dir/prog.hrust" => "dir/prog"
+    static std::string baseName(const std::string &inputFile)
+    {
+        std::string input_filename = inputFile.empty() ? "stdin" : inputFile;
+        size_t last_dot = input_filename.find_last_of('.');
+        size_t last_slash = input_filename.find_last_of('/');
+        if (last_dot == std::string::npos || (last_slash != std::string::npos && last_dot < last_slash))
+            return input_filename;
+        return input_filename.substr(0, last_dot);
+    }
+
+    // Pasa al optimizador el modo PGO: instrumentar o usar un perfil combinado
+    static void configureProfile(EasyRustOptimizer &optimizer, const EasyRustOptions &options,
+                                 const std::string &base_name)
+    {
+        if (options.profileGenerate)
+            optimizer.instrumentProfile(!options.profileOutput.empty() ? options.profileOutput
+                                        : base_name.empty()            ? ""
+                                                                       : base_name + ".profraw");
+        else if (!options.profileUse.empty())
+            optimizer.useProfile(options.profileUse);
+    }
+
+    // Compila el código fuente hasta un objeto en memoria: parseo, IR, optimización y backend
+    static bool compileToObject(const std::string &source, const EasyRustOptions &options,
+                                EasyRustBackend &backend, const std::string &base_name,
+                                llvm::SmallVectorImpl<char> &object, std::ostream &log, std::string &error,
+                                EasyRustStats *stats = nullptr)
+    {
+        std::unique_ptr<EasyRustDriver> driver = generateModule(source, options, stats);
+        if (!driver)
+        {
+            error = CodegenFailed;
+            return false;
+        }
+
+        // Guardar el IR en un archivo (solo si se pidió)
+        if (options.emitLLVM)
+        {
+            std::string ir_filename = base_name + ".ll";
+            EasyRustStats::Scope phase(stats, "print_ir");
+            if (!EasyRustBackend::writeFile(ir_filename, driver->getIR(), error))
+            {
+                error = "No se pudo crear el archivo IR " + ir_filename;
+                return false;
+            }
+            log << "IR guardado en " << ir_filename << "\n";
+        }
+
+        return optimizeToObject(driver->getModule(), options, backend, base_name, object, log, error, stats);
+    }
+
+    // Optimiza el módulo y emite su código objeto (con --emit-llvm guarda también <base>_opt.ll)
+    static bool optimizeToObject(llvm::Module &module, const EasyRustOptions &options, EasyRustBackend &backend,
+                                 const std::string &base_name, llvm::SmallVectorImpl<char> &object,
+                                 std::ostream &log, std::string &error, EasyRustStats *stats = nullptr)
+    {
+        backend.prepareModule(module);
+
+        // Optimizar el módulo en el mismo proceso (nuevo pass manager)
+        EasyRustOptimizer optimizer(options.optLevel, options.passPipeline, backend.getTargetMachine(), stats);
+        configureProfile(optimizer, options, base_name);
+        if (options.passPipeline.empty())
+            log << "Ejecutando optimización: -" << options.optLevelName
+                << (options.profileGenerate      ? " (instrumentado)"
+                    : options.profileUse.empty() ? ""
+                                                 : " (perfil " + options.profileUse + ")")
+                << "\n";
+        else
+            log << "Ejecutando optimización: --passes=" << options.passPipeline << "\n";
+        {
+            EasyRustStats::Scope phase(stats, "optimize");
+            ER_TRACE_SCOPE(Codegen, "optimize");
+            if (!optimizer.run(module, error))
+            {
+                error = "Optimización fallida: " + error;
+                return false;
+            }
+        }
+        if (stats)
+        {
+            uint64_t optimized = 0;
+            for (const llvm::Function &function : module)
+                optimized += function.getInstructionCount();
+            stats->setCounter("ir_instructions_optimized", optimized);
+        }
+
+        if (options.emitLLVM)
+        {
+            std::string optimized_ir = base_name + "_opt.ll";
+            EasyRustStats::Scope phase(stats, "print_optimized_ir");
+            std::string opt_ir;
+            llvm::raw_string_ostream rso(opt_ir);
+            module.print(rso, nullptr);
+            rso.flush();
+            if (!EasyRustBackend::writeFile(optimized_ir, opt_ir, error))
+            {
+                error = "No se pudo crear el archivo IR " + optimized_ir;
+                return false;
+            }
+            log << "IR optimizado guardado en " << optimized_ir << "\n";
+        }
+
+        // Emitir el código objeto directamente desde el módulo
+        EasyRustStats::Scope phase(stats, "backend");
+        ER_TRACE_SCOPE(Codegen, "backend");
+        if (!backend.emitObject(module, object, error))
+        {
+            error = "Generación de código objeto fallida: " + error;
+            return false;
+        }
+        return true;
+    }
+
+    // Optimiza y compila el módulo: un objeto <base>.o o, con --partitions=<n>,
+    // hasta n objetos (<base>.o, <base>-p1.o, ...) generados en paralelo. Cada
+    // parte (ver EasyRustPartitioner.h) viaja como bitcode a un hilo con su
+    // propio LLVMContext y TargetMachine; las funciones pequeñas de otras
+    // partes se copian para que el inliner las siga viendo.
+    static bool optimizeToObjects(llvm::Module &module, const EasyRustOptions &options, EasyRustBackend &backend,
+                                  const std::string &base_name, std::vector<ObjectFile> &objects, std::ostream &log,
+                                  std::string &error, EasyRustStats *stats = nullptr)
+    {
+        if (options.partitions <= 1)
+        {
+            objects.assign(1, ObjectFile{base_name + ".o", {}});
+            return optimizeToObject(module, options, backend, base_name, objects[0].second, log, error, stats);
+        }
+
+        std::vector<std::string> bitcode;
+        unsigned imported = 0;
+        {
+            EasyRustStats::Scope phase(stats, "partition");
+            backend.prepareModule(module);
+            EasyRustPartitioner::externalize(module);
+            for (const std::vector<llvm::Function *> &members :
+                 EasyRustPartitioner::partition(module, options.partitions))
+            {
+                unsigned count = 0;
+                std::unique_ptr<llvm::Module> part =
+                    EasyRustPartitioner::extract(module, members, EasyRustProgram::ImportInstructionLimit, &count);
+                imported += count;
+                llvm::raw_string_ostream os(bitcode.emplace_back());
+                llvm::WriteBitcodeToFile(*part, os);
+            }
+        }
+
+        // El IR optimizado de cada parte no se guarda: serían n archivos _opt.ll
+        EasyRustOptions partOptions = options;
+        partOptions.emitLLVM = false;
+        objects.assign(bitcode.size(), {});
+        std::vector<std::string> errors(bitcode.size());
+        std::atomic<size_t> next{0};
+        auto worker = [&]()
+        {
+            EasyRustBackend partBackend;
+            for (size_t i = next++; i < bitcode.size(); i = next++)
+            {
+                objects[i].first = i == 0 ? base_name + ".o" : base_name + "-p" + std::to_string(i) + ".o";
+                if (!partBackend.getTargetMachine() && !partBackend.init(options.optLevel, errors[i]))
+                    continue;
+                llvm::LLVMContext context;
+                llvm::Expected<std::unique_ptr<llvm::Module>> part =
+                    llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcode[i], objects[i].first), context);
+                if (!part)
+                {
+                    errors[i] = llvm::toString(part.takeError());
+                    continue;
+                }
+                std::ostringstream partLog;
+                optimizeToObject(**part, partOptions, partBackend, base_name, objects[i].second, partLog, errors[i]);
+            }
+        };
+        log << "Ejecutando optimización: -" << options.optLevelName << " en " << bitcode.size() << " particiones\n";
+        {
+            EasyRustStats::Scope phase(stats, "parallel_backend");
+            unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+            std::vector<std::thread> pool;
+            for (unsigned t = 1; t < std::min<size_t>(jobs, bitcode.size()); t++)
+                pool.emplace_back(worker);
+            worker();
+            for (std::thread &thread : pool)
+                thread.join();
+        }
+        for (size_t i = 0; i < errors.size(); i++)
+        {
+            if (!errors[i].empty())
+            {
+                error = "Partición " + std::to_string(i) + ": " + errors[i];
+                return false;
+            }
+        }
+        if (stats)
+        {
+            stats->setCounter("partitions", bitcode.size());
+            stats->setCounter("partition_imported_functions", imported);
+        }
+        return true;
+    }
+
+    // Como compileToObject, pero con --partitions=<n> puede generar varios objetos
+    static bool compileToObjects(const std::string &source, const EasyRustOptions &options,
+                                 EasyRustBackend &backend, const std::string &base_name,
+                                 std::vector<ObjectFile> &objects, std::ostream &log, std::string &error,
+                                 EasyRustStats *stats = nullptr)
+    {
+        std::unique_ptr<EasyRustDriver> driver = generateModule(source, options, stats);
+        if (!driver)
+        {
+            error = CodegenFailed;
+            return false;
+        }
+        if (options.emitLLVM)
+        {
+            std::string ir_filename = base_name + ".ll";
+            EasyRustStats::Scope phase(stats, "print_ir");
+            if (!EasyRustBackend::writeFile(ir_filename, driver->getIR(), error))
+            {
+                error = "No se pudo crear el archivo IR " + ir_filename;
+                return false;
+            }
+            log << "IR guardado en " << ir_filename << "\n";
+        }
+        return optimizeToObjects(driver->getModule(), options, backend, base_name, objects, log, error, stats);
+    }
+
+    // Genera y optimiza el módulo y lo retorna como IR textual (modo IR del servidor)
+    static bool compileToIR(const std::string &source, const EasyRustOptions &options,
+                            EasyRustBackend &backend, std::string &ir, std::string &error)
+    {
+        std::unique_ptr<EasyRustDriver> driver = generateModule(source, options);
+        if (!driver)
+        {
+            error = CodegenFailed;
+            return false;
+        }
+        backend.prepareModule(driver->getModule());
+        EasyRustOptimizer optimizer(options.optLevel, options.passPipeline, backend.getTargetMachine());
+        configureProfile(optimizer, options, "");
+        if (!optimizer.run(driver->getModule(), error))
+        {
+            error = "Optimización fallida: " + error;
+            return false;
+        }
+        llvm::raw_string_ostream rso(ir);
+        driver->getModule().print(rso, nullptr);
+        rso.flush();
+        return true;
+    }
+
+    // Obtiene el objeto de la caché o lo compila. `cache` puede ser nullptr;
+    // si no, se comparte entre hilos.
+    static bool compileSource(const std::string &source, const EasyRustOptions &options,
+                              EasyRustBackend &backend, EasyRustCache *cache, const std::string &base_name,
+                              llvm::SmallVectorImpl<char> &object, std::ostream &log, std::string &error,
+                              EasyRustStats *stats = nullptr)
+    {
+        // Consultar la caché: un acierto evita el parseo, la generación de IR y el backend.
+        // Con --emit-llvm se necesita el IR, así que se compila siempre; el
+        // objeto instrumentado lleva la ruta de su perfil y tampoco se guarda.
+        bool useCache = cache && !options.emitLLVM && !options.profileGenerate;
+        std::string cache_key;
+        if (useCache)
+        {
+            // Un perfil nuevo cambia el objeto aunque la ruta sea la misma
+            std::string settings = options.optimizationKey();
+            if (!options.profileUse.empty())
+            {
+                std::string profile;
+                if (!readSource(options.profileUse, profile))
+                {
+                    error = "No se pudo abrir el perfil " + options.profileUse;
+                    return false;
+                }
+                settings += "|profile:" + llvm::toHex(llvm::SHA256::hash(llvm::arrayRefFromStringRef(profile)), true);
+            }
+            cache_key = EasyRustCache::computeKey(source, settings, backend.getTriple() + "|" + backend.getCPU());
+            std::string cached;
+            EasyRustStats::Scope phase(stats, "cache_lookup");
+            if (cache->lookup(cache_key, cached))
+            {
+                object.assign(cached.begin(), cached.end());
+                log << "Objeto recuperado de la caché (" << cache_key.substr(0, 12) << ")\n";
+                if (stats)
+                    stats->setCounter("cache_hit", 1);
+                return true;
+            }
+        }
+
+        if (!compileToObject(source, options, backend, base_name, object, log, error, stats))
+            return false;
+        if (useCache)
+            cache->store(cache_key, object.data(), object.size());
+        return true;
+    }
+
+    // Programa con import (ver EasyRustProgram.h): genera el módulo de cada
+    // archivo, en postorden para conocer las firmas de lo que importa. Un
+    // archivo cuyo código y cuyas importaciones no cambiaron sale de la caché.
+    static bool generateUnits(EasyRustProgram &program, const EasyRustOptions &options, EasyRustCache *cache,
+                              std::ostream &log, std::string &error, EasyRustStats *stats = nullptr)
+    {
+        // Cada módulo exporta sus funciones; el enlace interno se decide al combinarlos
+        EasyRustOptions unitOptions = options;
+        unitOptions.internalLinkage = false;
+        std::vector<EasyRustProgram::Unit> &units = program.getUnits();
+        uint64_t reused = 0;
+        for (size_t i = 0; i < units.size(); i++)
+        {
+            EasyRustProgram::Unit &unit = units[i];
+            bool isMain = i + 1 == units.size();
+            std::string imported;
+            for (size_t dependency : unit.imports)
+                imported += units[dependency].interface + "\n";
+            std::string interfaceKey = EasyRustCache::computeKey(unit.source, "interface", "");
+            unit.key = EasyRustCache::computeKey(
+                unit.source, std::string(isMain ? "main|" : "unit|") + unitOptions.codegenFlags() + "|" + imported, "");
+            if (cache && cache->lookup(interfaceKey, unit.interface) && cache->lookup(unit.key, unit.bitcode))
+            {
+                reused++;
+                continue;
+            }
+
+            EasyRustAST::Context ast;
+            if (!buildAST(unit.source, ast, unitOptions, isMain ? stats : nullptr))
+            {
+                error = std::string(CodegenFailed) + " en " + program.displayName(i);
+                return false;
+            }
+            unit.interface = EasyRustProgram::interfaceOf(ast);
+            EasyRustDriver driver(unitOptions.directSSA);
+            if (!program.declareImports(i, driver))
+            {
+                error = "No se pudieron declarar las funciones importadas en " + program.displayName(i);
+                return false;
+            }
+            driver.codegen(ast, isMain);
+            if (driver.getErrorCount() > 0 || !driver.verify())
+            {
+                error = std::string(CodegenFailed) + " en " + program.displayName(i);
+                return false;
+            }
+            unit.bitcode = EasyRustProgram::writeBitcode(driver.getModule());
+            if (cache)
+            {
+                cache->store(interfaceKey, unit.interface.data(), unit.interface.size());
+                cache->store(unit.key, unit.bitcode.data(), unit.bitcode.size());
+            }
+        }
+        log << "Módulos: " << units.size() << " (" << reused << " sin cambios, de la caché)\n";
+        if (stats)
+        {
+            stats->setCounter("modules", units.size());
+            stats->setCounter("modules_reused", reused);
+        }
+        return program.checkDuplicates(error);
+    }
+
+    // LTO completo: un solo módulo con todo el programa, listo para optimizar o para el JIT
+    static llvm::orc::ThreadSafeModule linkProgram(EasyRustProgram &program, const EasyRustOptions &options,
+                                                   std::string &error, EasyRustStats *stats = nullptr)
+    {
+        llvm::orc::ThreadSafeModule linked;
+        {
+            EasyRustStats::Scope phase(stats, "link_modules");
+            linked = program.linkFull(error);
+        }
+        if (linked && options.internalLinkage)
+            linked.withModuleDo([](llvm::Module &module)
+                                { EasyRustDriver::internalizeUserFunctions(module); });
+        return linked;
+    }
+
+    // Compila un programa con import: un objeto (LTO completo) o uno por archivo (--lto=thin)
+    static bool compileProgram(const std::string &inputFile, const std::string &source, const EasyRustOptions &options,
+                               EasyRustBackend &backend, EasyRustCache *cache, const std::string &base_name,
+                               std::vector<ObjectFile> &objects, std::ostream &log, std::string &error,
+                               EasyRustStats *stats = nullptr)
+    {
+        EasyRustProgram program;
+        if (!program.load(inputFile, source, error) || !generateUnits(program, options, cache, log, error, stats))
+            return false;
+        bool useCache = cache && !options.emitLLVM && !options.profileGenerate && options.profileUse.empty() &&
+                        options.partitions <= 1;
+        std::string target = backend.getTriple() + "|" + backend.getCPU();
+        if (options.thinLTO)
+            return compileThin(program, options, useCache ? cache : nullptr, target, base_name, objects, log, error,
+                               stats);
+
+        std::string keys;
+        for (const EasyRustProgram::Unit &unit : program.getUnits())
+            keys += unit.key + "|";
+        std::string objectKey = EasyRustCache::computeKey(keys, options.optimizationKey() + "|lto=full", target);
+        objects.assign(1, ObjectFile{base_name + ".o", {}});
+        std::string cached;
+        if (useCache && cache->lookup(objectKey, cached))
+        {
+            objects[0].second.assign(cached.begin(), cached.end());
+            log << "Objeto recuperado de la caché (" << objectKey.substr(0, 12) << ")\n";
+            return true;
+        }
+
+        llvm::orc::ThreadSafeModule linked = linkProgram(program, options, error, stats);
+        if (!linked)
+            return false;
+        llvm::Module &module = *linked.getModuleUnlocked();
+        if (stats)
+            stats->recordModule(module);
+        if (options.emitLLVM)
+        {
+            std::string ir;
+            llvm::raw_string_ostream rso(ir);
+            module.print(rso, nullptr);
+            rso.flush();
+            if (!EasyRustBackend::writeFile(base_name + ".ll", ir, error))
+            {
+                error = "No se pudo crear el archivo IR " + base_name + ".ll";
+                return false;
+            }
+            log << "IR enlazado guardado en " << base_name << ".ll\n";
+        }
+        if (!optimizeToObjects(module, options, backend, base_name, objects, log, error, stats))
+            return false;
+        if (useCache)
+            cache->store(objectKey, objects[0].second.data(), objects[0].second.size());
+        return true;
+    }
+
+    // --lto=thin: cada archivo se optimiza y compila en su propio hilo y
+    // LLVMContext, con copias de las funciones pequeñas que importa
+    static bool compileThin(EasyRustProgram &program, const EasyRustOptions &options, EasyRustCache *cache,
+                            const std::string &target, const std::string &base_name,
+                            std::vector<ObjectFile> &objects, std::ostream &log, std::string &error,
+                            EasyRustStats *stats)
+    {
+        if (!program.planThinImports(error))
+            return false;
+        const std::vector<EasyRustProgram::Unit> &units = program.getUnits();
+        EasyRustOptions unitOptions = options;
+        unitOptions.emitLLVM = false;
+
+        objects.assign(units.size(), {});
+        std::vector<std::string> errors(units.size());
+        std::atomic<size_t> next{0};
+        std::atomic<uint64_t> imported{0}, reused{0};
+        auto worker = [&]()
+        {
+            EasyRustBackend unitBackend;
+            for (size_t i = next++; i < units.size(); i = next++)
+            {
+                objects[i].first = i + 1 == units.size() ? base_name + ".o" : base_name + "-" + units[i].name + ".o";
+                std::string key = EasyRustCache::computeKey(program.thinKey(i),
+                                                            options.optimizationKey() + "|lto=thin", target);
+                std::string cached;
+                if (cache && cache->lookup(key, cached))
+                {
+                    objects[i].second.assign(cached.begin(), cached.end());
+                    reused++;
+                    continue;
+                }
+                if (!unitBackend.getTargetMachine() && !unitBackend.init(options.optLevel, errors[i]))
+                    continue;
+                llvm::LLVMContext context;
+                unsigned count = 0;
+                std::unique_ptr<llvm::Module> module =
+                    program.thinModule(i, context, options.internalLinkage, count, errors[i]);
+                std::ostringstream unitLog;
+                if (!module ||
+                    !optimizeToObject(*module, unitOptions, unitBackend, base_name, objects[i].second, unitLog, errors[i]))
+                    continue;
+                imported += count;
+                if (cache)
+                    cache->store(key, objects[i].second.data(), objects[i].second.size());
+            }
+        };
+        {
+            EasyRustStats::Scope phase(stats, "thin_backend");
+            unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+            std::vector<std::thread> pool;
+            for (unsigned t = 1; t < std::min<size_t>(jobs, units.size()); t++)
+                pool.emplace_back(worker);
+            worker();
+            for (std::thread &thread : pool)
+                thread.join();
+        }
+        for (size_t i = 0; i < units.size(); i++)
+        {
+            if (!errors[i].empty())
+            {
+                error = program.displayName(i) + ": " + errors[i];
+                return false;
+            }
+        }
+        log << "ThinLTO: " << units.size() << " objetos (" << reused << " de la caché), " << imported
+            << " funciones importadas\n";
+        if (stats)
+            stats->setCounter("thin_imported_functions", imported);
+        return true;
+    }
+
+    // --incremental: un objeto por función en <base>.inc/ (ver
+    // EasyRustIncremental.h). El parseo y la generación de IR son del archivo
+    // entero (hacen falta para saber qué cambió y para inferir los atributos
+    // de las firmas); la optimización y el backend, que dominan el tiempo, solo
+    // corren para las funciones cuya clave cambió.
+    static bool compileIncremental(const std::string &source, const EasyRustOptions &options,
+                                   EasyRustBackend &backend, const std::string &base_name,
+                                   std::vector<std::string> &obj_filenames, std::ostream &log, std::string &error,
+                                   EasyRustStats *stats = nullptr)
+    {
+        // Cada función se enlaza desde otro objeto: ninguna puede ser interna
+        EasyRustOptions functionOptions = options;
+        functionOptions.internalLinkage = false;
+        functionOptions.emitLLVM = false;
+
+        EasyRustIncremental state(base_name + ".inc");
+        if (!state.load(error))
+            return false;
+
+        EasyRustAST::Context ast;
+        if (!buildAST(source, ast, functionOptions, stats))
+        {
+            error = CodegenFailed;
+            return false;
+        }
+        EasyRustDriver driver(functionOptions.directSSA);
+        bool generated;
+        {
+            EasyRustStats::Scope phase(stats, "codegen");
+            generated = generateIR(ast, driver, functionOptions, stats);
+        }
+        {
+            EasyRustStats::Scope phase(stats, "verify");
+            if (!generated || !driver.verify())
+            {
+                error = CodegenFailed;
+                return false;
+            }
+        }
+        llvm::Module &module = driver.getModule();
+        backend.prepareModule(module);
+        if (stats)
+            stats->recordModule(module);
+        if (options.emitLLVM)
+        {
+            if (!EasyRustBackend::writeFile(base_name + ".ll", driver.getIR(), error))
+            {
+                error = "No se pudo crear el archivo IR " + base_name + ".ll";
+                return false;
+            }
+            log << "IR guardado en " << base_name << ".ll\n";
+        }
+
+        std::map<std::string, std::string> texts = EasyRustIncremental::sourceTexts(ast, source);
+        std::string settings = functionOptions.optimizationKey() + "|incremental";
+        std::string target = backend.getTriple() + "|" + backend.getCPU();
+        uint64_t reused = 0, rebuilt = 0;
+        double savedMs = 0, spentMs = 0;
+        bool invalidated = false;
+        {
+            EasyRustStats::Scope phase(stats, "incremental_backend");
+            for (llvm::Function &function : module)
+            {
+                if (!EasyRustDriver::isUserFunction(function) && function.getName() != "main")
+                    continue;
+                std::string name = function.getName().str();
+                // Sin su texto (un error de sintaxis) la clave no detectaría cambios
+                auto text = texts.find(name);
+                std::string key = EasyRustIncremental::keyOf(function, text != texts.end() ? text->second : "",
+                                                             settings, target);
+                obj_filenames.push_back(state.objectPath(name));
+                const EasyRustIncremental::Entry *entry = text != texts.end() ? state.reusable(name, key) : nullptr;
+                if (entry)
+                {
+                    state.record(name, key, entry->ms);
+                    savedMs += entry->ms;
+                    reused++;
+                    continue;
+                }
+
+                if (!invalidated)
+                {
+                    state.invalidate();
+                    invalidated = true;
+                }
+                auto begin = std::chrono::steady_clock::now();
+                std::unique_ptr<llvm::Module> part = EasyRustPartitioner::extract(module, {&function});
+                llvm::SmallVector<char, 0> object;
+                std::ostringstream partLog;
+                if (!optimizeToObject(*part, functionOptions, backend, base_name, object, partLog, error) ||
+                    !EasyRustBackend::writeFile(state.objectPath(name), llvm::StringRef(object.data(), object.size()),
+                                                error))
+                {
+                    error = name + ": " + error;
+                    return false;
+                }
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+                state.record(name, key, ms);
+                spentMs += ms;
+                rebuilt++;
+            }
+        }
+        if (!state.save(error))
+            return false;
+
+        log << "Incremental: " << rebuilt << " funciones recompiladas, " << reused << " reutilizadas de "
+            << state.getDirectory() << " (" << static_cast<uint64_t>(spentMs) << " ms de optimización y backend, ~"
+            << static_cast<uint64_t>(savedMs) << " ms ahorrados)\n";
+        if (stats)
+        {
+            stats->setCounter("functions_rebuilt", rebuilt);
+            stats->setCounter("functions_reused", reused);
+            stats->setCounter("incremental_saved_ms", static_cast<uint64_t>(savedMs));
+        }
+        return true;
+    }
+
+    // Escribe <base>.o y, salvo con -c, enlaza <base>.out
+    static bool writeOutputs(const std::string &base_name, llvm::ArrayRef<char> object,
+                             const EasyRustOptions &options, std::ostream &log, std::string &error,
+                             EasyRustStats *stats = nullptr)
+    {
+        std::vector<ObjectFile> objects(1);
+        objects[0].first = base_name + ".o";
+        objects[0].second.assign(object.begin(), object.end());
+        return writeOutputs(base_name, objects, options, log, error, stats);
+    }
+
+    // Escribe los objetos y, salvo con -c, los enlaza en <base>.out
+    static bool writeOutputs(const std::string &base_name, const std::vector<ObjectFile> &objects,
+                             const EasyRustOptions &options, std::ostream &log, std::string &error,
+                             EasyRustStats *stats = nullptr)
+    {
+        std::vector<std::string> obj_filenames;
+        uint64_t objectBytes = 0;
+        for (const auto &[obj_filename, object] : objects)
+        {
+            if (!EasyRustBackend::writeFile(obj_filename, llvm::StringRef(object.data(), object.size()), error))
+            {
+                error = "No se pudo crear el archivo objeto " + obj_filename + ": " + error;
+                return false;
+            }
+            log << "Objeto guardado en " << obj_filename << "\n";
+            obj_filenames.push_back(obj_filename);
+            objectBytes += object.size();
+        }
+        if (stats)
+            stats->setCounter("object_bytes", objectBytes);
+
+        if (options.compileOnly)
+            return true;
+        return linkExecutable(base_name, obj_filenames, options, log, error, stats);
+    }
+
+    // Enlaza los objetos ya escritos en <base>.out
+    static bool linkExecutable(const std::string &base_name, const std::vector<std::string> &obj_filenames,
+                               const EasyRustOptions &options, std::ostream &log, std::string &error,
+                               EasyRustStats *stats = nullptr)
+    {
+        std::string exec_filename = base_name + ".out";
+
+        // Generar el ejecutable final con una sola llamada al enlazador
+        log << "Generando ejecutable: " << exec_filename << "\n";
+        {
+            EasyRustStats::Scope phase(stats, "link");
+            if (!EasyRustBackend::link(obj_filenames, exec_filename, error, options.profileGenerate))
+            {
+                error = "Generación del ejecutable fallida: " + error;
+                return false;
+            }
+        }
+        std::error_code ec;
+        if (stats)
+            stats->setCounter("executable_bytes", std::filesystem::file_size(exec_filename, ec));
+        log << "Ejecutable generado: " << exec_filename << "\n";
+        return true;
+    }
+
+    // Compila un archivo completo hasta <base>.o y, salvo con -c, <base>.out.
+    static FileResult compileFile(const std::string &inputFile, const EasyRustOptions &options,
+                                  EasyRustCache *cache)
+    {
+        FileResult result;
+        std::ostringstream log;
+        std::string error;
+        // Los diagnósticos de este archivo van en result.errors, que se imprime en el orden de entrada
+        std::string diagnostics;
+        EasyRustDiagnostics::Capture capture(diagnostics);
+        std::unique_ptr<EasyRustStats> stats;
+        if (options.statsJSON)
+            stats = std::make_unique<EasyRustStats>(inputFile.empty() ? "stdin" : inputFile);
+        auto finish = [&](bool ok)
+        {
+            capture.flush();
+            result.ok = ok;
+            result.errors = diagnostics + result.errors;
+            result.log = log.str();
+            if (stats)
+                result.stats = stats->toJSON();
+            return result;
+        };
+        auto fail = [&](const std::string &message)
+        {
+            result.errors = "Error: " + message + "\n";
+            return finish(false);
+        };
+
+        std::string source;
+        if (!readSource(inputFile, source))
+            return fail("No se pudo abrir el archivo " + inputFile);
+        std::string base_name = baseName(inputFile);
+
+        // Crear el TargetMachine del host (reemplaza a llc)
+        EasyRustBackend backend;
+        {
+            EasyRustStats::Scope phase(stats.get(), "target_init");
+            if (!backend.init(options.optLevel, error))
+                return fail(error);
+        }
+
+        // Con import cada archivo es un módulo y se enlazan antes de optimizar
+        if (!EasyRustProgram::scanImports(source).empty())
+        {
+            if (options.incremental)
+                return fail("--incremental no admite programas con import");
+            std::vector<ObjectFile> objects;
+            if (!compileProgram(inputFile, source, options, backend, cache, base_name, objects, log, error,
+                                stats.get()) ||
+                !writeOutputs(base_name, objects, options, log, error, stats.get()))
+                return fail(error);
+            return finish(true);
+        }
+
+        if (options.incremental)
+        {
+            std::vector<std::string> obj_filenames;
+            if (!compileIncremental(source, options, backend, base_name, obj_filenames, log, error, stats.get()) ||
+                !linkExecutable(base_name, obj_filenames, options, log, error, stats.get()))
+                return fail(error);
+            return finish(true);
+        }
+
+        // Los objetos de varias particiones no pasan por la caché
+        if (options.partitions > 1)
+        {
+            std::vector<ObjectFile> objects;
+            if (!compileToObjects(source, options, backend, base_name, objects, log, error, stats.get()) ||
+                !writeOutputs(base_name, objects, options, log, error, stats.get()))
+                return fail(error);
+            return finish(true);
+        }
+
+        llvm::SmallVector<char, 0> object;
+        if (!compileSource(source, options, backend, cache, base_name, object, log, error, stats.get()) ||
+            !writeOutputs(base_name, object, options, log, error, stats.get()))
+            return fail(error);
+
+        return finish(true);
+    }
+};
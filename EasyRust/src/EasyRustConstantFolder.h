@@ -0,0 +1,511 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/Casting.h"
+
+#include "EasyRustAST.h"
+#include "EasyRustTrace.h"
+
+// Plegado y propagación de constantes sobre el AST, antes de generar el IR.
+// Evalúa la aritmética entre literales con la misma semántica que el código
+// generado (int de 32 bits con desborde modular, double IEEE) y reemplaza las
+// lecturas de un `let` con valor constante que no se vuelve a asignar por el
+// valor (y elimina el `let`). Así -O0 y el JIT no pagan en tiempo de
+// ejecución por expresiones fijas.
+//
+// Las comparaciones las pliega el IRBuilder del generador, y las ramas de un
+// if o un while con condición constante no se eliminan acá: el generador las
+// revisa igual y recién entonces las descarta (EasyRustDriver::emitDeadBlock),
+// para que un error en código muerto se informe igual que con --no-fold.
+//
+// No se pliegan las divisiones enteras por cero ni INT_MIN / -1 (el programa
+// las ejecuta igual que antes), ni las operaciones entre tipos distintos, que
+// siguen llegando al generador para que reporte el error.
+class EasyRustConstantFolder
+{
+public:
+    struct Result
+    {
+        uint64_t nodesRemoved = 0;    // Nodos del AST que ya no llegan al generador
+        uint64_t propagated = 0;      // Lecturas de variables reemplazadas por su valor
+    };
+
+private:
+    EasyRustAST::Context &ast;
+    Result result;
+
+    // Valor constante visible de cada símbolo (nullptr si la variable no es
+    // constante) y la función en la que se declaró: igual que la tabla de
+    // símbolos, desde una función no se ven las variables de afuera
+    struct Binding
+    {
+        const EasyRustAST::Expr *value = nullptr;
+        unsigned function = 0;
+    };
+    std::vector<Binding> bindings;
+    std::vector<std::pair<unsigned, Binding>> undo; // Declaraciones a deshacer al cerrar cada ámbito
+    std::vector<size_t> scopeStart;
+    unsigned functionDepth = 0;
+
+    void pushScope()
+    {
+        scopeStart.push_back(undo.size());
+    }
+
+    void popScope()
+    {
+        size_t start = scopeStart.back();
+        scopeStart.pop_back();
+        while (undo.size() > start)
+        {
+            bindings[undo.back().first] = undo.back().second;
+            undo.pop_back();
+        }
+    }
+
+    void declare(EasyRustAST::Symbol symbol, const EasyRustAST::Expr *value)
+    {
+        if (symbol.id >= bindings.size())
+            bindings.resize(symbol.id + 1);
+        undo.push_back({symbol.id, bindings[symbol.id]});
+        bindings[symbol.id] = {value, functionDepth};
+    }
+
+    const EasyRustAST::Expr *lookup(EasyRustAST::Symbol symbol) const
+    {
+        if (symbol.id >= bindings.size() || bindings[symbol.id].function != functionDepth)
+            return nullptr;
+        return bindings[symbol.id].value;
+    }
+
+    static bool isConstant(const EasyRustAST::Expr *expr)
+    {
+        return llvm::isa<EasyRustAST::NumberExpr>(expr) || llvm::isa<EasyRustAST::BooleanExpr>(expr) ||
+               llvm::isa<EasyRustAST::StringExpr>(expr);
+    }
+
+    EasyRustAST::NumberExpr *makeInt(EasyRustAST::Location loc, int32_t value)
+    {
+        return ast.create<EasyRustAST::NumberExpr>(loc, ast.copyString(std::to_string(value)), false, value, 0.0);
+    }
+
+    EasyRustAST::NumberExpr *makeFloat(EasyRustAST::Location loc, double value)
+    {
+        return ast.create<EasyRustAST::NumberExpr>(loc, ast.copyString(std::to_string(value)), true, 0, value);
+    }
+
+    // Valor de `expr` guardado en una variable de tipo `type` (con la misma
+    // conversión int <-> float que hace el generador) o nullptr
+    const EasyRustAST::Expr *constantFor(const EasyRustAST::TypeSpec &type, EasyRustAST::Expr *expr)
+    {
+        using namespace EasyRustAST;
+        const auto *number = llvm::dyn_cast<NumberExpr>(expr);
+        switch (type.kind)
+        {
+        case TypeKind::Int:
+            if (number && !number->isFloat)
+                return number->intValue == static_cast<int32_t>(number->intValue)
+                           ? number
+                           : makeInt(number->loc, static_cast<int32_t>(number->intValue));
+            // fptosi fuera de rango es poison: solo se pliegan los valores representables
+            if (number && number->floatValue > -2147483649.0 && number->floatValue < 2147483648.0)
+                return makeInt(number->loc, static_cast<int32_t>(number->floatValue));
+            return nullptr;
+        case TypeKind::Float:
+            if (number && number->isFloat)
+                return number;
+            if (number)
+                return makeFloat(number->loc, static_cast<int32_t>(number->intValue));
+            return nullptr;
+        case TypeKind::Bool:
+            return llvm::isa<BooleanExpr>(expr) ? expr : nullptr;
+        case TypeKind::String:
+            return llvm::isa<StringExpr>(expr) ? expr : nullptr;
+        default:
+            return nullptr;
+        }
+    }
+
+    // Reemplaza un nodo ya plegado por otro más chico
+    EasyRustAST::Expr *replace(EasyRustAST::Expr *old, EasyRustAST::Expr *folded)
+    {
+        result.nodesRemoved += countNodes(old) - countNodes(folded);
+        return folded;
+    }
+
+    void foldList(llvm::ArrayRef<EasyRustAST::Expr *> &exprs)
+    {
+        std::vector<EasyRustAST::Expr *> folded(exprs.begin(), exprs.end());
+        bool changed = false;
+        for (EasyRustAST::Expr *&expr : folded)
+        {
+            EasyRustAST::Expr *value = foldExpr(expr);
+            changed = changed || value != expr;
+            expr = value;
+        }
+        if (changed)
+            exprs = ast.copyArray(folded);
+    }
+
+    EasyRustAST::Expr *foldExpr(EasyRustAST::Expr *expr)
+    {
+        using namespace EasyRustAST;
+        switch (expr->kind)
+        {
+        case ExprKind::Identifier:
+            if (const Expr *value = lookup(llvm::cast<IdentifierExpr>(expr)->name))
+            {
+                // Los literales no se modifican: todas las lecturas comparten el nodo
+                result.propagated++;
+                return const_cast<Expr *>(value);
+            }
+            return expr;
+        case ExprKind::Binary:
+            return foldBinary(llvm::cast<BinaryExpr>(expr));
+        case ExprKind::Call:
+            foldList(llvm::cast<CallExpr>(expr)->args);
+            return expr;
+        case ExprKind::Index:
+        {
+            auto *index = llvm::cast<IndexExpr>(expr);
+            index->base = foldExpr(index->base);
+            index->index = foldExpr(index->index);
+            return expr;
+        }
+        case ExprKind::ArrayRepeat:
+        {
+            auto *repeat = llvm::cast<ArrayRepeatExpr>(expr);
+            repeat->value = foldExpr(repeat->value);
+            repeat->count = foldExpr(repeat->count);
+            return expr;
+        }
+        case ExprKind::ArrayList:
+            foldList(llvm::cast<ArrayListExpr>(expr)->elements);
+            return expr;
+        case ExprKind::Number:
+        case ExprKind::Boolean:
+        case ExprKind::String:
+            return expr;
+        }
+        return expr;
+    }
+
+    EasyRustAST::Expr *foldBinary(EasyRustAST::BinaryExpr *binary)
+    {
+        using namespace EasyRustAST;
+        binary->lhs = foldExpr(binary->lhs);
+        binary->rhs = foldExpr(binary->rhs);
+
+        if (const auto *left = llvm::dyn_cast<StringExpr>(binary->lhs))
+        {
+            const auto *right = llvm::dyn_cast<StringExpr>(binary->rhs);
+            if (!right || binary->op != '+')
+                return binary;
+            std::string text = left->value.str() + right->value.str();
+            return replace(binary, ast.create<StringExpr>(binary->loc, ast.copyString(text)));
+        }
+
+        const auto *left = llvm::dyn_cast<NumberExpr>(binary->lhs);
+        const auto *right = llvm::dyn_cast<NumberExpr>(binary->rhs);
+        if (!left || !right || left->isFloat != right->isFloat)
+            return binary;
+
+        if (left->isFloat)
+        {
+            double a = left->floatValue, b = right->floatValue, value;
+            switch (binary->op)
+            {
+            case '+': value = a + b; break;
+            case '-': value = a - b; break;
+            case '*': value = a * b; break;
+            case '/': value = a / b; break;
+            default: return binary;
+            }
+            return replace(binary, makeFloat(binary->loc, value));
+        }
+
+        // Aritmética de 32 bits sin nsw: el desborde da la vuelta como en el IR
+        uint32_t a = static_cast<uint32_t>(left->intValue), b = static_cast<uint32_t>(right->intValue), value;
+        switch (binary->op)
+        {
+        case '+': value = a + b; break;
+        case '-': value = a - b; break;
+        case '*': value = a * b; break;
+        case '/':
+            if (b == 0 || (a == 0x80000000u && b == 0xFFFFFFFFu))
+                return binary;
+            value = static_cast<uint32_t>(static_cast<int32_t>(a) / static_cast<int32_t>(b));
+            break;
+        default: return binary;
+        }
+        return replace(binary, makeInt(binary->loc, static_cast<int32_t>(value)));
+    }
+
+    // Solo los operandos: si quedan constantes, el IRBuilder del generador
+    // pliega la comparación y emitIf/emitWhileLoop descartan la rama muerta
+    void foldCondition(EasyRustAST::Condition *cond)
+    {
+        cond->lhs = foldExpr(cond->lhs);
+        cond->rhs = foldExpr(cond->rhs);
+    }
+
+    // Variables asignadas en `stmt` (sin entrar en funciones anidadas)
+    static void collectAssigned(const EasyRustAST::Stmt *stmt, llvm::DenseSet<unsigned> &assigned)
+    {
+        using namespace EasyRustAST;
+        auto collectAll = [&](llvm::ArrayRef<Stmt *> body)
+        {
+            for (const Stmt *inner : body)
+                collectAssigned(inner, assigned);
+        };
+        if (const auto *assign = llvm::dyn_cast<AssignStmt>(stmt))
+            assigned.insert(assign->name.id);
+        else if (const auto *assign = llvm::dyn_cast<IndexAssignStmt>(stmt))
+            assigned.insert(assign->array.id);
+        else if (const auto *loop = llvm::dyn_cast<ForStmt>(stmt))
+        {
+            assigned.insert(loop->stepVar.id);
+            collectAll(loop->body);
+        }
+        else if (const auto *loop = llvm::dyn_cast<WhileStmt>(stmt))
+            collectAll(loop->body);
+        else if (const auto *ifStmt = llvm::dyn_cast<IfStmt>(stmt))
+        {
+            collectAll(ifStmt->thenBody);
+            collectAll(ifStmt->elseBody);
+        }
+        else if (const auto *block = llvm::dyn_cast<BlockStmt>(stmt))
+            collectAll(block->body);
+    }
+
+    llvm::ArrayRef<EasyRustAST::Stmt *> foldBlock(llvm::ArrayRef<EasyRustAST::Stmt *> body)
+    {
+        pushScope();
+        llvm::ArrayRef<EasyRustAST::Stmt *> folded = foldStatements(body);
+        popScope();
+        return folded;
+    }
+
+    llvm::ArrayRef<EasyRustAST::Stmt *> foldStatements(llvm::ArrayRef<EasyRustAST::Stmt *> body)
+    {
+        using namespace EasyRustAST;
+
+        // Un let es constante si ninguna sentencia posterior del bloque lo asigna
+        std::vector<bool> assignedLater(body.size());
+        llvm::DenseSet<unsigned> assigned;
+        for (size_t i = body.size(); i-- > 0;)
+        {
+            if (const auto *decl = llvm::dyn_cast<VarDeclStmt>(body[i]))
+                assignedLater[i] = assigned.count(decl->name.id);
+            collectAssigned(body[i], assigned);
+        }
+
+        std::vector<Stmt *> out;
+        bool changed = false;
+        for (size_t i = 0; i < body.size(); i++)
+        {
+            Stmt *stmt = body[i];
+            switch (stmt->kind)
+            {
+            case StmtKind::VarDecl:
+            {
+                auto *decl = llvm::cast<VarDeclStmt>(stmt);
+                decl->init = foldExpr(decl->init);
+                const Expr *value = assignedLater[i] ? nullptr : constantFor(decl->type, decl->init);
+                declare(decl->name, value);
+                if (value)
+                {
+                    ER_TRACE(Codegen, 2, "Constante propagada: " << ast.name(decl->name));
+                    result.nodesRemoved += countNodes(stmt);
+                    changed = true;
+                    continue;
+                }
+                break;
+            }
+            case StmtKind::Assign:
+            {
+                auto *assign = llvm::cast<AssignStmt>(stmt);
+                assign->value = foldExpr(assign->value);
+                break;
+            }
+            case StmtKind::IndexAssign:
+            {
+                auto *assign = llvm::cast<IndexAssignStmt>(stmt);
+                assign->index = foldExpr(assign->index);
+                assign->value = foldExpr(assign->value);
+                break;
+            }
+            case StmtKind::Function:
+            {
+                auto *function = llvm::cast<FunctionDecl>(stmt);
+                functionDepth++;
+                pushScope();
+                for (const Param &param : function->params)
+                    declare(param.name, nullptr);
+                function->body = foldStatements(function->body);
+                popScope();
+                functionDepth--;
+                break;
+            }
+            case StmtKind::Print:
+            {
+                auto *print = llvm::cast<PrintStmt>(stmt);
+                print->value = foldExpr(print->value);
+                break;
+            }
+            case StmtKind::For:
+            {
+                auto *loop = llvm::cast<ForStmt>(stmt);
+                loop->init = foldExpr(loop->init);
+                pushScope();
+                declare(loop->var, nullptr);
+                foldCondition(loop->cond);
+                loop->body = foldBlock(loop->body);
+                popScope();
+                break;
+            }
+            case StmtKind::While:
+            {
+                auto *loop = llvm::cast<WhileStmt>(stmt);
+                foldCondition(loop->cond);
+                loop->body = foldBlock(loop->body);
+                break;
+            }
+            case StmtKind::If:
+            {
+                auto *ifStmt = llvm::cast<IfStmt>(stmt);
+                foldCondition(ifStmt->cond);
+                ifStmt->thenBody = foldBlock(ifStmt->thenBody);
+                ifStmt->elseBody = foldBlock(ifStmt->elseBody);
+                break;
+            }
+            case StmtKind::Expr:
+            {
+                auto *exprStmt = llvm::cast<ExprStmt>(stmt);
+                exprStmt->expr = foldExpr(exprStmt->expr);
+                if (isConstant(exprStmt->expr))
+                {
+                    // Una expresión constante como sentencia no hace nada
+                    result.nodesRemoved += countNodes(stmt);
+                    changed = true;
+                    continue;
+                }
+                break;
+            }
+            case StmtKind::Return:
+            {
+                auto *ret = llvm::cast<ReturnStmt>(stmt);
+                ret->value = foldExpr(ret->value);
+                break;
+            }
+            case StmtKind::Block:
+            {
+                auto *block = llvm::cast<BlockStmt>(stmt);
+                block->body = foldBlock(block->body);
+                break;
+            }
+            case StmtKind::Import:
+                break;
+            }
+            out.push_back(stmt);
+        }
+        return changed ? ast.copyArray(out) : body;
+    }
+
+public:
+    explicit EasyRustConstantFolder(EasyRustAST::Context &ast) : ast(ast), bindings(ast.getSymbolCount()) {}
+
+    // Pliega el programa en el lugar (el AST se modifica y se reemplaza la lista de sentencias)
+    Result run()
+    {
+        ER_TRACE_SCOPE(Codegen, "fold");
+        pushScope(); // Ámbito de main
+        ast.setProgram(foldStatements(ast.getProgram()));
+        popScope();
+        ER_TRACE(Codegen, 2, "Plegado: " << result.nodesRemoved << " nodos eliminados, " << result.propagated
+                                         << " constantes propagadas");
+        return result;
+    }
+
+    static uint64_t countNodes(const EasyRustAST::Expr *expr)
+    {
+        using namespace EasyRustAST;
+        uint64_t count = 1;
+        if (const auto *binary = llvm::dyn_cast<BinaryExpr>(expr))
+            count += countNodes(binary->lhs) + countNodes(binary->rhs);
+        else if (const auto *call = llvm::dyn_cast<CallExpr>(expr))
+            for (const Expr *arg : call->args)
+                count += countNodes(arg);
+        else if (const auto *index = llvm::dyn_cast<IndexExpr>(expr))
+            count += countNodes(index->base) + countNodes(index->index);
+        else if (const auto *repeat = llvm::dyn_cast<ArrayRepeatExpr>(expr))
+            count += countNodes(repeat->value) + countNodes(repeat->count);
+        else if (const auto *list = llvm::dyn_cast<ArrayListExpr>(expr))
+            for (const Expr *element : list->elements)
+                count += countNodes(element);
+        return count;
+    }
+
+    static uint64_t countNodes(const EasyRustAST::Condition *cond)
+    {
+        return 1 + countNodes(cond->lhs) + countNodes(cond->rhs);
+    }
+
+    static uint64_t countNodes(llvm::ArrayRef<EasyRustAST::Stmt *> body)
+    {
+        uint64_t count = 0;
+        for (const EasyRustAST::Stmt *stmt : body)
+            count += countNodes(stmt);
+        return count;
+    }
+
+    static uint64_t countNodes(const EasyRustAST::Stmt *stmt)
+    {
+        using namespace EasyRustAST;
+        switch (stmt->kind)
+        {
+        case StmtKind::VarDecl:
+            return 1 + countNodes(llvm::cast<VarDeclStmt>(stmt)->init);
+        case StmtKind::Assign:
+            return 1 + countNodes(llvm::cast<AssignStmt>(stmt)->value);
+        case StmtKind::IndexAssign:
+        {
+            const auto *assign = llvm::cast<IndexAssignStmt>(stmt);
+            return 1 + countNodes(assign->index) + countNodes(assign->value);
+        }
+        case StmtKind::Function:
+            return 1 + countNodes(llvm::cast<FunctionDecl>(stmt)->body);
+        case StmtKind::Print:
+            return 1 + countNodes(llvm::cast<PrintStmt>(stmt)->value);
+        case StmtKind::For:
+        {
+            const auto *loop = llvm::cast<ForStmt>(stmt);
+            return 1 + countNodes(loop->init) + countNodes(loop->cond) + countNodes(loop->body);
+        }
+        case StmtKind::While:
+        {
+            const auto *loop = llvm::cast<WhileStmt>(stmt);
+            return 1 + countNodes(loop->cond) + countNodes(loop->body);
+        }
+        case StmtKind::If:
+        {
+            const auto *ifStmt = llvm::cast<IfStmt>(stmt);
+            return 1 + countNodes(ifStmt->cond) + countNodes(ifStmt->thenBody) + countNodes(ifStmt->elseBody);
+        }
+        case StmtKind::Expr:
+            return 1 + countNodes(llvm::cast<ExprStmt>(stmt)->expr);
+        case StmtKind::Return:
+            return 1 + countNodes(llvm::cast<ReturnStmt>(stmt)->value);
+        case StmtKind::Block:
+            return 1 + countNodes(llvm::cast<BlockStmt>(stmt)->body);
+        case StmtKind::Import:
+            return 1;
+        }
+        return 1;
+    }
+};
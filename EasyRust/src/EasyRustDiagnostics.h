@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+
+#include "llvm/Support/raw_ostream.h"
+
+// Destino de los diagnósticos (errores de sintaxis y de generación,
+// advertencias) del hilo actual. Por defecto van a stderr; una compilación
+// del lote o del servidor los captura con Capture en su propio texto, que se
+// entrega junto al resultado del archivo en lugar de mezclarse en stderr con
+// los de los demás hilos.
+class EasyRustDiagnostics
+{
+private:
+    static llvm::raw_ostream *&current()
+    {
+        static thread_local llvm::raw_ostream *stream = nullptr;
+        return stream;
+    }
+
+public:
+    static llvm::raw_ostream &stream()
+    {
+        llvm::raw_ostream *os = current();
+        return os ? *os : llvm::errs();
+    }
+
+    // Mientras existe, los diagnósticos de este hilo se agregan a `text`
+    class Capture
+    {
+    private:
+        llvm::raw_string_ostream os;
+        llvm::raw_ostream *previous;
+
+    public:
+        explicit Capture(std::string &text) : os(text), previous(current())
+        {
+            current() = &os;
+        }
+
+        ~Capture()
+        {
+            os.flush();
+            current() = previous;
+        }
+
+        Capture(const Capture &) = delete;
+        Capture &operator=(const Capture &) = delete;
+
+        // Para leer `text` antes de que termine la captura
+        void flush()
+        {
+            os.flush();
+        }
+    };
+};
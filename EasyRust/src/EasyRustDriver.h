@@ -1,57 +1,121 @@
-#include "antlr4-runtime.h"
-#include "EasyRustBaseVisitor.h"
-#include "EasyRustLexer.h"
-#include "EasyRustParser.h"
+#pragma once
 
+#include "EasyRustAST.h"
+#include "EasyRustDiagnostics.h"
+#include "EasyRustRuntime.h"
+#include "EasyRustSymbolTable.h"
+#include "EasyRustTrace.h"
+
+#include <algorithm>
 #include <cmath>
+#include <iostream>
 #include <map>
+#include <string>
+#include <vector>
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Analysis/CFG.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
 #include "llvm/IR/Argument.h"
 #include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/IR/ConstantRange.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Linker/Linker.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_ostream.h"
 #include <memory>
 
-using namespace antlr4;
 using namespace llvm;
 
 using namespace std;
 
-class EasyRustDriver : public EasyRustVisitor
+// Genera el módulo LLVM a partir del AST (EasyRustAST.h). Cada método
+// retorna directamente el valor LLVM (o nullptr si hubo un error).
+class EasyRustDriver
 {
 private:
-    struct SymbolInfo
-    {
-        llvm::Type *type; // Tipo de la variable (por ejemplo, int, float, etc.)
-        std::string logicalType;
-        llvm::Value *llvmValue; // Referencia a la posición en memoria (AllocaInst, etc.)
-    };
-    LLVMContext context;
+    // El contexto vive en el heap para poder cederlo junto al módulo (JIT)
+    std::unique_ptr<LLVMContext> ownedContext;
+    LLVMContext &context;
     std::unique_ptr<Module> module;
     std::unique_ptr<IRBuilder<>> builder;
-    std::unordered_map<std::string, SymbolInfo> symbolTable;
+    std::unique_ptr<EasyRustRuntime> runtime;
+    EasyRustSymbolTable symbols;
+    const EasyRustAST::Context *ast = nullptr;     // AST en generación (nombres de los símbolos)
+    std::vector<llvm::Function *> functionsBySymbol; // Funciones declaradas, por id de símbolo
+    std::vector<const EasyRustAST::FunctionDecl *> functionDecls; // Declaración dueña de cada prototipo
     FunctionCallee printfFunc;
     FunctionCallee expFunc;
     std::string irString;
+    std::vector<std::string> userFunctions; // Funciones declaradas por el usuario, en orden
+    llvm::StringSet<> importedFunctions;    // Declaradas con declareImportedFunction
+    llvm::DenseMap<llvm::Function *, llvm::AllocaInst *> lastAlloca; // Último alloca del bloque de entrada
+    llvm::raw_ostream *diagnostics; // Destino de los errores del hilo que creó el driver (EasyRustDiagnostics)
+    unsigned errorCount = 0;        // Errores informados por reportError
+    bool muteErrors = false; // Fragmentos > 0 de la pasada de declaraciones: el fragmento 0 ya los informa
+    llvm::raw_null_ostream mutedErrors; // Propio de cada driver: llvm::nulls() es compartido entre hilos
+    std::vector<std::string> *sections = nullptr; // Diagnósticos de codegen por sección (setDiagnosticSections)
+
+    // Construcción directa de SSA (--ssa), según Braun et al., "Simple and
+    // Efficient Construction of Static Single Assignment Form" (CC 2013): las
+    // variables no tienen alloca; cada bloque recuerda la definición actual de
+    // cada variable y las lecturas buscan hacia atrás en los predecesores,
+    // creando phis donde se juntan definiciones distintas. Un bloque se
+    // "sella" cuando ya se conocen todos sus predecesores; antes de eso sus
+    // phis quedan incompletas.
+    bool directSSA;
+    llvm::DenseMap<llvm::BasicBlock *, llvm::DenseMap<unsigned, llvm::WeakTrackingVH>> currentDef;
+    llvm::DenseMap<llvm::BasicBlock *, std::vector<std::pair<unsigned, llvm::PHINode *>>> incompletePhis;
+    llvm::SmallPtrSet<llvm::BasicBlock *, 32> sealedBlocks;
+    std::vector<llvm::Type *> variableTypes; // Por id de variable (EasyRustSymbolTable::Entry::variable)
+    std::vector<std::string> variableNames;
+
+    // Eliminación de chequeos de rango: dentro de `for i = c; (i < lim); i++`
+    // (c >= 0 constante, y ni i ni el arreglo del límite se asignan en el
+    // cuerpo) vale 0 <= i < bound, así que v[i] no necesita chequeo si v es
+    // el arreglo de `len(v)` o un arreglo fijo con al menos `bound` elementos.
+    struct SafeRange
+    {
+        unsigned indexVariable;
+        int arrayVariable; // Variable de `i < len(v)` o -1
+        int64_t bound;     // Límite conocido en compilación o -1
+    };
+    std::vector<SafeRange> safeRanges;
+    unsigned loopDepth = 0; // Bucles que rodean el código actual (en la función actual)
+
+    // Arreglos fijos de hasta este tamaño que se declaran en main fuera de un bucle van en la pila
+    static constexpr uint64_t MaxStackArray = 64 * 1024;
 
 public:
-    EasyRustDriver()
+    explicit EasyRustDriver(bool directSSA = false)
+        : ownedContext(std::make_unique<LLVMContext>()), context(*ownedContext),
+          diagnostics(&EasyRustDiagnostics::stream()), directSSA(directSSA)
     {
         module = std::make_unique<Module>("EasyRustModule", context);
         builder = std::make_unique<IRBuilder<>>(context);
+        runtime = std::make_unique<EasyRustRuntime>(*module);
 
         std::vector<Type *> printfArgs;
         printfArgs.push_back(PointerType::getUnqual(Type::getInt8Ty(context)));
@@ -65,258 +129,891 @@ public:
 
         expFunc = module->getOrInsertFunction("exp", mathFuncType);
     }
-    std::string getIR() const
+    // Serializa el módulo a texto solo cuando se pide (--emit-llvm)
+    std::string getIR()
     {
+        if (irString.empty())
+        {
+            llvm::raw_string_ostream rso(irString);
+            module->print(rso, nullptr);
+            rso.flush();
+        }
         return irString;
     }
 
-    llvm::Type *getLLVMTypeFromLogicalType(const std::string &logicalType, llvm::LLVMContext &context)
+    // Con codegen en paralelo, los diagnósticos de codegen no van al destino
+    // del hilo sino a (*byFunction)[i]: la sección 0 es la pasada de
+    // declaraciones, la 1 + k el cuerpo de la k-ésima función del programa y
+    // la última las sentencias de main. Los fragmentos escriben secciones
+    // distintas del mismo vector (con functions + 2 elementos) y quien los
+    // une las imprime en orden, igual que sin fragmentos.
+    void setDiagnosticSections(std::vector<std::string> *byFunction)
     {
-        if (logicalType == "int")
-        {
-            return llvm::Type::getInt32Ty(context);
-        }
-        else if (logicalType == "float")
+        sections = byFunction;
+    }
+
+    // Errores informados al declarar importaciones y generar el módulo
+    unsigned getErrorCount() const
+    {
+        return errorCount;
+    }
+
+    // Verificar funciones y módulo; retorna false si hay errores
+    bool verify()
+    {
+        bool ok = true;
+        if (Function *mainFunc = module->getFunction("main"))
         {
-            return llvm::Type::getDoubleTy(context);
+            if (verifyFunction(*mainFunc, diagnostics))
+            {
+                *diagnostics << "Error: La función main contiene errores\n";
+                ok = false;
+            }
         }
-        else if (logicalType == "string")
+        if (verifyModule(*module, diagnostics))
         {
-            return llvm::PointerType::getUnqual(context); // Puntero a char para cadenas
+            *diagnostics << "Error: El módulo contiene errores\n";
+            ok = false;
         }
-        else if (logicalType == "bool")
+        return ok;
+    }
+
+    // Acceso al módulo para optimizarlo y compilarlo en el mismo proceso
+    Module &getModule()
+    {
+        return *module;
+    }
+
+    const std::vector<std::string> &getUserFunctions() const
+    {
+        return userFunctions;
+    }
+
+    // Cede el módulo y su contexto (por ejemplo al JIT). El driver no debe
+    // volver a usarse después de esta llamada.
+    orc::ThreadSafeModule takeModule()
+    {
+        builder.reset();
+        runtime.reset();
+        return orc::ThreadSafeModule(std::move(module), std::move(ownedContext));
+    }
+
+    llvm::Type *getLLVMType(const EasyRustAST::TypeSpec &type)
+    {
+        switch (type.kind)
         {
+        case EasyRustAST::TypeKind::Int:
+            return llvm::Type::getInt32Ty(context);
+        case EasyRustAST::TypeKind::Float:
+            return llvm::Type::getDoubleTy(context);
+        case EasyRustAST::TypeKind::String:
+            return runtime->getStringType(); // {datos, longitud}, ver EasyRustRuntime.h
+        case EasyRustAST::TypeKind::Bool:
             return llvm::Type::getInt1Ty(context);
+        case EasyRustAST::TypeKind::Void:
+            return llvm::Type::getVoidTy(context); // Manejo del tipo void
+        case EasyRustAST::TypeKind::Array:
+            if (type.element != EasyRustAST::TypeKind::Array && type.element != EasyRustAST::TypeKind::Unknown)
+            {
+                // {elementos, longitud}, ver EasyRustRuntime.h
+                llvm::Type *element = getLLVMType({type.element, type.spelling});
+                return element ? runtime->getArrayType(element) : nullptr;
+            }
+            break;
+        case EasyRustAST::TypeKind::Unknown:
+            break;
         }
-        else if (logicalType == "void")
+        reportError() << "Tipo no soportado '" << type.spelling.str() << "'\n";
+        return nullptr;
+    }
+
+    // Informa un error de generación; la compilación falla si hubo alguno
+    llvm::raw_ostream &reportError()
+    {
+        if (muteErrors)
+            return mutedErrors;
+        errorCount++;
+        return *diagnostics << "Error: ";
+    }
+
+    llvm::StringRef nameOf(EasyRustAST::Symbol symbol) const
+    {
+        return ast->name(symbol);
+    }
+
+    // Declaración externa de una función definida en un módulo importado; la
+    // definición llega al enlazar los módulos
+    bool declareImportedFunction(llvm::StringRef name, const EasyRustAST::TypeSpec &returnType,
+                                 llvm::ArrayRef<EasyRustAST::TypeSpec> paramTypes)
+    {
+        llvm::Type *llvmReturn = getLLVMType(returnType);
+        std::vector<llvm::Type *> llvmParams;
+        for (const EasyRustAST::TypeSpec &param : paramTypes)
+            llvmParams.push_back(getLLVMType(param));
+        if (!llvmReturn || llvm::is_contained(llvmParams, nullptr))
         {
-            return llvm::Type::getVoidTy(context); // Manejo del tipo void
+            reportError() << "Tipo no soportado en la función importada " << name << "\n";
+            return false;
         }
-        else
+        if (!importedFunctions.insert(name).second)
         {
-            std::cerr << "Error: Tipo no soportado '" << logicalType << "'\n";
-            return nullptr;
+            reportError() << "La función " << name << " se importa de dos módulos\n";
+            return false;
         }
+        llvm::Function::Create(llvm::FunctionType::get(llvmReturn, llvmParams, false),
+                               llvm::Function::ExternalLinkage, name, module.get());
+        return true;
     }
 
-    std::any visitProgram(EasyRustParser::ProgramContext *ctx) override
+    // Genera main con las sentencias de nivel superior; las funciones se
+    // emiten aparte y no cambian el punto de inserción de main. Un módulo
+    // importado (`withMain` = false) solo define sus funciones. Para generar
+    // en paralelo (`shardCount` > 1) este driver define solo las funciones de
+    // nivel superior con ordinal % shardCount == shard, y main solo en el
+    // fragmento 0; las demás quedan declaradas y los fragmentos se unen con
+    // linkShard y finishModule.
+    void codegen(const EasyRustAST::Context &program, bool withMain = true, unsigned shard = 0,
+                 unsigned shardCount = 1)
     {
-        llvm::errs() << "Debug: Entrando a visitProgram\n";
+        ER_TRACE_SCOPE(Codegen, "codegen");
+        ast = &program;
+        symbols = EasyRustSymbolTable(program.getSymbolCount());
+        functionsBySymbol.assign(program.getSymbolCount(), nullptr);
+        functionDecls.assign(program.getSymbolCount(), nullptr);
+        lastAlloca.clear();
+        currentDef.clear();
+        incompletePhis.clear();
+        sealedBlocks.clear();
+        variableTypes.clear();
+        variableNames.clear();
+        safeRanges.clear();
+        loopDepth = 0;
+        symbols.pushScope(); // Ámbito de main
 
         // Crear la función main
-        FunctionType *mainType = FunctionType::get(Type::getInt32Ty(context), false);
-        Function *mainFunc = Function::Create(mainType, Function::ExternalLinkage, "main", module.get());
-
-        BasicBlock *entry = BasicBlock::Create(context, "entry", mainFunc);
-        builder->SetInsertPoint(entry);
+        Function *mainFunc = nullptr;
+        if (withMain && shard == 0)
+        {
+            FunctionType *mainType = FunctionType::get(Type::getInt32Ty(context), false);
+            mainFunc = Function::Create(mainType, Function::ExternalLinkage, "main", module.get());
+            BasicBlock *entry = BasicBlock::Create(context, "entry", mainFunc);
+            builder->SetInsertPoint(entry);
+            sealBlock(entry);
+        }
+
+        // Con secciones, `diagnostics` apunta a la sección en curso
+        llvm::raw_ostream *threadDiagnostics = diagnostics;
+        std::unique_ptr<llvm::raw_string_ostream> section;
+        auto beginSection = [&](size_t index)
+        {
+            if (!sections)
+                return;
+            section = std::make_unique<llvm::raw_string_ostream>((*sections)[index]);
+            diagnostics = section.get();
+        };
+
+        // Todos los fragmentos declaran todas las funciones; los errores de
+        // las declaraciones se informan y se cuentan una sola vez
+        beginSection(0);
+        muteErrors = shard != 0;
+        declareFunctions(program.getProgram());
+        muteErrors = false;
+        unsigned ordinal = 0;
+        for (const EasyRustAST::Stmt *stmt : program.getProgram())
+        {
+            if (const auto *function = llvm::dyn_cast<EasyRustAST::FunctionDecl>(stmt))
+            {
+                if (ordinal++ % shardCount == shard)
+                {
+                    beginSection(ordinal);
+                    emitFunctionDecl(function);
+                }
+            }
+            else if (!withMain && !llvm::isa<EasyRustAST::ImportStmt>(stmt))
+                reportError() << "Un módulo importado solo puede declarar funciones (línea "
+                             << stmt->loc.line << ")\n";
+        }
 
-        for (auto stmt : ctx->statement())
+        if (mainFunc)
         {
-            if (stmt->functionDecl())
+            if (sections)
+                beginSection(sections->size() - 1);
+            for (const EasyRustAST::Stmt *stmt : program.getProgram())
             {
-                // Visitar la declaración de la función
-                visit(stmt);
-                // Restaurar el punto de inserción al bloque de entrada de main
-                builder->SetInsertPoint(entry);
+                if (!llvm::isa<EasyRustAST::FunctionDecl>(stmt))
+                    emitStatement(stmt);
             }
-            else
+            if (!builder->GetInsertBlock()->getTerminator())
             {
-                // Visitar otras declaraciones que se insertan en main
-                visit(stmt);
+                ER_TRACE(Codegen, 2, "Agregando retorno final al main");
+                builder->CreateRet(ConstantInt::get(Type::getInt32Ty(context), 0));
             }
+            runtime->flushBeforeReturns(*mainFunc);
         }
+        section.reset();
+        diagnostics = threadDiagnostics;
+        symbols.popScope();
+        if (shardCount == 1)
+            finishModule();
 
-        if (!builder->GetInsertBlock()->getTerminator())
-        {
-            llvm::errs() << "Debug: Agregando retorno final al main\n";
-            builder->CreateRet(ConstantInt::get(Type::getInt32Ty(context), 0));
-        }
+        ER_TRACE(Codegen, 2, "Módulo generado en EasyRustDriver");
+        ast = nullptr;
+    }
+
+    // Con todos los cuerpos ya en el módulo: quita las importaciones sin uso e infiere atributos
+    void finishModule()
+    {
+        dropUnusedImports();
+        inferFunctionAttributes();
+    }
+
+    // Fragmento de una generación en paralelo, para unirlo en otro contexto
+    std::string writeBitcode() const
+    {
+        std::string bitcode;
+        llvm::raw_string_ostream os(bitcode);
+        llvm::WriteBitcodeToFile(*module, os);
+        os.flush();
+        return bitcode;
+    }
 
-        // Verificar función y módulo
-        if (verifyFunction(*mainFunc, &errs()))
+    // Une al módulo un fragmento generado por otro driver (con su propio
+    // LLVMContext): sus declaraciones se resuelven con las definiciones de
+    // este módulo y viceversa, y el runtime linkonce_odr repetido se descarta
+    bool linkShard(llvm::StringRef bitcode, std::string &error)
+    {
+        llvm::Expected<std::unique_ptr<Module>> shard =
+            llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcode, "shard"), context);
+        if (!shard)
         {
-            errs() << "Error: La función main contiene errores\n";
+            error = llvm::toString(shard.takeError());
+            return false;
         }
-        if (verifyModule(*module, &errs()))
+        if (llvm::Linker::linkModules(*module, std::move(*shard)))
         {
-            errs() << "Error: El módulo contiene errores\n";
+            error = "No se pudo unir un fragmento del módulo";
+            return false;
         }
+        return true;
+    }
+
+    // Una declaración importada sin llamadas haría que el enlazador copiara la función
+    void dropUnusedImports()
+    {
+        for (const auto &imported : importedFunctions)
+            if (llvm::Function *function = module->getFunction(imported.getKey()); function && function->use_empty())
+                function->eraseFromParent();
+    }
 
-        // Imprimir el módulo
-        // Serializar el módulo a una cadena
-        llvm::raw_string_ostream rso(irString);
-        module->print(rso, nullptr);
-        rso.flush();
+    // Funciones definidas por el usuario (no main ni el runtime, que es linkonce_odr)
+    static bool isUserFunction(const llvm::Function &function)
+    {
+        return !function.isDeclaration() && function.getName() != "main" &&
+               (function.hasExternalLinkage() || function.hasInternalLinkage());
+    }
 
-        llvm::errs() << "Debug: IR almacenado internamente en EasyRustDriver\n";
+    // Programa completo: nadie fuera del módulo llama a las funciones de
+    // usuario, así que pueden ser internas (el inliner y GlobalDCE lo aprovechan)
+    static void internalizeUserFunctions(llvm::Module &program)
+    {
+        for (llvm::Function &function : program)
+            if (isUserFunction(function))
+                function.setLinkage(llvm::GlobalValue::InternalLinkage);
+    }
 
-        return nullptr;
+    void internalizeUserFunctions()
+    {
+        internalizeUserFunctions(*module);
     }
 
-    std::any visitStatement(EasyRustParser::StatementContext *ctx) override
+    // #[inline], #[inline(always)], #[inline(never)] y #[cold]
+    void applySourceAttributes(llvm::Function *function, unsigned attributes)
     {
-        llvm::errs() << "Debug: Entrando a visitStatement\n";
-        if (ctx->functionDecl())
-        {
-            return visit(ctx->functionDecl());
+        using namespace EasyRustAST;
+        if ((attributes & AttrAlwaysInline) && (attributes & AttrNoInline))
+        {
+            reportError() << "La función " << function->getName()
+                         << " no puede ser #[inline(always)] e #[inline(never)] a la vez\n";
+            attributes &= ~(AttrAlwaysInline | AttrNoInline);
+        }
+        if (attributes & AttrAlwaysInline)
+            function->addFnAttr(llvm::Attribute::AlwaysInline);
+        else if (attributes & AttrNoInline)
+            function->addFnAttr(llvm::Attribute::NoInline);
+        else if (attributes & AttrInline)
+            function->addFnAttr(llvm::Attribute::InlineHint);
+        if (attributes & AttrCold)
+            function->addFnAttr(llvm::Attribute::Cold);
+    }
+
+    enum class MemoryEffect
+    {
+        None, // No lee ni escribe memoria fuera de sus variables locales
+        Read,
+        Any
+    };
+
+    // Infiere memory(none)/memory(read), nounwind, norecurse y willreturn para
+    // las funciones de usuario. El grafo de llamadas se recorre por
+    // componentes fuertemente conexas de abajo hacia arriba, así que los
+    // callees ya tienen sus atributos; las llamadas dentro de la misma
+    // componente no aportan nada nuevo. Imprimir, concatenar, crear arreglos o
+    // un chequeo de rango (easyrust_panic) hacen que la función no sea pura.
+    void inferFunctionAttributes()
+    {
+        llvm::CallGraph graph(*module);
+        for (auto scc = llvm::scc_begin(&graph); !scc.isAtEnd(); ++scc)
+        {
+            llvm::SmallPtrSet<llvm::Function *, 4> members;
+            for (llvm::CallGraphNode *node : *scc)
+                if (llvm::Function *function = node->getFunction(); function && isUserFunction(*function))
+                    members.insert(function);
+            if (members.empty())
+                continue;
+
+            bool recursive = scc.hasCycle();
+            MemoryEffect effect = MemoryEffect::None;
+            bool willReturn = !recursive;
+            for (llvm::Function *function : members)
+            {
+                // Un bucle puede no terminar
+                llvm::SmallVector<std::pair<const llvm::BasicBlock *, const llvm::BasicBlock *>, 4> backEdges;
+                llvm::FindFunctionBackedges(*function, backEdges);
+                willReturn = willReturn && backEdges.empty();
+
+                for (llvm::Instruction &inst : llvm::instructions(*function))
+                {
+                    if (auto *load = llvm::dyn_cast<llvm::LoadInst>(&inst))
+                    {
+                        if (!isLocalMemory(load->getPointerOperand(), function))
+                            effect = std::max(effect, MemoryEffect::Read);
+                    }
+                    else if (auto *store = llvm::dyn_cast<llvm::StoreInst>(&inst))
+                    {
+                        if (!isLocalMemory(store->getPointerOperand(), function))
+                            effect = MemoryEffect::Any;
+                    }
+                    else if (auto *call = llvm::dyn_cast<llvm::CallBase>(&inst))
+                    {
+                        llvm::Function *callee = call->getCalledFunction();
+                        if (callee && members.count(callee))
+                            continue;
+                        if (!callee || !callee->onlyReadsMemory())
+                            effect = MemoryEffect::Any;
+                        else if (!callee->doesNotAccessMemory())
+                            effect = std::max(effect, MemoryEffect::Read);
+                        willReturn = willReturn && callee && callee->willReturn();
+                    }
+                    else if (inst.mayReadOrWriteMemory())
+                        effect = MemoryEffect::Any;
+                }
+            }
+
+            for (llvm::Function *function : members)
+            {
+                function->setDoesNotThrow(); // El lenguaje no tiene excepciones
+                if (!recursive)
+                    function->setDoesNotRecurse();
+                if (effect == MemoryEffect::None)
+                    function->setDoesNotAccessMemory();
+                else if (effect == MemoryEffect::Read)
+                    function->setOnlyReadsMemory();
+                if (willReturn)
+                    function->addFnAttr(llvm::Attribute::WillReturn);
+                ER_TRACE(Calls, 2, "Atributos inferidos para " << function->getName() << ": "
+                                                               << function->getAttributes().getAsString(
+                                                                      llvm::AttributeList::FunctionIndex));
+            }
         }
-        else if (ctx->printStmt())
+    }
+
+    // Memoria de una variable local (alloca) de `function`
+    static bool isLocalMemory(llvm::Value *pointer, llvm::Function *function)
+    {
+        auto *alloca = llvm::dyn_cast<llvm::AllocaInst>(llvm::getUnderlyingObject(pointer));
+        return alloca && alloca->getFunction() == function;
+    }
+
+    // Bloque entre llaves: sus declaraciones dejan de existir al salir
+    void emitBlock(llvm::ArrayRef<EasyRustAST::Stmt *> statements)
+    {
+        symbols.pushScope();
+        emitStatements(statements);
+        symbols.popScope();
+    }
+
+    // Rama que nunca se ejecuta (if o while con condición constante): se
+    // genera en bloques sin predecesores para informar sus errores igual que
+    // si se ejecutara, y después se borra. Al volver, el punto de inserción
+    // es el de antes.
+    void emitDeadBlock(llvm::ArrayRef<EasyRustAST::Stmt *> statements)
+    {
+        if (statements.empty())
+            return;
+        IRBuilderBase::InsertPointGuard guard(*builder);
+        llvm::Function *function = builder->GetInsertBlock()->getParent();
+        llvm::BasicBlock *dead = llvm::BasicBlock::Create(context, "dead", function);
+        sealBlock(dead);
+        builder->SetInsertPoint(dead);
+        emitBlock(statements);
+
+        // Los bloques nuevos van al final de la función: son todos los de la rama
+        std::vector<llvm::BasicBlock *> blocks;
+        for (auto it = dead->getIterator(); it != function->end(); ++it)
+            blocks.push_back(&*it);
+        for (llvm::BasicBlock *block : blocks)
+        {
+            currentDef.erase(block);
+            incompletePhis.erase(block);
+            sealedBlocks.erase(block);
+            block->dropAllReferences();
+        }
+        for (llvm::BasicBlock *block : blocks)
+            block->eraseFromParent();
+    }
+
+    void emitStatements(llvm::ArrayRef<EasyRustAST::Stmt *> statements)
+    {
+        for (const EasyRustAST::Stmt *stmt : statements)
         {
-            return visit(ctx->printStmt());
+            // Código después de un return: no hay bloque donde insertarlo
+            if (builder->GetInsertBlock()->getTerminator())
+                break;
+            emitStatement(stmt);
         }
-        else if (ctx->forLoop())
+    }
+
+    void emitStatement(const EasyRustAST::Stmt *stmt)
+    {
+        using namespace EasyRustAST;
+        switch (stmt->kind)
+        {
+        case StmtKind::VarDecl:
+            emitVariableDecl(cast<VarDeclStmt>(stmt));
+            return;
+        case StmtKind::Assign:
+            emitAssignment(cast<AssignStmt>(stmt));
+            return;
+        case StmtKind::IndexAssign:
+            emitIndexAssignment(cast<IndexAssignStmt>(stmt));
+            return;
+        case StmtKind::Function:
+            emitFunctionDecl(cast<FunctionDecl>(stmt));
+            return;
+        case StmtKind::Print:
+            emitPrint(cast<PrintStmt>(stmt));
+            return;
+        case StmtKind::For:
+            emitForLoop(cast<ForStmt>(stmt));
+            return;
+        case StmtKind::While:
+            emitWhileLoop(cast<WhileStmt>(stmt));
+            return;
+        case StmtKind::If:
+            emitIf(cast<IfStmt>(stmt));
+            return;
+        case StmtKind::Expr:
+            emitExpr(cast<ExprStmt>(stmt)->expr);
+            return;
+        case StmtKind::Return:
+            emitReturn(cast<ReturnStmt>(stmt));
+            return;
+        case StmtKind::Block:
+            emitBlock(cast<BlockStmt>(stmt)->body);
+            return;
+        case StmtKind::Import:
+            // Los módulos importados los compila y enlaza EasyRustCompiler
+            if (builder->GetInsertBlock()->getParent()->getName() != "main")
+                reportError() << "import solo se permite en el nivel superior (línea " << stmt->loc.line
+                             << ")\n";
+            return;
+        }
+        reportError() << "Tipo de statement no reconocido\n";
+    }
+
+    void emitVariableDecl(const EasyRustAST::VarDeclStmt *decl)
+    {
+        ER_TRACE_SCOPE(Codegen, "emitVariableDecl");
+        llvm::StringRef varName = nameOf(decl->name);
+        ER_TRACE(Codegen, 2, "Variable identificada: " << varName);
+        ER_TRACE(Types, 2, "Tipo lógico: " << decl->type.spelling);
+
+        llvm::Type *llvmType = getLLVMType(decl->type);
+        if (!llvmType)
         {
-            return visit(ctx->forLoop());
+            reportError() << "Tipo no soportado para la variable '" << varName.str() << "'\n";
+            return;
         }
-        else if (ctx->whileLoop())
+
+        // Un arreglo fijo inicializado con un literal en main (fuera de los
+        // bucles) no escapa de la función y puede ir en la pila
+        bool onStack = false;
+        if (decl->type.isFixedArray() && loopDepth == 0 &&
+            builder->GetInsertBlock()->getParent()->getName() == "main")
         {
-            return visit(ctx->whileLoop());
+            llvm::Type *element = runtime->arrayElementType(llvmType);
+            onStack = decl->type.arrayLength <= MaxStackArray / runtime->elementSize(element);
         }
-        else if (ctx->variableDecl())
+        Value *exprValue = emitInitializer(decl->init, decl->type, onStack);
+        if (!exprValue)
         {
-            return visit(ctx->variableDecl());
+            reportError() << "La expresión inicial de '" << varName << "' no produjo un valor\n";
+            return;
         }
-        else if (ctx->exprStmt())
+
+        exprValue = convertForStore(decl->type.kind, exprValue, "");
+        if (!exprValue || exprValue->getType() != llvmType)
         {
-            return visit(ctx->exprStmt());
+            reportError() << "Tipo incompatible para la variable '" << varName.str() << "'\n";
+            return;
         }
-        else if (ctx->ifStmt())
+        if (!checkArrayLength(decl->type, exprValue, varName))
+            return;
+
+        declareLocal(decl->name, decl->type, llvmType, exprValue);
+    }
+
+    // Valor para una variable de tipo `type`: los literales de arreglo toman
+    // el tipo de elemento declarado ([0; n] en un [float] es de floats)
+    llvm::Value *emitInitializer(const EasyRustAST::Expr *expr, const EasyRustAST::TypeSpec &type, bool onStack)
+    {
+        if (type.kind == EasyRustAST::TypeKind::Array &&
+            (llvm::isa<EasyRustAST::ArrayRepeatExpr>(expr) || llvm::isa<EasyRustAST::ArrayListExpr>(expr)))
+            return emitArrayLiteral(expr, type.element, onStack ? type.arrayLength : -1);
+        return emitExpr(expr);
+    }
+
+    // Un arreglo guardado en una variable `[T; N]` debe tener N elementos:
+    // se comprueba al compilar si la longitud es constante y si no al ejecutar
+    bool checkArrayLength(const EasyRustAST::TypeSpec &type, llvm::Value *array, llvm::StringRef varName)
+    {
+        if (!type.isFixedArray())
+            return true;
+        llvm::Value *length = runtime->arrayLength(*builder, array);
+        if (auto *constant = llvm::dyn_cast<llvm::ConstantInt>(length))
+        {
+            if (constant->getSExtValue() == type.arrayLength)
+                return true;
+            reportError() << "'" << varName << "' es de tipo " << type.spelling << " y el arreglo tiene "
+                         << constant->getSExtValue() << " elementos\n";
+            return false;
+        }
+        llvm::Value *expected = builder->getInt64(type.arrayLength);
+        emitCheck(builder->CreateICmpEQ(length, expected),
+                  "Error: se esperaban %lld elementos y el arreglo tiene %lld\n", expected, length);
+        return true;
+    }
+
+    // Chequeo en tiempo de ejecución (easyrust_panic si falla); el código sigue en el bloque "ok"
+    void emitCheck(llvm::Value *ok, llvm::StringRef format, llvm::Value *a, llvm::Value *b)
+    {
+        llvm::BasicBlock *last = &builder->GetInsertBlock()->getParent()->back();
+        runtime->emitCheck(*builder, ok, format, a, b);
+        sealBlocksAfter(last);
+    }
+
+    // Los bloques que crea el runtime (chequeos, relleno de arreglos) ya
+    // tienen todos sus predecesores
+    void sealBlocksAfter(llvm::BasicBlock *last)
+    {
+        llvm::Function *function = last->getParent();
+        for (auto it = std::next(last->getIterator()); it != function->end(); ++it)
+            sealBlock(&*it);
+    }
+
+    // Reserva una variable en el bloque de entrada de la función actual, a
+    // continuación de los allocas anteriores: un `let` dentro de un bucle no
+    // hace crecer la pila en cada iteración y mem2reg puede promoverlo
+    llvm::AllocaInst *createEntryAlloca(llvm::Type *type, llvm::StringRef name)
+    {
+        llvm::Function *function = builder->GetInsertBlock()->getParent();
+        llvm::BasicBlock &entry = function->getEntryBlock();
+        llvm::AllocaInst *&last = lastAlloca[function];
+        IRBuilder<> entryBuilder(context);
+        if (last)
+            entryBuilder.SetInsertPoint(&entry, std::next(last->getIterator()));
+        else
+            entryBuilder.SetInsertPoint(&entry, entry.begin());
+        last = entryBuilder.CreateAlloca(type, nullptr, name);
+        return last;
+    }
+
+    // Declara una variable local con su valor inicial: en un alloca del
+    // bloque de entrada o, con SSA directo, como definición en el bloque actual
+    void declareLocal(EasyRustAST::Symbol name, const EasyRustAST::TypeSpec &type, llvm::Type *llvmType,
+                      llvm::Value *value)
+    {
+        if (!directSSA)
         {
-            return visit(ctx->ifStmt());
+            llvm::AllocaInst *alloc = createEntryAlloca(llvmType, nameOf(name));
+            builder->CreateStore(value, alloc);
+            symbols.declare(name, type, llvmType, alloc);
+            return;
         }
-        else if (ctx->returnStmt())
+        unsigned variable = symbols.declare(name, type, llvmType, nullptr);
+        if (variable >= variableTypes.size())
         {
-            return visit(ctx->returnStmt());
+            variableTypes.resize(variable + 1);
+            variableNames.resize(variable + 1);
         }
-        else if (ctx->assignmentStmt())
+        variableTypes[variable] = llvmType;
+        variableNames[variable] = nameOf(name).str();
+        writeVariable(variable, builder->GetInsertBlock(), value);
+    }
+
+    void storeLocal(const EasyRustSymbolTable::Entry &entry, llvm::Value *value)
+    {
+        if (entry.storage)
+            builder->CreateStore(value, entry.storage);
+        else
+            writeVariable(entry.variable, builder->GetInsertBlock(), value);
+    }
+
+    llvm::Value *loadLocal(const EasyRustSymbolTable::Entry &entry, llvm::StringRef name)
+    {
+        if (entry.storage)
+            return builder->CreateLoad(entry.llvmType, entry.storage, name);
+        return readVariable(entry.variable, builder->GetInsertBlock());
+    }
+
+    void writeVariable(unsigned variable, llvm::BasicBlock *block, llvm::Value *value)
+    {
+        currentDef[block][variable] = value;
+    }
+
+    llvm::Value *readVariable(unsigned variable, llvm::BasicBlock *block)
+    {
+        auto blockDefs = currentDef.find(block);
+        if (blockDefs != currentDef.end())
         {
-            return visit(ctx->assignmentStmt());
+            auto def = blockDefs->second.find(variable);
+            if (def != blockDefs->second.end() && def->second)
+                return def->second;
         }
-
-        llvm::errs() << "Error: Tipo de statement no reconocido\n";
-        return nullptr;
+        return readVariableRecursive(variable, block);
     }
 
-    std::any visitVariableDecl(EasyRustParser::VariableDeclContext *ctx) override
+    llvm::Value *readVariableRecursive(unsigned variable, llvm::BasicBlock *block)
     {
-        llvm::errs() << "Debug: Entrando a visitVariableDecl\n";
-        std::string varName = ctx->IDENTIFIER()->getText();
-        llvm::errs() << "Debug: Variable identificada: " << varName << "\n";
-        std::string logicalType = ctx->type()->getText(); // Obtiene el tipo lógico directamente de la gramática
-        llvm::errs() << "Debug: Tipo lógico: " << logicalType << "\n";
-        Value *exprValue = nullptr;
-        try
+        llvm::Value *value;
+        if (!sealedBlocks.count(block))
         {
-            exprValue = std::any_cast<Value *>(visit(ctx->expr()));
+            // Faltan predecesores: la phi se completa al sellar el bloque
+            llvm::PHINode *phi = createPhi(variable, block);
+            incompletePhis[block].push_back({variable, phi});
+            value = phi;
         }
-        catch (const std::bad_any_cast &e)
+        else if (llvm::BasicBlock *pred = block->getSinglePredecessor())
         {
-            llvm::errs() << "Error: std::bad_any_cast en visitVariableDecl al procesar expr: "
-                         << ctx->expr()->getText() << "\n";
-            llvm::errs() << "Excepción: " << e.what() << "\n";
-            return nullptr;
+            value = readVariable(variable, pred);
         }
-
-        if (!exprValue)
+        else if (llvm::pred_empty(block))
         {
-            llvm::errs() << "Error: visit(ctx->expr()) retornó nullptr para la expresión: "
-                         << ctx->expr()->getText() << "\n";
-            return nullptr;
+            // Código inalcanzable (por ejemplo después de un if cuyas ramas retornan)
+            value = llvm::PoisonValue::get(variableTypes[variable]);
         }
-        llvm::Type *llvmType = getLLVMTypeFromLogicalType(logicalType, context);
-        if (!llvmType)
+        else
         {
-            std::cerr << "Error: Tipo no soportado para la variable '" << varName << "'\n";
-            return nullptr;
+            // Se registra la phi antes de leer los predecesores para cortar los ciclos
+            llvm::PHINode *phi = createPhi(variable, block);
+            writeVariable(variable, block, phi);
+            value = addPhiOperands(variable, phi);
         }
+        writeVariable(variable, block, value);
+        return value;
+    }
+
+    llvm::PHINode *createPhi(unsigned variable, llvm::BasicBlock *block)
+    {
+        const std::string &name = variableNames[variable];
+        if (block->empty())
+            return llvm::PHINode::Create(variableTypes[variable], 0, name, block);
+        return llvm::PHINode::Create(variableTypes[variable], 0, name, &block->front());
+    }
 
-        // Validar que el tipo del valor coincide con el tipo lógico
-        if (logicalType == "int" && exprValue->getType()->isDoubleTy())
+    llvm::Value *addPhiOperands(unsigned variable, llvm::PHINode *phi)
+    {
+        for (llvm::BasicBlock *pred : llvm::predecessors(phi->getParent()))
+            phi->addIncoming(readVariable(variable, pred), pred);
+        return tryRemoveTrivialPhi(phi);
+    }
+
+    // Una phi cuyos operandos son todos el mismo valor (o ella misma) se
+    // reemplaza por ese valor; las phis que la usaban pueden volverse triviales
+    llvm::Value *tryRemoveTrivialPhi(llvm::PHINode *phi)
+    {
+        llvm::Value *same = nullptr;
+        for (llvm::Value *op : phi->incoming_values())
+        {
+            if (op == same || op == phi)
+                continue;
+            if (same)
+                return phi; // Junta al menos dos valores
+            same = op;
+        }
+        if (!same)
+            same = llvm::PoisonValue::get(phi->getType());
+
+        llvm::SmallVector<llvm::WeakVH, 8> phiUsers;
+        for (llvm::User *user : phi->users())
+            if (user != phi && llvm::isa<llvm::PHINode>(user))
+                phiUsers.push_back(user);
+        phi->replaceAllUsesWith(same); // También actualiza currentDef (WeakTrackingVH)
+        phi->eraseFromParent();
+
+        for (llvm::WeakVH &user : phiUsers)
+            if (auto *userPhi = llvm::dyn_cast_or_null<llvm::PHINode>(user))
+                tryRemoveTrivialPhi(userPhi);
+        return same;
+    }
+
+    // Todos los predecesores de `block` ya existen: completar sus phis pendientes
+    void sealBlock(llvm::BasicBlock *block)
+    {
+        if (!directSSA)
+            return;
+        sealedBlocks.insert(block);
+        auto pending = incompletePhis.find(block);
+        if (pending == incompletePhis.end())
+            return;
+        std::vector<std::pair<unsigned, llvm::PHINode *>> phis = std::move(pending->second);
+        incompletePhis.erase(pending);
+        for (auto &[variable, phi] : phis)
+            addPhiOperands(variable, phi);
+    }
+
+    // Conversión implícita int <-> float al guardar en una variable de tipo
+    // `type`; nullptr si el valor no es compatible
+    llvm::Value *convertForStore(EasyRustAST::TypeKind type, llvm::Value *value, const char *reason)
+    {
+        using EasyRustAST::TypeKind;
+        if (type == TypeKind::Int && value->getType()->isDoubleTy())
         {
-            llvm::errs() << "Debug: Convertir double a int\n";
-            exprValue = builder->CreateFPToSI(exprValue, llvm::Type::getInt32Ty(context), "double_to_int");
+            ER_TRACE(Types, 2, "Convertir double a int" << reason);
+            return builder->CreateFPToSI(value, llvm::Type::getInt32Ty(context), "double_to_int");
         }
-        else if (logicalType == "float" && exprValue->getType()->isIntegerTy(32))
+        if (type == TypeKind::Float && value->getType()->isIntegerTy(32))
         {
-            llvm::errs() << "Debug: Convertir int a float\n";
-            exprValue = builder->CreateSIToFP(exprValue, llvm::Type::getDoubleTy(context), "int_to_double");
+            ER_TRACE(Types, 2, "Convertir int a float" << reason);
+            return builder->CreateSIToFP(value, llvm::Type::getDoubleTy(context), "int_to_double");
         }
-        else if ((logicalType == "int" && !exprValue->getType()->isIntegerTy(32)) ||
-                 (logicalType == "float" && !exprValue->getType()->isDoubleTy()))
-        {
-            std::cerr << "Error: Tipo incompatible para la variable '" << varName << "'\n";
+        if ((type == TypeKind::Int && !value->getType()->isIntegerTy(32)) ||
+            (type == TypeKind::Float && !value->getType()->isDoubleTy()))
             return nullptr;
-        }
-
-        AllocaInst *alloc = builder->CreateAlloca(llvmType, 0, varName.c_str());
-        builder->CreateStore(exprValue, alloc);
-
-        symbolTable[varName] = {llvmType, logicalType, alloc};
-        return exprValue;
+        return value;
     }
 
-    std::any visitFunctionDecl(EasyRustParser::FunctionDeclContext *ctx) override
+    // Primera pasada: el prototipo de cada función declarada (también las
+    // anidadas en bloques), así una llamada puede preceder a la definición y
+    // los cuerpos pueden generarse en cualquier orden
+    void declareFunctions(llvm::ArrayRef<EasyRustAST::Stmt *> statements)
     {
-        llvm::errs() << "Debug: Entrando a visitFunctionDecl\n";
+        using namespace EasyRustAST;
+        for (const Stmt *stmt : statements)
+        {
+            if (const auto *decl = llvm::dyn_cast<FunctionDecl>(stmt))
+            {
+                declareFunction(decl);
+                declareFunctions(decl->body);
+            }
+            else if (const auto *loop = llvm::dyn_cast<ForStmt>(stmt))
+                declareFunctions(loop->body);
+            else if (const auto *loop = llvm::dyn_cast<WhileStmt>(stmt))
+                declareFunctions(loop->body);
+            else if (const auto *ifStmt = llvm::dyn_cast<IfStmt>(stmt))
+            {
+                declareFunctions(ifStmt->thenBody);
+                declareFunctions(ifStmt->elseBody);
+            }
+            else if (const auto *block = llvm::dyn_cast<BlockStmt>(stmt))
+                declareFunctions(block->body);
+        }
+    }
 
-        std::string funcName = ctx->IDENTIFIER()->getText();
-        std::string returnTypeStr = ctx->type()->getText();
-        llvm::Type *returnType = getLLVMTypeFromLogicalType(returnTypeStr, context);
+    void declareFunction(const EasyRustAST::FunctionDecl *decl)
+    {
+        std::string funcName = nameOf(decl->name).str();
+        if (importedFunctions.contains(funcName))
+        {
+            reportError() << "La función " << funcName << " ya está definida en un módulo importado\n";
+            return;
+        }
+        if (functionsBySymbol[decl->name.id])
+        {
+            reportError() << "La función " << funcName << " ya está definida (línea " << decl->loc.line
+                         << ")\n";
+            return;
+        }
 
+        llvm::Type *returnType = getLLVMType(decl->returnType);
         if (!returnType)
         {
-            llvm::errs() << "Error: Tipo de retorno no soportado para la función " << funcName << "\n";
-            return nullptr;
+            reportError() << "Tipo de retorno no soportado para la función " << funcName << "\n";
+            return;
         }
 
         // Crear el tipo de función
         std::vector<llvm::Type *> paramTypes;
-        if (ctx->parameters())
+        for (const EasyRustAST::Param &param : decl->params)
         {
-            for (auto &paramCtx : ctx->parameters()->parameter())
+            llvm::Type *paramType = getLLVMType(param.type);
+            if (!paramType)
             {
-                std::string paramTypeStr = paramCtx->type()->getText();
-                llvm::Type *paramType = getLLVMTypeFromLogicalType(paramTypeStr, context);
-                if (!paramType)
-                {
-                    llvm::errs() << "Error: Tipo de parámetro no soportado en la función " << funcName << "\n";
-                    return nullptr;
-                }
-                paramTypes.push_back(paramType);
+                reportError() << "Tipo de parámetro no soportado en la función " << funcName << "\n";
+                return;
             }
+            paramTypes.push_back(paramType);
         }
 
         llvm::FunctionType *funcType = llvm::FunctionType::get(returnType, paramTypes, false);
         llvm::Function *function = llvm::Function::Create(
             funcType, llvm::Function::ExternalLinkage, funcName, module.get());
+        userFunctions.push_back(funcName);
+        functionsBySymbol[decl->name.id] = function;
+        functionDecls[decl->name.id] = decl;
+        applySourceAttributes(function, decl->attributes);
+    }
+
+    void emitFunctionDecl(const EasyRustAST::FunctionDecl *decl)
+    {
+        ER_TRACE_SCOPE(Codegen, "emitFunctionDecl");
+
+        // Sin prototipo o redefinida: el error ya se reportó en declareFunction
+        llvm::Function *function = functionsBySymbol[decl->name.id];
+        if (!function || functionDecls[decl->name.id] != decl)
+            return;
+        std::string funcName = function->getName().str();
+        llvm::Type *returnType = function->getReturnType();
+
+        // Al terminar se vuelve al punto de inserción de quien declaró la función
+        IRBuilderBase::InsertPointGuard guard(*builder);
 
         // Crear el bloque de entrada
         llvm::BasicBlock *entryBlock = llvm::BasicBlock::Create(context, "entry", function);
         builder->SetInsertPoint(entryBlock);
+        sealBlock(entryBlock);
 
-        // Registrar parámetros en la tabla de símbolos
+        // Registrar parámetros en un ámbito propio de la función
+        symbols.pushFunction();
+        unsigned outerLoopDepth = loopDepth;
+        loopDepth = 0;
         auto paramIt = function->arg_begin();
-        if (ctx->parameters())
+        for (const EasyRustAST::Param &param : decl->params)
         {
-            for (auto &paramCtx : ctx->parameters()->parameter())
-            {
-                std::string paramName = paramCtx->IDENTIFIER()->getText();
-                paramIt->setName(paramName);
+            llvm::StringRef paramName = nameOf(param.name);
+            paramIt->setName(paramName);
 
-                // Reservar espacio para el parámetro en la pila
-                llvm::AllocaInst *alloc = builder->CreateAlloca(paramIt->getType(), nullptr, paramName.c_str());
-                builder->CreateStore(&(*paramIt), alloc);
-                symbolTable[paramName] = {paramIt->getType(), paramCtx->type()->getText(), alloc};
-                paramIt++;
-            }
+            // Reservar espacio para el parámetro en la pila (o usarlo directamente con SSA)
+            checkArrayLength(param.type, &(*paramIt), paramName);
+            declareLocal(param.name, param.type, paramIt->getType(), &(*paramIt));
+            paramIt++;
         }
-        llvm::errs() << "Debug: Parámetros registrados para la función " << funcName << "\n";
+        ER_TRACE(Calls, 2, "Parámetros registrados para la función " << funcName);
 
-        // Visitar las instrucciones en el cuerpo de la función
-        for (auto &stmtCtx : ctx->statement())
-        {
-            visit(stmtCtx);
-        }
+        // Generar las instrucciones del cuerpo de la función
+        emitStatements(decl->body);
+        symbols.popFunction();
+        loopDepth = outerLoopDepth;
 
         // Si la función es void, agrega un retorno explícito
         if (returnType->isVoidTy() && !builder->GetInsertBlock()->getTerminator())
@@ -325,22 +1022,17 @@ public:
         }
 
         llvm::verifyFunction(*function);
-        return nullptr;
     }
 
-    std::any visitReturnStmt(EasyRustParser::ReturnStmtContext *ctx) override
+    void emitReturn(const EasyRustAST::ReturnStmt *ret)
     {
-        llvm::errs() << "Debug: Entrando a visitReturnStmt\n";
+        ER_TRACE_SCOPE(Codegen, "emitReturn");
 
-        llvm::Value *returnValue = nullptr;
-        if (ctx->expr())
+        llvm::Value *returnValue = emitExpr(ret->value);
+        if (!returnValue)
         {
-            returnValue = std::any_cast<llvm::Value *>(visit(ctx->expr()));
-            if (!returnValue)
-            {
-                llvm::errs() << "Error: Valor de retorno inválido\n";
-                return nullptr;
-            }
+            reportError() << "Valor de retorno inválido\n";
+            return;
         }
 
         // Verificar el tipo de retorno de la función actual
@@ -349,8 +1041,8 @@ public:
 
         if (returnType->isVoidTy())
         {
-            llvm::errs() << "Error: Función con tipo de retorno void no puede retornar un valor\n";
-            return nullptr;
+            reportError() << "Función con tipo de retorno void no puede retornar un valor\n";
+            return;
         }
 
         if (returnValue->getType() != returnType)
@@ -358,108 +1050,252 @@ public:
             // Convertir el tipo de retorno si es necesario
             if (returnType->isDoubleTy() && returnValue->getType()->isIntegerTy())
             {
-                llvm::errs() << "Debug: Convertir int a double para el retorno\n";
+                ER_TRACE(Types, 2, "Convertir int a double para el retorno");
                 returnValue = builder->CreateSIToFP(returnValue, Type::getDoubleTy(context), "int_to_double_ret");
             }
             else if (returnType->isIntegerTy() && returnValue->getType()->isDoubleTy())
             {
-                llvm::errs() << "Debug: Convertir double a int para el retorno\n";
+                ER_TRACE(Types, 2, "Convertir double a int para el retorno");
                 returnValue = builder->CreateFPToSI(returnValue, Type::getInt32Ty(context), "double_to_int_ret");
             }
             else
             {
-                llvm::errs() << "Error: Tipos de retorno incompatibles\n";
-                return nullptr;
+                reportError() << "Tipos de retorno incompatibles\n";
+                return;
             }
         }
 
         // Emitir la instrucción de retorno
         builder->CreateRet(returnValue);
-        return nullptr;
     }
 
-    std::any visitParameters(EasyRustParser::ParametersContext *ctx) override
+    void emitPrint(const EasyRustAST::PrintStmt *print)
     {
-        llvm::errs() << "Debug: Entrando a visitParameters\n";
-        return visitChildren(ctx);
-    }
+        ER_TRACE_SCOPE(Codegen, "emitPrint");
 
-    std::any visitParameter(EasyRustParser::ParameterContext *ctx) override
-    {
-        llvm::errs() << "Debug: Entrando a visitParameter\n";
-        return visitChildren(ctx);
+        // Evalúa la expresión
+        llvm::Value *exprValue = emitExpr(print->value);
+        if (!exprValue)
+        {
+            reportError() << "exprValue es nullptr en print en línea "
+                      << print->loc.line << ", columna " << print->loc.column << "\n";
+            return;
+        }
+
+        // Escritor del runtime según el tipo (los enteros ya no pasan por double)
+        ER_TRACE(Types, 2, "Imprimiendo valor de tipo " << *exprValue->getType());
+        if (!runtime->emitPrint(*builder, exprValue))
+            reportError() << "Tipo no soportado para impresión\n";
     }
 
-    std::any visitPrintStmt(EasyRustParser::PrintStmtContext *ctx) override
+    void emitForLoop(const EasyRustAST::ForStmt *loop)
     {
-        llvm::errs() << "Debug: Entrando a visitPrintStmt\n";
-
-        // Evalúa la expresión
-        llvm::Value *exprValue = std::any_cast<llvm::Value *>(visit(ctx->expr()));
-        if (!exprValue)
+        ER_TRACE_SCOPE(Codegen, "emitForLoop");
+
+        // for i = init; (cond); i++ { cuerpo } en forma canónica:
+        //   (bloque actual = preheader) -> for.cond -> for.body -> for.inc -> for.cond
+        //                                     \-> for.exit
+        // for.cond es la cabecera (una sola phi de inducción después de
+        // mem2reg o con --ssa) y for.inc el único latch. El incremento es nsw
+        // para que SCEV pueda calcular el número de iteraciones.
+        llvm::Value *initValue = emitExpr(loop->init);
+        if (!initValue)
+        {
+            reportError() << "Valor inicial inválido en for\n";
+            return;
+        }
+        EasyRustAST::TypeKind varType;
+        if (initValue->getType()->isIntegerTy(32))
+            varType = EasyRustAST::TypeKind::Int;
+        else if (initValue->getType()->isDoubleTy())
+            varType = EasyRustAST::TypeKind::Float;
+        else
         {
-            auto token = ctx->getStart();
-            std::cerr << "Error: exprValue es nullptr en visitPrintStmt en línea "
-                      << token->getLine() << ", columna " << token->getCharPositionInLine() << "\n";
-            return std::any();
+            reportError() << "La variable de un for debe ser int o float\n";
+            return;
         }
 
-        // Determina el formato basado en el tipo lógico
-        llvm::Value *formatStr = nullptr;
+        // La variable del for solo existe dentro del bucle
+        symbols.pushScope();
+        declareLocal(loop->var, {varType, EasyRustAST::typeKindName(varType)}, initValue->getType(), initValue);
+        bool hasRange = analyzeRange(loop);
 
-        // Identifica el tipo de la expresión
-        llvm::Type *exprType = exprValue->getType();
-        if (exprType->isIntegerTy())
+        llvm::Function *currentFunction = builder->GetInsertBlock()->getParent();
+        llvm::BasicBlock *condBlock = llvm::BasicBlock::Create(context, "for.cond", currentFunction);
+        llvm::BasicBlock *bodyBlock = llvm::BasicBlock::Create(context, "for.body", currentFunction);
+        llvm::BasicBlock *incBlock = llvm::BasicBlock::Create(context, "for.inc", currentFunction);
+        llvm::BasicBlock *exitBlock = llvm::BasicBlock::Create(context, "for.exit", currentFunction);
+        builder->CreateBr(condBlock);
+
+        builder->SetInsertPoint(condBlock);
+        llvm::Value *condValue = emitCondition(loop->cond);
+        if (!condValue)
         {
-            // Si es un entero
-            llvm::errs() << "Debug: Expresión es un entero\n";
-            exprValue = builder->CreateSIToFP(exprValue, llvm::Type::getDoubleTy(context), "int_to_double");
-            formatStr = builder->CreateGlobalString("%lf\n", "fmt");
+            reportError() << "Condición no válida en for\n";
+            condValue = ConstantInt::getFalse(context);
         }
-        else if (exprType->isDoubleTy())
+        builder->CreateCondBr(condValue, bodyBlock, exitBlock);
+        sealBlock(bodyBlock);
+        sealBlock(exitBlock);
+
+        builder->SetInsertPoint(bodyBlock);
+        loopDepth++;
+        emitBlock(loop->body);
+        loopDepth--;
+        if (hasRange)
+            safeRanges.pop_back();
+        if (!builder->GetInsertBlock()->getTerminator())
+            builder->CreateBr(incBlock);
+
+        if (llvm::pred_empty(incBlock))
         {
-            // Si es un flotante
-            llvm::errs() << "Debug: Expresión es un flotante\n";
-            formatStr = builder->CreateGlobalString("%lf\n", "fmt");
+            // El cuerpo siempre retorna: no hay vuelta atrás
+            incBlock->eraseFromParent();
         }
-        else if (exprType->isPointerTy())
+        else
         {
-            // Si es una cadena
-            llvm::errs() << "Debug: Expresión es una cadena\n";
-            formatStr = builder->CreateGlobalString("%s\n", "fmt");
+            sealBlock(incBlock);
+            builder->SetInsertPoint(incBlock);
+            emitIncrement(loop->stepVar);
+            builder->CreateBr(condBlock);
         }
+        sealBlock(condBlock);
+        symbols.popScope();
+
+        builder->SetInsertPoint(exitBlock);
+    }
+
+    // `var++` del for: suma 1 (nsw en enteros) a la variable indicada
+    void emitIncrement(EasyRustAST::Symbol var)
+    {
+        const EasyRustSymbolTable::Entry *found = symbols.lookup(var);
+        if (!found)
+        {
+            reportError() << "Variable '" << nameOf(var).str() << "' no está definida\n";
+            return;
+        }
+        EasyRustSymbolTable::Entry entry = *found;
+        llvm::Value *current = loadLocal(entry, nameOf(var));
+        llvm::Value *next;
+        if (entry.type.kind == EasyRustAST::TypeKind::Int)
+            next = builder->CreateNSWAdd(current, llvm::ConstantInt::get(current->getType(), 1), "inc");
+        else if (entry.type.kind == EasyRustAST::TypeKind::Float)
+            next = builder->CreateFAdd(current, llvm::ConstantFP::get(current->getType(), 1.0), "inc");
         else
         {
-            llvm::errs() << "Error: Tipo no soportado para impresión\n";
-            return std::any();
+            reportError() << "'" << nameOf(var).str() << "++' requiere una variable int o float\n";
+            return;
         }
+        storeLocal(entry, next);
+    }
 
-        // Crea la llamada a printf
-        std::vector<llvm::Value *> printfArgs = {formatStr, exprValue};
-        builder->CreateCall(printfFunc, printfArgs, "printf_call");
+    // Registra el rango seguro del índice de un for (ver SafeRange); false si
+    // el bucle no tiene la forma `for i = c; (i < límite); i++`
+    bool analyzeRange(const EasyRustAST::ForStmt *loop)
+    {
+        using namespace EasyRustAST;
+        const auto *init = llvm::dyn_cast<NumberExpr>(loop->init);
+        const auto *index = llvm::dyn_cast<IdentifierExpr>(loop->cond->lhs);
+        if (!init || init->isFloat || init->intValue < 0 || loop->stepVar.id != loop->var.id || !index ||
+            index->name.id != loop->var.id || assigns(loop->body, loop->var))
+            return false;
+
+        SafeRange range{symbols.lookup(loop->var)->variable, -1, -1};
+        llvm::StringRef op = loop->cond->op;
+        if (const auto *limit = llvm::dyn_cast<NumberExpr>(loop->cond->rhs))
+        {
+            if (limit->isFloat || (op != "<" && op != "<="))
+                return false;
+            range.bound = op == "<=" ? limit->intValue + 1 : limit->intValue;
+        }
+        else if (const auto *call = llvm::dyn_cast<CallExpr>(loop->cond->rhs))
+        {
+            if (op != "<" || nameOf(call->callee) != "len" || functionsBySymbol[call->callee.id] ||
+                call->args.size() != 1)
+                return false;
+            const auto *array = llvm::dyn_cast<IdentifierExpr>(call->args[0]);
+            const EasyRustSymbolTable::Entry *entry = array ? symbols.lookup(array->name) : nullptr;
+            if (!entry || entry->type.kind != TypeKind::Array)
+                return false;
+            // Un arreglo fijo no cambia de longitud aunque se le asigne otro
+            if (entry->type.isFixedArray())
+                range.bound = entry->type.arrayLength;
+            else if (assigns(loop->body, array->name))
+                return false;
+            range.arrayVariable = static_cast<int>(entry->variable);
+        }
+        else
+            return false;
 
-        return std::any();
+        ER_TRACE(Codegen, 2, "Rango seguro para '" << nameOf(loop->var) << "' (límite " << range.bound << ")");
+        safeRanges.push_back(range);
+        return true;
+    }
+
+    // ¿Alguna sentencia (fuera de funciones anidadas) asigna `symbol`?
+    static bool assigns(llvm::ArrayRef<EasyRustAST::Stmt *> body, EasyRustAST::Symbol symbol)
+    {
+        using namespace EasyRustAST;
+        for (const Stmt *stmt : body)
+        {
+            if (const auto *assign = llvm::dyn_cast<AssignStmt>(stmt))
+            {
+                if (assign->name.id == symbol.id)
+                    return true;
+            }
+            else if (const auto *loop = llvm::dyn_cast<ForStmt>(stmt))
+            {
+                if (loop->stepVar.id == symbol.id || assigns(loop->body, symbol))
+                    return true;
+            }
+            else if (const auto *loop = llvm::dyn_cast<WhileStmt>(stmt))
+            {
+                if (assigns(loop->body, symbol))
+                    return true;
+            }
+            else if (const auto *ifStmt = llvm::dyn_cast<IfStmt>(stmt))
+            {
+                if (assigns(ifStmt->thenBody, symbol) || assigns(ifStmt->elseBody, symbol))
+                    return true;
+            }
+            else if (const auto *block = llvm::dyn_cast<BlockStmt>(stmt))
+            {
+                if (assigns(block->body, symbol))
+                    return true;
+            }
+        }
+        return false;
     }
 
-    std::any visitForLoop(EasyRustParser::ForLoopContext *ctx) override
+    // array[index] no necesita chequeo si `index` es la variable de un for
+    // cuyo rango cabe en el arreglo
+    bool isCheckRedundant(const EasyRustSymbolTable::Entry &array, const EasyRustAST::Expr *index) const
     {
-        llvm::errs() << "Debug: Entrando a visitForLoop\n";
-        return visitChildren(ctx);
+        const auto *id = llvm::dyn_cast<EasyRustAST::IdentifierExpr>(index);
+        const EasyRustSymbolTable::Entry *entry = id ? symbols.lookup(id->name) : nullptr;
+        if (!entry)
+            return false;
+        for (const SafeRange &range : safeRanges)
+        {
+            if (range.indexVariable != entry->variable)
+                continue;
+            if (range.arrayVariable == static_cast<int>(array.variable))
+                return true;
+            if (array.type.isFixedArray() && range.bound >= 0 && array.type.arrayLength >= range.bound)
+                return true;
+        }
+        return false;
     }
 
-    std::any visitWhileLoop(EasyRustParser::WhileLoopContext *ctx) override
+    void emitWhileLoop(const EasyRustAST::WhileStmt *loop)
     {
-        llvm::errs() << "Debug: Entrando a visitWhileLoop\n";
+        ER_TRACE_SCOPE(Codegen, "emitWhileLoop");
 
         // Crear los bloques básicos necesarios
         llvm::Function *currentFunction = builder->GetInsertBlock()->getParent();
 
         // Bloque de condición
         llvm::BasicBlock *condBlock = llvm::BasicBlock::Create(context, "while.cond", currentFunction);
-        // Bloque del cuerpo del bucle
-        llvm::BasicBlock *bodyBlock = llvm::BasicBlock::Create(context, "while.body", currentFunction);
-        // Bloque de salida
-        llvm::BasicBlock *exitBlock = llvm::BasicBlock::Create(context, "while.exit", currentFunction);
 
         // Crear salto incondicional al bloque de condición
         builder->CreateBr(condBlock);
@@ -468,102 +1304,151 @@ public:
         builder->SetInsertPoint(condBlock);
 
         // Evaluar la condición
-        llvm::Value *condValue = std::any_cast<llvm::Value *>(visit(ctx->condition()));
+        llvm::Value *condValue = emitCondition(loop->cond);
         if (!condValue)
         {
-            llvm::errs() << "Error: Condición no válida en while\n";
-            return nullptr;
+            reportError() << "Condición no válida en while\n";
+            condValue = ConstantInt::getFalse(context);
         }
 
+        // Un while que nunca entra: el cuerpo se revisa pero no se genera
+        if (auto *constant = llvm::dyn_cast<llvm::ConstantInt>(condValue); constant && constant->isZero())
+        {
+            sealBlock(condBlock);
+            emitDeadBlock(loop->body);
+            return;
+        }
+
+        // Bloque del cuerpo del bucle
+        llvm::BasicBlock *bodyBlock = llvm::BasicBlock::Create(context, "while.body", currentFunction);
+        // Bloque de salida
+        llvm::BasicBlock *exitBlock = llvm::BasicBlock::Create(context, "while.exit", currentFunction);
+
         // Crear salto condicional basado en la condición
         builder->CreateCondBr(condValue, bodyBlock, exitBlock);
+        sealBlock(bodyBlock);
+        sealBlock(exitBlock);
 
         // Insertar en el bloque del cuerpo
         builder->SetInsertPoint(bodyBlock);
 
-        // Visitar las declaraciones dentro del cuerpo del bucle
-        for (auto stmt : ctx->statement())
-        {
-            visit(stmt);
-        }
+        // Generar las declaraciones dentro del cuerpo del bucle
+        loopDepth++;
+        emitBlock(loop->body);
+        loopDepth--;
 
         // Salto de regreso al bloque de condición
-        builder->CreateBr(condBlock);
+        if (!builder->GetInsertBlock()->getTerminator())
+            builder->CreateBr(condBlock);
+        sealBlock(condBlock); // Ya existe el salto de regreso
 
         // Insertar en el bloque de salida
         builder->SetInsertPoint(exitBlock);
-
-        return nullptr;
     }
-    std::any visitAssignmentStmt(EasyRustParser::AssignmentStmtContext *ctx)
+
+    void emitAssignment(const EasyRustAST::AssignStmt *assign)
     {
-        llvm::errs() << "Debug: Entrando a visitAssignmentStmt\n";
+        ER_TRACE_SCOPE(Codegen, "emitAssignment");
 
         // Obtener el nombre de la variable
-        std::string varName = ctx->IDENTIFIER()->getText();
-        llvm::errs() << "Debug: Asignando a variable: " << varName << "\n";
+        llvm::StringRef varName = nameOf(assign->name);
+        ER_TRACE(Codegen, 2, "Asignando a variable: " << varName);
 
-        // Verificar que la variable esté definida en la tabla de símbolos
-        if (symbolTable.find(varName) == symbolTable.end())
+        // Verificar que la variable esté definida en el ámbito actual
+        const EasyRustSymbolTable::Entry *found = symbols.lookup(assign->name);
+        if (!found)
         {
-            std::cerr << "Error: Variable '" << varName << "' no está definida\n";
-            return nullptr;
+            reportError() << "Variable '" << varName.str() << "' no está definida\n";
+            return;
         }
-
-        // Obtener la información de la variable desde la tabla de símbolos
-        auto &symbolInfo = symbolTable[varName];
-        llvm::Type *varType = symbolInfo.type;
-        const std::string &logicalType = symbolInfo.logicalType;
+        EasyRustSymbolTable::Entry symbolInfo = *found;
 
         // Evaluar la expresión del lado derecho
-        llvm::Value *exprValue = std::any_cast<llvm::Value *>(visit(ctx->expr()));
+        llvm::Value *exprValue = emitInitializer(assign->value, symbolInfo.type, false);
         if (!exprValue)
         {
-            llvm::errs() << "Error: Valor inválido en la asignación a '" << varName << "'\n";
-            return nullptr;
+            reportError() << "Valor inválido en la asignación a '" << varName << "'\n";
+            return;
         }
 
         // Validar que el tipo del valor coincide con el tipo de la variable
-        if (logicalType == "int" && exprValue->getType()->isDoubleTy())
+        exprValue = convertForStore(symbolInfo.type.kind, exprValue, " para asignación");
+        if (!exprValue || exprValue->getType() != symbolInfo.llvmType)
         {
-            llvm::errs() << "Debug: Convertir double a int para asignación\n";
-            exprValue = builder->CreateFPToSI(exprValue, llvm::Type::getInt32Ty(context), "double_to_int");
-        }
-        else if (logicalType == "float" && exprValue->getType()->isIntegerTy(32))
-        {
-            llvm::errs() << "Debug: Convertir int a float para asignación\n";
-            exprValue = builder->CreateSIToFP(exprValue, llvm::Type::getDoubleTy(context), "int_to_double");
-        }
-        else if ((logicalType == "int" && !exprValue->getType()->isIntegerTy(32)) ||
-                 (logicalType == "float" && !exprValue->getType()->isDoubleTy()))
-        {
-            std::cerr << "Error: Tipo incompatible en la asignación a '" << varName << "'\n";
-            return nullptr;
+            reportError() << "Tipo incompatible en la asignación a '" << varName.str() << "'\n";
+            return;
         }
+        if (!checkArrayLength(symbolInfo.type, exprValue, varName))
+            return;
 
         // Actualizar el valor de la variable
-        builder->CreateStore(exprValue, symbolInfo.llvmValue);
+        storeLocal(symbolInfo, exprValue);
 
-        llvm::errs() << "Debug: Asignación completada para variable: " << varName << "\n";
-        return nullptr;
+        ER_TRACE(Codegen, 2, "Asignación completada para variable: " << varName);
     }
 
-    std::any visitExprStmt(EasyRustParser::ExprStmtContext *ctx) override
+    void emitIndexAssignment(const EasyRustAST::IndexAssignStmt *assign)
     {
-        llvm::errs() << "Debug: Entrando a visitExprStmt\n";
-        return visitChildren(ctx);
+        ER_TRACE_SCOPE(Codegen, "emitIndexAssignment");
+
+        llvm::StringRef varName = nameOf(assign->array);
+        const EasyRustSymbolTable::Entry *found = symbols.lookup(assign->array);
+        if (!found)
+        {
+            reportError() << "Variable '" << varName.str() << "' no está definida\n";
+            return;
+        }
+        EasyRustSymbolTable::Entry symbolInfo = *found;
+
+        llvm::Value *array = loadLocal(symbolInfo, varName);
+        llvm::Value *position = emitExpr(assign->index);
+        llvm::Value *exprValue = emitExpr(assign->value);
+        if (!position || !exprValue)
+        {
+            reportError() << "Valor inválido en la asignación a '" << varName << "[...]'\n";
+            return;
+        }
+        llvm::Value *element =
+            emitElementPointer(array, position, !isCheckRedundant(symbolInfo, assign->index), varName);
+        if (!element)
+            return;
+
+        exprValue = convertForStore(symbolInfo.type.element, exprValue, " para el elemento");
+        if (!exprValue || exprValue->getType() != runtime->arrayElementType(array->getType()))
+        {
+            reportError() << "Tipo incompatible en la asignación a '" << varName.str() << "[...]'\n";
+            return;
+        }
+        builder->CreateStore(exprValue, element);
     }
 
-    std::any visitIfStmt(EasyRustParser::IfStmtContext *ctx) override
+    void emitIf(const EasyRustAST::IfStmt *ifStmt)
     {
-        llvm::errs() << "Debug: Entrando a visitIfStmt\n";
+        ER_TRACE_SCOPE(Codegen, "emitIf");
 
         // Generar la condición
-        Value *condValue = std::any_cast<Value *>(visit(ctx->condition()));
+        Value *condValue = emitCondition(ifStmt->cond);
         if (!condValue)
         {
-            llvm::errs() << "Error: Condición no válida en if\n";
-            return nullptr;
+            reportError() << "Condición no válida en if\n";
+            return;
+        }
+
+        // Condición constante: solo se genera la rama elegida; la otra se
+        // revisa (en el orden del código fuente) y se descarta
+        if (auto *constant = llvm::dyn_cast<llvm::ConstantInt>(condValue))
+        {
+            if (constant->isOne())
+            {
+                emitBlock(ifStmt->thenBody);
+                emitDeadBlock(ifStmt->elseBody);
+            }
+            else
+            {
+                emitDeadBlock(ifStmt->thenBody);
+                emitBlock(ifStmt->elseBody);
+            }
+            return;
         }
 
         // Crear los bloques básicos para "then", "else" y "merge"
@@ -573,7 +1458,7 @@ public:
         BasicBlock *elseBlock = nullptr;
         BasicBlock *mergeBlock = BasicBlock::Create(context, "merge", currentFunction);
 
-        if (ctx->statement(1)) // Si existe un bloque "else"
+        if (ifStmt->hasElse) // Si existe un bloque "else"
         {
             elseBlock = BasicBlock::Create(context, "else", currentFunction);
         }
@@ -587,361 +1472,476 @@ public:
         {
             builder->CreateCondBr(condValue, thenBlock, mergeBlock);
         }
+        sealBlock(thenBlock);
+        if (elseBlock)
+            sealBlock(elseBlock);
 
-        // Emitir código para el bloque "then"
+        // Emitir código para el bloque "then" (si termina en return no salta a merge)
         builder->SetInsertPoint(thenBlock);
-        visit(ctx->statement(0)); // Visitar las declaraciones del bloque "then"
-        builder->CreateBr(mergeBlock);
+        emitBlock(ifStmt->thenBody);
+        if (!builder->GetInsertBlock()->getTerminator())
+            builder->CreateBr(mergeBlock);
 
         // Emitir código para el bloque "else" (si existe)
         if (elseBlock)
         {
             builder->SetInsertPoint(elseBlock);
-            visit(ctx->statement(1)); // Visitar las declaraciones del bloque "else"
-            builder->CreateBr(mergeBlock);
+            emitBlock(ifStmt->elseBody);
+            if (!builder->GetInsertBlock()->getTerminator())
+                builder->CreateBr(mergeBlock);
         }
 
         // Continuar en el bloque "merge"
+        sealBlock(mergeBlock);
         builder->SetInsertPoint(mergeBlock);
+    }
 
+    llvm::Value *emitExpr(const EasyRustAST::Expr *expr)
+    {
+        using namespace EasyRustAST;
+        switch (expr->kind)
+        {
+        case ExprKind::Call:
+            return emitCall(cast<CallExpr>(expr));
+        case ExprKind::Identifier:
+            return emitIdentifier(cast<IdentifierExpr>(expr));
+        case ExprKind::Binary:
+            return emitBinary(cast<BinaryExpr>(expr));
+        case ExprKind::Number:
+            return emitNumber(cast<NumberExpr>(expr));
+        case ExprKind::Boolean:
+            return ConstantInt::get(Type::getInt1Ty(context), cast<BooleanExpr>(expr)->value);
+        case ExprKind::String:
+            return emitString(cast<StringExpr>(expr));
+        case ExprKind::Index:
+            return emitIndex(cast<IndexExpr>(expr));
+        case ExprKind::ArrayRepeat:
+        case ExprKind::ArrayList:
+            return emitArrayLiteral(expr, TypeKind::Unknown, -1);
+        }
         return nullptr;
     }
 
-    std::any visitMulDiv(EasyRustParser::MulDivContext *ctx) override
+    llvm::Value *emitBinary(const EasyRustAST::BinaryExpr *binary)
     {
-        llvm::errs() << "Debug: Entrando a visitMulDiv\n";
-        // Visitar las expresiones izquierda y derecha
-        llvm::Value *left = std::any_cast<llvm::Value *>(visit(ctx->expr(0)));
-        llvm::Value *right = std::any_cast<llvm::Value *>(visit(ctx->expr(1)));
+        ER_TRACE_SCOPE(Codegen, "emitBinary");
+        if (binary->op == '+')
+            return emitAddChain(binary);
 
-        // Obtener el operador
-        std::string op = ctx->op->getText();
+        // Generar las expresiones izquierda y derecha
+        llvm::Value *left = emitExpr(binary->lhs);
+        llvm::Value *right = emitExpr(binary->rhs);
+        if (!left || !right)
+        {
+            reportError() << "Operandos inválidos para '" << binary->op << "'\n";
+            return nullptr;
+        }
+        if (binary->op == '*' || binary->op == '/')
+            return emitMulDiv(binary->op, left, right);
+        return emitAddSub(binary->op, left, right);
+    }
 
+    llvm::Value *emitMulDiv(char op, llvm::Value *left, llvm::Value *right)
+    {
         // Determinar el tipo de los operandos
         if (left->getType()->isIntegerTy() && right->getType()->isIntegerTy())
         {
-            if (op == "*")
+            if (op == '*')
             {
-                llvm::errs() << "Debug: Realizando Mul (Entero)\n";
+                ER_TRACE(Codegen, 2, "Realizando Mul (Entero)");
                 return builder->CreateMul(left, right, "multmp");
             }
-            else if (op == "/")
-            {
-                llvm::errs() << "Debug: Realizando SDiv (Entero)\n";
-                return builder->CreateSDiv(left, right, "divtmp");
-            }
+            ER_TRACE(Codegen, 2, "Realizando SDiv (Entero)");
+            return builder->CreateSDiv(left, right, "divtmp");
         }
         else if (left->getType()->isDoubleTy() && right->getType()->isDoubleTy())
         {
-            if (op == "*")
+            if (op == '*')
             {
-                llvm::errs() << "Debug: Realizando FMul (Flotante)\n";
+                ER_TRACE(Codegen, 2, "Realizando FMul (Flotante)");
                 return builder->CreateFMul(left, right, "fmultmp");
             }
-            else if (op == "/")
+            ER_TRACE(Codegen, 2, "Realizando FDiv (Flotante)");
+            return builder->CreateFDiv(left, right, "fdivtmp");
+        }
+
+        reportError() << "Tipos incompatibles para MulDiv\n";
+        return nullptr;
+    }
+
+    // a + b + c se parsea como ((a + b) + c): se aplana la cadena de sumas
+    // para que una concatenación de varias cadenas sea una sola reserva. Con
+    // números se suma de izquierda a derecha, igual que el árbol original.
+    llvm::Value *emitAddChain(const EasyRustAST::BinaryExpr *binary)
+    {
+        std::vector<const EasyRustAST::Expr *> operands;
+        const EasyRustAST::Expr *node = binary;
+        while (const auto *add = llvm::dyn_cast<EasyRustAST::BinaryExpr>(node))
+        {
+            if (add->op != '+')
+                break;
+            operands.push_back(add->rhs);
+            node = add->lhs;
+        }
+        operands.push_back(node);
+        std::reverse(operands.begin(), operands.end());
+
+        std::vector<llvm::Value *> values;
+        bool allStrings = true;
+        for (const EasyRustAST::Expr *operand : operands)
+        {
+            llvm::Value *value = emitExpr(operand);
+            if (!value)
             {
-                llvm::errs() << "Debug: Realizando FDiv (Flotante)\n";
-                return builder->CreateFDiv(left, right, "fdivtmp");
+                reportError() << "Operandos inválidos para '+'\n";
+                return nullptr;
             }
+            allStrings = allStrings && runtime->isString(value);
+            values.push_back(value);
         }
-        else
+        if (allStrings)
         {
-            llvm::errs() << "Error: Tipos incompatibles para MulDiv\n";
-            return nullptr;
+            ER_TRACE(Codegen, 2, "Realizando concatenación de " << values.size() << " cadenas");
+            return runtime->concat(*builder, values);
         }
 
-        llvm::errs() << "Error: Operador no soportado en MulDiv: " << op << "\n";
-        return nullptr;
+        llvm::Value *result = values[0];
+        for (size_t i = 1; i < values.size() && result; i++)
+            result = emitAddSub('+', result, values[i]);
+        return result;
     }
-    llvm::Value *concatenateStrings(llvm::Value *left, llvm::Value *right)
-    {
-        llvm::errs() << "Debug: Entrando a concatenateStrings\n";
-
-        // Asume que `left` y `right` son punteros a cadenas válidos
-        llvm::Value *leftLen = builder->CreateCall(
-            module->getOrInsertFunction("strlen", llvm::FunctionType::get(
-                                                      llvm::Type::getInt64Ty(context),
-                                                      {llvm::PointerType::getUnqual(context)},
-                                                      false)),
-            {left},
-            "strlen_left");
-
-        llvm::Value *rightLen = builder->CreateCall(
-            module->getOrInsertFunction("strlen", llvm::FunctionType::get(
-                                                      llvm::Type::getInt64Ty(context),
-                                                      {llvm::PointerType::getUnqual(context)},
-                                                      false)),
-            {right},
-            "strlen_right");
-
-        // Calcular la longitud total (strlen(left) + strlen(right) + 1 para el terminador)
-        llvm::Value *totalLen = builder->CreateAdd(
-            leftLen,
-            builder->CreateAdd(rightLen, llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), 1)),
-            "total_len");
-
-        // Allocar espacio para la cadena concatenada
-        llvm::Value *resultBuffer = builder->CreateAlloca(
-            llvm::ArrayType::get(llvm::Type::getInt8Ty(context), 1024),
-            nullptr,
-            "result_buffer");
-
-        // Crear llamada a `sprintf` para concatenar las cadenas
-        llvm::Value *formatStr = builder->CreateGlobalString("%s%s", "fmt");
-        builder->CreateCall(
-            module->getOrInsertFunction(
-                "sprintf",
-                llvm::FunctionType::get(
-                    llvm::Type::getInt32Ty(context),
-                    {llvm::PointerType::getUnqual(context), llvm::PointerType::getUnqual(context),
-                     llvm::PointerType::getUnqual(context), llvm::PointerType::getUnqual(context)},
-                    true)),
-            {resultBuffer, formatStr, left, right});
-
-        // Retorna el puntero al resultado
-        return resultBuffer;
-    }
-
-    std::any visitAddSub(EasyRustParser::AddSubContext *ctx) override
-    {
-        llvm::errs() << "Debug: Entrando a visitAddSub\n";
-        // Visitar las expresiones izquierda y derecha
-        llvm::Value *left = std::any_cast<llvm::Value *>(visit(ctx->expr(0)));
-        llvm::Value *right = std::any_cast<llvm::Value *>(visit(ctx->expr(1)));
-
-        // Obtener el operador
-        std::string op = ctx->op->getText();
 
+    llvm::Value *emitAddSub(char op, llvm::Value *left, llvm::Value *right)
+    {
         // Determinar el tipo de los operandos
         if (left->getType()->isIntegerTy() && right->getType()->isIntegerTy())
         {
-            if (op == "+")
+            if (op == '+')
             {
-                llvm::errs() << "Debug: Realizando Add (Entero)\n";
+                ER_TRACE(Codegen, 2, "Realizando Add (Entero)");
                 return builder->CreateAdd(left, right, "addtmp");
             }
-            else if (op == "-")
-            {
-                llvm::errs() << "Debug: Realizando Sub (Entero)\n";
-                return builder->CreateSub(left, right, "subtmp");
-            }
+            ER_TRACE(Codegen, 2, "Realizando Sub (Entero)");
+            return builder->CreateSub(left, right, "subtmp");
         }
         else if (left->getType()->isDoubleTy() && right->getType()->isDoubleTy())
         {
-            if (op == "+")
+            if (op == '+')
             {
-                llvm::errs() << "Debug: Realizando FAdd (Flotante)\n";
+                ER_TRACE(Codegen, 2, "Realizando FAdd (Flotante)");
                 return builder->CreateFAdd(left, right, "faddtmp");
             }
-            else if (op == "-")
-            {
-                llvm::errs() << "Debug: Realizando FSub (Flotante)\n";
-                return builder->CreateFSub(left, right, "fsubtmp");
-            }
+            ER_TRACE(Codegen, 2, "Realizando FSub (Flotante)");
+            return builder->CreateFSub(left, right, "fsubtmp");
         }
-        else if (left->getType()->isPointerTy() && right->getType()->isPointerTy())
+        else if (runtime->isString(left) && runtime->isString(right) && op == '+')
         {
-            llvm::PointerType *leftPtrType = llvm::dyn_cast<llvm::PointerType>(left->getType());
-            llvm::PointerType *rightPtrType = llvm::dyn_cast<llvm::PointerType>(right->getType());
-
-            if (leftPtrType && rightPtrType && op == "+")
-            {
-                llvm::errs() << "Debug: Realizando concatenación de cadenas\n";
-                return concatenateStrings(left, right);
-            }
+            ER_TRACE(Codegen, 2, "Realizando concatenación de cadenas");
+            return runtime->concat(*builder, {left, right});
         }
 
-        llvm::errs() << "Error: Operador no soportado en AddSub: " << op << "\n";
+        reportError() << "Operador no soportado en AddSub: " << op << "\n";
         return nullptr;
     }
 
-    std::any visitParens(EasyRustParser::ParensContext *ctx) override
+    llvm::Value *emitString(const EasyRustAST::StringExpr *str)
     {
-        llvm::errs() << "Debug: Entrando a visitParens\n";
-        return visit(ctx->expr());
+        ER_TRACE(Codegen, 2, "Literal de cadena procesado: " << str->value);
+
+        // Constante {literal global, longitud}
+        return runtime->stringLiteral(str->value);
     }
 
-    std::any visitString(EasyRustParser::StringContext *ctx) override
+    llvm::Value *emitIdentifier(const EasyRustAST::IdentifierExpr *id)
     {
-        llvm::errs() << "Debug: Entrando a visitString\n";
-        // Obtén el texto del literal de cadena (sin las comillas)
-        std::string stringValue = ctx->getText();
-        if (stringValue.front() == '"' && stringValue.back() == '"')
+        ER_TRACE_SCOPE(Codegen, "emitIdentifier");
+        const EasyRustSymbolTable::Entry *symbolInfo = symbols.lookup(id->name);
+        if (!symbolInfo)
         {
-            stringValue = stringValue.substr(1, stringValue.size() - 2); // Elimina las comillas
+            // Si la variable no está definida, muestra un error
+            reportError() << "Variable no definida: " << nameOf(id->name)
+                   << " en línea " << id->loc.line
+                   << ", columna " << id->loc.column << "\n";
+            return nullptr;
         }
+        ER_TRACE(Types, 2, "Variable '" << nameOf(id->name) << "' tiene tipo " << symbolInfo->type.spelling);
 
-        llvm::errs() << "Debug: Literal de cadena procesado: " << stringValue << "\n";
-
-        // Crea un GlobalStringPtr para el literal
-        Value *stringPtr = builder->CreateGlobalString(stringValue, "string_literal");
-
-        // Retorna el puntero a la cadena
-        return stringPtr;
+        // Carga el valor de la variable desde la memoria (las cadenas son punteros a char)
+        return loadLocal(*symbolInfo, nameOf(id->name));
     }
 
-    std::any visitIdentifier(EasyRustParser::IdentifierContext *ctx) override
+    llvm::Value *emitNumber(const EasyRustAST::NumberExpr *number)
     {
-        llvm::errs() << "Debug: Entrando a visitIdentifier\n";
-        std::string varName = ctx->IDENTIFIER()->getText();
-        if (symbolTable.find(varName) == symbolTable.end())
+        if (number->isFloat)
         {
-            // Si la variable no está definida, muestra un error
-            auto token = ctx->getStart();
-            errs() << "Error: Variable no definida: " << varName
-                   << " en línea " << token->getLine()
-                   << ", columna " << token->getCharPositionInLine() << "\n";
-            return nullptr;
+            // Número con punto decimal => double
+            ER_TRACE(Codegen, 2, "Procesando número flotante: " << number->text);
+            return llvm::ConstantFP::get(context, llvm::APFloat(number->floatValue));
         }
+        // Número entero => int
+        ER_TRACE(Codegen, 2, "Procesando número entero: " << number->text);
+        return llvm::ConstantInt::get(llvm::Type::getInt32Ty(context), number->intValue, true);
+    }
 
-        // Obtén la información de la tabla de símbolos
-        auto &symbolInfo = symbolTable[varName];
-        Type *varType = symbolInfo.type;
-        const std::string &logicalType = symbolInfo.logicalType;
-        llvm::errs() << "Debug: Variable '" << varName
-                     << "' tiene logicalType: " << logicalType << "\n";
+    llvm::Value *emitCall(const EasyRustAST::CallExpr *call)
+    {
+        ER_TRACE_SCOPE(Calls, "emitCall");
 
-        // Carga el valor de la variable desde la memoria
-        Value *value = builder->CreateLoad(varType, symbolInfo.llvmValue, varName.c_str());
+        llvm::StringRef funcName = nameOf(call->callee);
+        llvm::Function *function = functionsBySymbol[call->callee.id];
+        if (!function)
+            function = module->getFunction(funcName); // Declaraciones externas (exp, printf)
+        if (!function && funcName == "len" && call->args.size() == 1)
+            return emitLen(call->args[0]);
 
-        // Manejo adicional para booleanos y cadenas
-        if (logicalType == "bool")
-        {
-            // Convertir a booleano si es necesario (i1 ya está representado como booleano en LLVM)
-            llvm::errs() << "Debug: Variable es un booleano\n";
-        }
-        else if (logicalType == "string")
+        if (!function)
         {
-            // Manejar cadenas (char pointers)
-            llvm::errs() << "Debug: Variable es una cadena\n";
-            // Retorna directamente el puntero a la cadena
-            return value;
+            reportError() << "Función no definida: " << funcName << "\n";
+            return nullptr;
         }
-        else if (logicalType == "int")
+
+        // Procesar argumentos
+        std::vector<llvm::Value *> args;
+        for (const EasyRustAST::Expr *arg : call->args)
         {
-            llvm::errs() << "Debug: Variable es un entero\n";
+            llvm::Value *argValue = emitExpr(arg);
+            if (!argValue)
+            {
+                reportError() << "Argumento inválido en la llamada a " << funcName << "\n";
+                return nullptr;
+            }
+            args.push_back(argValue);
         }
-        else if (logicalType == "float")
+        if (args.size() != function->arg_size())
         {
-            llvm::errs() << "Debug: Variable es un flotante\n";
+            reportError() << "La función " << funcName << " espera " << function->arg_size()
+                         << " argumentos y recibió " << args.size() << "\n";
+            return nullptr;
         }
-        else
+
+        ER_TRACE(Calls, 2, "Creando llamada a función " << funcName);
+
+        if (function->getReturnType()->isVoidTy())
         {
-            llvm::errs() << "Error: Tipo no soportado para la variable '" << varName << "'\n";
+            ER_TRACE(Calls, 2, "Retornando void");
+            builder->CreateCall(function, args);
             return nullptr;
         }
 
-        // Retornar el valor para tipos no string
-        return value;
+        ER_TRACE(Calls, 2, "Retornando otra cosa");
+        llvm::Value *callValue = builder->CreateCall(function, args, "calltmp");
+        ER_TRACE(Calls, 2, "Llamada a función creada exitosamente");
+        return callValue;
     }
 
-    std::any visitNumber(EasyRustParser::NumberContext *ctx) override
+    // [v; n] o [a, b, c]. Los elementos son contiguos; van en el heap salvo
+    // que `stackLength` (la longitud declarada) permita reservarlos en la pila.
+    llvm::Value *emitArrayLiteral(const EasyRustAST::Expr *expr, EasyRustAST::TypeKind elementKind,
+                                  int64_t stackLength)
     {
-        llvm::errs() << "Debug: Entrando a visitNumber\n";
-        std::string numText = ctx->NUMBER()->getText();
+        using namespace EasyRustAST;
+        ER_TRACE_SCOPE(Codegen, "emitArrayLiteral");
 
-        // Determina si el número es entero o flotante
-        if (numText.find('.') != std::string::npos)
+        std::vector<llvm::Value *> values;
+        llvm::Value *count;
+        if (const auto *list = llvm::dyn_cast<ArrayListExpr>(expr))
         {
-            // Número con punto decimal => double
-            llvm::errs() << "Debug: Procesando número flotante: " << numText << "\n";
-            auto numVal = std::stod(numText);
-            llvm::Value *val = llvm::ConstantFP::get(context, llvm::APFloat(numVal));
-            return std::any(val);
+            for (const Expr *element : list->elements)
+            {
+                llvm::Value *value = emitExpr(element);
+                if (!value)
+                {
+                    reportError() << "Elemento inválido en el arreglo\n";
+                    return nullptr;
+                }
+                values.push_back(value);
+            }
+            count = builder->getInt64(values.size());
         }
         else
         {
-            // Número entero => int
-            llvm::errs() << "Debug: Procesando número entero: " << numText << "\n";
-            auto numVal = std::stoi(numText);
-            llvm::Value *val = llvm::ConstantInt::get(llvm::Type::getInt32Ty(context), numVal);
-            return std::any(val);
+            const auto *repeat = llvm::cast<ArrayRepeatExpr>(expr);
+            llvm::Value *value = emitExpr(repeat->value);
+            llvm::Value *countValue = emitExpr(repeat->count);
+            if (!value || !countValue)
+            {
+                reportError() << "Valor inválido en [valor; cantidad]\n";
+                return nullptr;
+            }
+            if (!countValue->getType()->isIntegerTy(32))
+            {
+                reportError() << "La cantidad de elementos de un arreglo debe ser int\n";
+                return nullptr;
+            }
+            values.push_back(value);
+            count = builder->CreateSExt(countValue, builder->getInt64Ty(), "array.count");
+            emitCheck(builder->CreateICmpSGE(count, builder->getInt64(0)),
+                      "Error: cantidad de elementos negativa (%lld)\n", count, count);
         }
-    }
-
-    std::any visitBoolean(EasyRustParser::BooleanContext *ctx) override
-    {
-        llvm::errs() << "Debug: Entrando a visitBoolean\n";
-        return visitChildren(ctx);
-    }
 
-    std::any visitCallFunction(EasyRustParser::CallFunctionContext *ctx) override
-    {
-        llvm::errs() << "Debug: Entrando a visitCallFunction\n";
-
-        std::string funcName = ctx->functionCall()->IDENTIFIER()->getText();
-        llvm::Function *function = module->getFunction(funcName);
-
-        if (!function)
+        // Sin tipo declarado los elementos toman el tipo del primero
+        if (elementKind == TypeKind::Unknown)
         {
-            llvm::errs() << "Error: Función no definida: " << funcName << "\n";
+            if (values[0]->getType()->isIntegerTy(32))
+                elementKind = TypeKind::Int;
+            else if (values[0]->getType()->isDoubleTy())
+                elementKind = TypeKind::Float;
+        }
+        llvm::Type *elementType = elementKind == TypeKind::Unknown
+                                      ? values[0]->getType()
+                                      : getLLVMType({elementKind, typeKindName(elementKind)});
+        if (!elementType || runtime->arrayElementType(elementType))
+        {
+            reportError() << "Tipo de elemento no soportado en el arreglo\n";
             return nullptr;
         }
-
-        // Procesar argumentos
-        std::vector<llvm::Value *> args;
-        if (ctx->functionCall()->arguments())
+        for (llvm::Value *&value : values)
         {
-            for (auto &argCtx : ctx->functionCall()->arguments()->expr())
+            value = convertForStore(elementKind, value, " para el elemento");
+            if (!value || value->getType() != elementType)
             {
-                llvm::Value *argValue = std::any_cast<llvm::Value *>(visit(argCtx));
-                args.push_back(argValue);
+                reportError() << "Los elementos del arreglo deben ser del mismo tipo\n";
+                return nullptr;
             }
         }
 
-        llvm::errs() << "Debug: Creando llamada a función " << funcName << "\n";
+        llvm::Value *data;
+        auto *constantCount = llvm::dyn_cast<llvm::ConstantInt>(count);
+        if (stackLength >= 0 && constantCount && constantCount->getSExtValue() == stackLength)
+            data = createEntryAlloca(llvm::ArrayType::get(elementType, stackLength), "array");
+        else
+            data = runtime->allocateElements(*builder, elementType, count);
 
-        if (function->getReturnType()->isVoidTy())
+        if (llvm::isa<ArrayListExpr>(expr))
         {
-            llvm::errs() << "Debug: Retornando void\n";
-            builder->CreateCall(function, args);
-            return nullptr;
+            for (size_t i = 0; i < values.size(); i++)
+                builder->CreateStore(values[i],
+                                     builder->CreateConstInBoundsGEP1_64(elementType, data, i, "array.elem"));
         }
-        else
+        else if (auto *constant = llvm::dyn_cast<llvm::Constant>(values[0]); constant && constant->isNullValue())
         {
-            llvm::errs() << "Debug: Retornando otra cosa\n";
-            llvm::Value *callValue = builder->CreateCall(function, args, "calltmp");
+            llvm::Value *bytes = builder->CreateMul(count, builder->getInt64(runtime->elementSize(elementType)));
+            builder->CreateMemSet(data, builder->getInt8(0), bytes, llvm::MaybeAlign());
+        }
+        else
+            fillArray(elementType, data, count, values[0]);
 
-            if (!callValue)
-            {
-                llvm::errs() << "Error: CreateCall retornó nullptr para la función: " << funcName << "\n";
-                return nullptr;
-            }
+        return runtime->makeArray(*builder, runtime->getArrayType(elementType), data, count);
+    }
 
-            llvm::errs() << "Debug: Llamada a función creada exitosamente\n";
-            return callValue;
+    // data[0 .. count) = value
+    void fillArray(llvm::Type *elementType, llvm::Value *data, llvm::Value *count, llvm::Value *value)
+    {
+        llvm::Function *function = builder->GetInsertBlock()->getParent();
+        llvm::BasicBlock *last = &function->back();
+        llvm::BasicBlock *preheader = builder->GetInsertBlock();
+        llvm::BasicBlock *condBlock = llvm::BasicBlock::Create(context, "array.fill.cond", function);
+        llvm::BasicBlock *bodyBlock = llvm::BasicBlock::Create(context, "array.fill.body", function);
+        llvm::BasicBlock *exitBlock = llvm::BasicBlock::Create(context, "array.fill.exit", function);
+        builder->CreateBr(condBlock);
+
+        builder->SetInsertPoint(condBlock);
+        llvm::PHINode *index = builder->CreatePHI(builder->getInt64Ty(), 2, "fill.i");
+        index->addIncoming(builder->getInt64(0), preheader);
+        builder->CreateCondBr(builder->CreateICmpULT(index, count), bodyBlock, exitBlock);
+
+        builder->SetInsertPoint(bodyBlock);
+        builder->CreateStore(value, builder->CreateInBoundsGEP(elementType, data, index, "fill.elem"));
+        index->addIncoming(builder->CreateNUWAdd(index, builder->getInt64(1), "fill.next"), bodyBlock);
+        builder->CreateBr(condBlock);
+
+        builder->SetInsertPoint(exitBlock);
+        sealBlocksAfter(last);
+    }
+
+    // Dirección de array[index]; con `checked` se comprueba 0 <= index < longitud
+    llvm::Value *emitElementPointer(llvm::Value *array, llvm::Value *index, bool checked, llvm::StringRef name)
+    {
+        llvm::Type *elementType = runtime->arrayElementType(array->getType());
+        if (!elementType)
+        {
+            reportError() << "'" << name << "' no es un arreglo\n";
+            return nullptr;
         }
+        if (!index->getType()->isIntegerTy(32))
+        {
+            reportError() << "El índice de '" << name << "' debe ser int\n";
+            return nullptr;
+        }
+        // Un índice negativo se vuelve enorme al compararlo sin signo
+        llvm::Value *position = builder->CreateSExt(index, builder->getInt64Ty(), "idx");
+        if (checked)
+        {
+            llvm::Value *length = runtime->arrayLength(*builder, array);
+            emitCheck(builder->CreateICmpULT(position, length),
+                      "Error: índice %lld fuera de rango (longitud %lld)\n", position, length);
+        }
+        else
+            ER_TRACE(Codegen, 2, "Chequeo de rango eliminado en '" << name << "'");
+        return builder->CreateInBoundsGEP(elementType, runtime->arrayData(*builder, array), position, "elem");
     }
 
-    std::any visitFunctionCall(EasyRustParser::FunctionCallContext *ctx) override
+    llvm::Value *emitIndex(const EasyRustAST::IndexExpr *index)
     {
-        llvm::errs() << "Debug: Entrando a visitFunctionCall\n";
-        return visitChildren(ctx);
+        ER_TRACE_SCOPE(Codegen, "emitIndex");
+
+        llvm::Value *array = emitExpr(index->base);
+        llvm::Value *position = emitExpr(index->index);
+        if (!array || !position)
+        {
+            reportError() << "Operandos inválidos en el acceso a un arreglo\n";
+            return nullptr;
+        }
+        bool checked = true;
+        std::string name = "(expresión)";
+        if (const auto *id = llvm::dyn_cast<EasyRustAST::IdentifierExpr>(index->base))
+        {
+            name = nameOf(id->name).str();
+            if (const EasyRustSymbolTable::Entry *entry = symbols.lookup(id->name))
+                checked = !isCheckRedundant(*entry, index->index);
+        }
+        llvm::Value *element = emitElementPointer(array, position, checked, name);
+        if (!element)
+            return nullptr;
+        return builder->CreateLoad(runtime->arrayElementType(array->getType()), element, "elemval");
     }
 
-    std::any visitArguments(EasyRustParser::ArgumentsContext *ctx) override
+    // len(v): elementos de un arreglo o bytes de una cadena (si no hay una función len)
+    llvm::Value *emitLen(const EasyRustAST::Expr *arg)
     {
-        llvm::errs() << "Debug: Entrando a visitArguments\n";
-        return visitChildren(ctx);
+        llvm::Value *value = emitExpr(arg);
+        if (!value)
+            return nullptr;
+        llvm::Value *length;
+        if (runtime->arrayElementType(value->getType()))
+            length = runtime->arrayLength(*builder, value);
+        else if (runtime->isString(value))
+            length = runtime->length(*builder, value);
+        else
+        {
+            reportError() << "len requiere un arreglo o una cadena\n";
+            return nullptr;
+        }
+        return builder->CreateTrunc(length, builder->getInt32Ty(), "len");
     }
 
-    std::any visitCondition(EasyRustParser::ConditionContext *ctx) override
+    llvm::Value *emitCondition(const EasyRustAST::Condition *cond)
     {
-        llvm::errs() << "Debug: Entrando a visitCondition\n";
+        ER_TRACE_SCOPE(Codegen, "emitCondition");
 
-        // Visitar las expresiones izquierda y derecha
-        Value *lhs = std::any_cast<Value *>(visit(ctx->expr(0)));
-        Value *rhs = std::any_cast<Value *>(visit(ctx->expr(1)));
+        // Generar las expresiones izquierda y derecha
+        Value *lhs = emitExpr(cond->lhs);
+        Value *rhs = emitExpr(cond->rhs);
 
         if (!lhs || !rhs)
         {
-            llvm::errs() << "Error: Operandos inválidos en la condición\n";
+            reportError() << "Operandos inválidos en la condición\n";
             return nullptr;
         }
 
-        // Obtener el operador de comparación
-        std::string opText = ctx->comparisonOp()->getText();
-        llvm::errs() << "Debug: Operador de comparación detectado: " << opText << "\n";
+        // Operador de comparación
+        llvm::StringRef opText = cond->op;
+        ER_TRACE(Codegen, 2, "Operador de comparación detectado: " << opText);
 
         // Generar la instrucción LLVM correspondiente
         if (lhs->getType()->isIntegerTy())
@@ -961,7 +1961,7 @@ public:
                 pred = llvm::CmpInst::ICMP_SGE;
             else
             {
-                llvm::errs() << "Error: Operador de comparación desconocido: " << opText << "\n";
+                reportError() << "Operador de comparación desconocido: " << opText << "\n";
                 return nullptr;
             }
             return builder->CreateICmp(pred, lhs, rhs, "cmp");
@@ -983,32 +1983,13 @@ public:
                 pred = llvm::CmpInst::FCMP_OGE;
             else
             {
-                llvm::errs() << "Error: Operador de comparación desconocido: " << opText << "\n";
+                reportError() << "Operador de comparación desconocido: " << opText << "\n";
                 return nullptr;
             }
             return builder->CreateFCmp(pred, lhs, rhs, "cmp");
         }
 
-        llvm::errs() << "Error: Tipo no soportado para comparación\n";
+        reportError() << "Tipo no soportado para comparación\n";
         return nullptr;
     }
-
-    std::any visitComparisonOp(EasyRustParser::ComparisonOpContext *ctx) override
-    {
-        llvm::errs() << "Debug: Entrando a visitComparisonOp\n";
-
-        // Devuelve el texto del operador de comparación
-        std::string opText = ctx->getText();
-
-        llvm::errs() << "Debug: Operador de comparación: " << opText << "\n";
-
-        // Retorna el operador como texto para que otros visitantes puedan usarlo
-        return opText;
-    }
-
-    std::any visitType(EasyRustParser::TypeContext *ctx) override
-    {
-        llvm::errs() << "Debug: Entrando a visitType\n";
-        return visitChildren(ctx);
-    }
-};
\ No newline at end of file
+};
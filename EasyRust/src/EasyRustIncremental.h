@@ -0,0 +1,192 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+
+#include "EasyRustAST.h"
+#include "EasyRustCache.h"
+#include "EasyRustDriver.h"
+
+// Recompilación incremental por función (--incremental). main y cada función
+// de usuario se optimizan y compilan en su propio objeto dentro de
+// <base>.inc/, junto con un manifiesto de claves. La clave de una función es
+// su texto en el fuente más la firma (tipo y atributos inferidos) de cada
+// función de usuario que llama; si coincide con la de la compilación anterior
+// se reutiliza su objeto (cada función se extrae con EasyRustPartitioner).
+// Cada objeto solo ve declaraciones de las demás funciones de usuario, así
+// que no hay inlining entre ellas: editar el cuerpo de una función recompila
+// a quienes la llaman solo si cambian sus atributos.
+class EasyRustIncremental
+{
+public:
+    struct Entry
+    {
+        std::string key;
+        double ms = 0; // Optimización y backend de la última compilación
+    };
+
+private:
+    std::string directory;
+    std::map<std::string, Entry> previous; // Del manifiesto, por nombre de función
+    std::map<std::string, Entry> current;
+
+    std::string manifestPath() const
+    {
+        return directory + "/manifest";
+    }
+
+public:
+    explicit EasyRustIncremental(std::string directory) : directory(std::move(directory)) {}
+
+    const std::string &getDirectory() const
+    {
+        return directory;
+    }
+
+    std::string objectPath(const std::string &function) const
+    {
+        return directory + "/" + function + ".o";
+    }
+
+    // Lee el manifiesto de la compilación anterior (si existe); líneas "<clave> <ms> <función>"
+    bool load(std::string &error)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec)
+        {
+            error = "No se pudo crear el directorio " + directory + ": " + ec.message();
+            return false;
+        }
+        std::ifstream manifest(manifestPath());
+        std::string line;
+        while (std::getline(manifest, line))
+        {
+            std::istringstream fields(line);
+            std::string name;
+            Entry entry;
+            if (fields >> entry.key >> entry.ms >> name)
+                previous[name] = entry;
+        }
+        return true;
+    }
+
+    // Un objeto anterior sirve si su clave coincide y el archivo sigue ahí
+    const Entry *reusable(const std::string &function, const std::string &key) const
+    {
+        auto it = previous.find(function);
+        std::error_code ec;
+        if (it == previous.end() || it->second.key != key ||
+            !std::filesystem::is_regular_file(objectPath(function), ec))
+            return nullptr;
+        return &it->second;
+    }
+
+    void record(const std::string &function, const std::string &key, double ms)
+    {
+        current[function] = {key, ms};
+    }
+
+    // Antes de sobrescribir un objeto: si la compilación falla a medias, un
+    // manifiesto viejo podría dar por válido un objeto que ya no corresponde
+    void invalidate()
+    {
+        std::error_code ec;
+        std::filesystem::remove(manifestPath(), ec);
+    }
+
+    // Escribe el manifiesto y borra los objetos de funciones que ya no existen
+    bool save(std::string &error)
+    {
+        std::error_code ec;
+        for (const auto &file : std::filesystem::directory_iterator(directory, ec))
+        {
+            std::string stem = file.path().stem().string();
+            if (file.path().extension() == ".o" && !current.count(stem))
+                std::filesystem::remove(file.path(), ec);
+        }
+        std::ofstream manifest(manifestPath(), std::ios::trunc);
+        for (const auto &[name, entry] : current)
+            manifest << entry.key << " " << entry.ms << " " << name << "\n";
+        if (!manifest)
+        {
+            error = "No se pudo escribir " + manifestPath();
+            return false;
+        }
+        return true;
+    }
+
+    // Texto fuente de cada función declarada y, bajo "main", el resto del
+    // archivo (las sentencias de nivel superior). Los rangos del AST cuentan
+    // puntos de código, como el flujo de entrada de ANTLR, no bytes.
+    static std::map<std::string, std::string> sourceTexts(const EasyRustAST::Context &ast,
+                                                          const std::string &source)
+    {
+        std::vector<size_t> offsets; // Byte donde empieza cada punto de código
+        offsets.reserve(source.size() + 1);
+        for (size_t i = 0; i < source.size(); i++)
+            if ((static_cast<unsigned char>(source[i]) & 0xC0) != 0x80)
+                offsets.push_back(i);
+        offsets.push_back(source.size());
+        auto byteOffset = [&](unsigned index)
+        { return offsets[std::min<size_t>(index, offsets.size() - 1)]; };
+
+        std::map<std::string, std::string> texts;
+        std::string &mainText = texts["main"];
+        size_t position = 0;
+        for (const EasyRustAST::Stmt *stmt : ast.getProgram())
+        {
+            auto *function = llvm::dyn_cast<EasyRustAST::FunctionDecl>(stmt);
+            if (!function || function->sourceEnd <= function->sourceBegin)
+                continue;
+            size_t begin = byteOffset(function->sourceBegin), end = byteOffset(function->sourceEnd);
+            if (begin < position)
+                continue;
+            mainText.append(source, position, begin - position);
+            texts[ast.name(function->name).str()] = source.substr(begin, end - begin);
+            position = end;
+        }
+        mainText.append(source, position, std::string::npos);
+        return texts;
+    }
+
+    // Nombre, tipo y atributos: lo que el código de quien llama sabe de la función
+    static std::string signatureOf(const llvm::Function &function)
+    {
+        std::string signature;
+        llvm::raw_string_ostream os(signature);
+        os << function.getName() << " ";
+        function.getFunctionType()->print(os);
+        llvm::AttributeList attributes = function.getAttributes();
+        os << " " << attributes.getAsString(llvm::AttributeList::FunctionIndex) << " | "
+           << attributes.getAsString(llvm::AttributeList::ReturnIndex);
+        for (unsigned i = 0; i < function.arg_size(); i++)
+            os << " | " << attributes.getParamAttrs(i).getAsString();
+        os.flush();
+        return signature;
+    }
+
+    // Clave de `function`: su texto y las firmas de las funciones de usuario que llama
+    static std::string keyOf(const llvm::Function &function, const std::string &text, const std::string &settings,
+                             const std::string &target)
+    {
+        std::set<std::string> callees;
+        for (const llvm::Instruction &inst : llvm::instructions(function))
+            if (auto *call = llvm::dyn_cast<llvm::CallBase>(&inst))
+                if (const llvm::Function *callee = call->getCalledFunction();
+                    callee && EasyRustDriver::isUserFunction(*callee))
+                    callees.insert(signatureOf(*callee));
+        std::string dependencies = signatureOf(function);
+        for (const std::string &callee : callees)
+            dependencies += "\n" + callee;
+        return EasyRustCache::computeKey(text, settings + "|" + dependencies, target);
+    }
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Passes/OptimizationLevel.h"
+#include "llvm/Support/Error.h"
+
+#include "EasyRustBackend.h"
+#include "EasyRustOptimizer.h"
+
+// Ejecuta el programa en el mismo proceso con ORC LLJIT (modo --run), sin
+// generar objeto ni ejecutable.
+class EasyRustJIT
+{
+private:
+    std::unique_ptr<llvm::orc::LLJIT> jit;
+    std::unique_ptr<llvm::TargetMachine> targetMachine; // Solo para el PassBuilder
+    llvm::OptimizationLevel level = llvm::OptimizationLevel::O1;
+    std::string pipeline;
+
+    static llvm::CodeGenOptLevel toCodeGenLevel(llvm::OptimizationLevel level)
+    {
+        if (level == llvm::OptimizationLevel::O0)
+            return llvm::CodeGenOptLevel::None;
+        if (level == llvm::OptimizationLevel::O3)
+            return llvm::CodeGenOptLevel::Aggressive;
+        return llvm::CodeGenOptLevel::Default;
+    }
+
+public:
+    bool init(llvm::OptimizationLevel optLevel, const std::string &passPipeline, std::string &error)
+    {
+        EasyRustBackend::initializeTargets();
+        level = optLevel;
+        pipeline = passPipeline;
+
+        auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+        if (!jtmb)
+        {
+            error = llvm::toString(jtmb.takeError());
+            return false;
+        }
+        jtmb->setCodeGenOptLevel(toCodeGenLevel(level));
+
+        auto tm = jtmb->createTargetMachine();
+        if (!tm)
+        {
+            error = llvm::toString(tm.takeError());
+            return false;
+        }
+        targetMachine = std::move(*tm);
+
+        auto created = llvm::orc::LLJITBuilder().setJITTargetMachineBuilder(std::move(*jtmb)).create();
+        if (!created)
+        {
+            error = llvm::toString(created.takeError());
+            return false;
+        }
+        jit = std::move(*created);
+
+        // Resolver printf, strlen, exp, etc. con los símbolos del propio proceso
+        auto generator = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            jit->getDataLayout().getGlobalPrefix());
+        if (!generator)
+        {
+            error = llvm::toString(generator.takeError());
+            return false;
+        }
+        jit->getMainJITDylib().addGenerator(std::move(*generator));
+        return true;
+    }
+
+    llvm::orc::LLJIT &getLLJIT()
+    {
+        return *jit;
+    }
+
+    // Optimiza el módulo al nivel configurado y lo agrega al JIT
+    bool addModule(llvm::orc::ThreadSafeModule tsm, std::string &error)
+    {
+        bool ok = tsm.withModuleDo([&](llvm::Module &module)
+                                   {
+            module.setTargetTriple(jit->getTargetTriple().str());
+            module.setDataLayout(jit->getDataLayout());
+            EasyRustOptimizer optimizer(level, pipeline, targetMachine.get());
+            return optimizer.run(module, error); });
+        if (!ok)
+            return false;
+
+        if (llvm::Error err = jit->addIRModule(std::move(tsm)))
+        {
+            error = llvm::toString(std::move(err));
+            return false;
+        }
+        return true;
+    }
+
+    // Busca `main` (esto dispara la compilación) y retorna su dirección
+    bool lookupMain(int (*&mainPtr)(), std::string &error)
+    {
+        auto symbol = jit->lookup("main");
+        if (!symbol)
+        {
+            error = llvm::toString(symbol.takeError());
+            return false;
+        }
+        mainPtr = symbol->toPtr<int (*)()>();
+        return true;
+    }
+};
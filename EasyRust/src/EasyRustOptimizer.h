@@ -0,0 +1,138 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "llvm/Analysis/CGSCCPassManager.h"
+#include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassInstrumentation.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/OptimizationLevel.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/PGOOptions.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/IPO/HotColdSplitting.h"
+
+#include "EasyRustStats.h"
+
+// Ejecuta el pipeline de optimización de LLVM (nuevo pass manager) sobre el
+// módulo generado por EasyRustDriver, sin pasar por `opt` ni por IR textual.
+class EasyRustOptimizer
+{
+private:
+    llvm::OptimizationLevel level;
+    std::string pipeline;
+    llvm::TargetMachine *targetMachine;
+    EasyRustStats *stats;
+    std::optional<llvm::PGOOptions> pgo;
+
+    // Registra el tiempo de cada pase ejecutado (incluye el de los pases anidados)
+    static void registerPassTimers(llvm::PassInstrumentationCallbacks &PIC, EasyRustStats *stats,
+                                   std::vector<std::chrono::steady_clock::time_point> &starts)
+    {
+        PIC.registerBeforeNonSkippedPassCallback([&starts](llvm::StringRef, llvm::Any)
+                                                 { starts.push_back(std::chrono::steady_clock::now()); });
+        auto finish = [stats, &starts](llvm::StringRef pass)
+        {
+            if (starts.empty())
+                return;
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - starts.back()).count();
+            starts.pop_back();
+            stats->addPassTime(pass.str(), ms);
+        };
+        PIC.registerAfterPassCallback([finish](llvm::StringRef pass, llvm::Any, const llvm::PreservedAnalyses &)
+                                      { finish(pass); });
+        PIC.registerAfterPassInvalidatedCallback([finish](llvm::StringRef pass, const llvm::PreservedAnalyses &)
+                                                 { finish(pass); });
+    }
+
+public:
+    EasyRustOptimizer(llvm::OptimizationLevel level, std::string pipeline = "",
+                      llvm::TargetMachine *targetMachine = nullptr, EasyRustStats *stats = nullptr)
+        : level(level), pipeline(std::move(pipeline)), targetMachine(targetMachine), stats(stats) {}
+
+    // Compilación instrumentada: el ejecutable cuenta aristas y llamadas y el
+    // runtime de perfiles de compiler-rt escribe `rawProfile` al terminar
+    // (vacío => default.profraw; LLVM_PROFILE_FILE tiene prioridad)
+    void instrumentProfile(const std::string &rawProfile)
+    {
+        pgo = llvm::PGOOptions(rawProfile, "", "", "", llvm::vfs::getRealFileSystem(),
+                               llvm::PGOOptions::IRInstr);
+    }
+
+    // Compilación guiada por un perfil indexado (llvm-profdata merge): pesos
+    // de ramas, conteos de entrada para el inliner y división caliente/fría
+    void useProfile(const std::string &profile)
+    {
+        pgo = llvm::PGOOptions(profile, "", "", "", llvm::vfs::getRealFileSystem(),
+                               llvm::PGOOptions::IRUse);
+    }
+
+    // Optimiza el módulo en su lugar. Retorna false y llena `error` si el
+    // pipeline personalizado no se pudo interpretar o falta el perfil.
+    bool run(llvm::Module &module, std::string &error)
+    {
+        // Los pases de PGO solo existen en los pipelines por nivel
+        if (pgo && !pipeline.empty())
+        {
+            error = "los perfiles (PGO) no se pueden combinar con --passes";
+            return false;
+        }
+        if (pgo && pgo->Action == llvm::PGOOptions::IRUse && !llvm::sys::fs::exists(pgo->ProfileFile))
+        {
+            error = "no existe el perfil " + pgo->ProfileFile;
+            return false;
+        }
+
+        // Las callbacks deben vivir más que los analysis managers
+        llvm::PassInstrumentationCallbacks PIC;
+        std::vector<std::chrono::steady_clock::time_point> passStarts;
+        if (stats)
+            registerPassTimers(PIC, stats, passStarts);
+
+        llvm::LoopAnalysisManager LAM;
+        llvm::FunctionAnalysisManager FAM;
+        llvm::CGSCCAnalysisManager CGAM;
+        llvm::ModuleAnalysisManager MAM;
+
+        llvm::PassBuilder PB(targetMachine, llvm::PipelineTuningOptions(), pgo,
+                             stats ? &PIC : nullptr);
+        // Con un perfil, los bloques que nunca se ejecutaron salen a funciones
+        // frías (.text.unlikely) y el código caliente queda contiguo
+        if (pgo && pgo->Action == llvm::PGOOptions::IRUse && level != llvm::OptimizationLevel::O0)
+            PB.registerOptimizerLastEPCallback([](llvm::ModulePassManager &MPM, llvm::OptimizationLevel)
+                                               { MPM.addPass(llvm::HotColdSplittingPass()); });
+        PB.registerModuleAnalyses(MAM);
+        PB.registerCGSCCAnalyses(CGAM);
+        PB.registerFunctionAnalyses(FAM);
+        PB.registerLoopAnalyses(LAM);
+        PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+        llvm::ModulePassManager MPM;
+        if (!pipeline.empty())
+        {
+            if (llvm::Error err = PB.parsePassPipeline(MPM, pipeline))
+            {
+                error = llvm::toString(std::move(err));
+                return false;
+            }
+        }
+        else if (level == llvm::OptimizationLevel::O0)
+        {
+            MPM = PB.buildO0DefaultPipeline(level);
+        }
+        else
+        {
+            MPM = PB.buildPerModuleDefaultPipeline(level);
+        }
+
+        MPM.run(module, MAM);
+        return true;
+    }
+};
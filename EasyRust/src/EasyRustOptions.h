@@ -0,0 +1,393 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "llvm/Passes/OptimizationLevel.h"
+
+#include "EasyRustTrace.h"
+
+// Opciones de línea de comandos del compilador
+struct EasyRustOptions
+{
+    std::vector<std::string> inputFiles;                           // Archivos o directorios; vacío => stdin
+    unsigned jobs = 0;                                             // -j<n>; 0 => std::thread::hardware_concurrency()
+    llvm::OptimizationLevel optLevel = llvm::OptimizationLevel::O1; // Nivel por defecto (antes: opt -O1)
+    std::string optLevelName = "O1";
+    std::string passPipeline; // Pipeline personalizado (--passes=...), reemplaza al nivel
+    bool directSSA = false;   // --ssa: generar valores SSA directamente, sin allocas por variable
+    bool foldConstants = true; // --no-fold: no plegar ni propagar constantes en el AST
+    bool internalLinkage = false; // Programa completo (ejecutable o --run): funciones de usuario internas
+    bool profileGenerate = false; // --profile-generate[=<archivo>]: ejecutable instrumentado (PGO)
+    std::string profileOutput;    // Perfil crudo que escribe el ejecutable; vacío => <base>.profraw
+    std::string profileUse;       // --profile-use=<archivo.profdata>: optimizar con el perfil combinado
+    bool thinLTO = false;         // --lto=thin: con import, optimizar cada módulo por separado
+    bool incremental = false;     // --incremental: un objeto por función en <base>.inc/, reutilizados si no cambian
+    unsigned partitions = 1;      // --partitions=<n>: optimizar y compilar el módulo en n partes en paralelo
+    unsigned codegenThreads = 1;  // --codegen-threads=<n>: generar el IR de las funciones en n hilos; 0 => todos
+    bool emitLLVM = false;    // Guardar también <base>.ll y <base>_opt.ll
+    bool compileOnly = false; // -c: generar <base>.o sin enlazar
+    bool run = false;         // --run: ejecutar con el JIT en lugar de generar un binario
+    bool tiered = false;      // --tiered: JIT por niveles (-O0 y luego promoción en segundo plano)
+    llvm::OptimizationLevel tierLevel = llvm::OptimizationLevel::O2;
+    uint64_t tierThreshold = 1000;
+    bool useCache = false;                   // --cache / --cache-dir=: caché de objetos en disco
+    std::string cacheDir;                    // Vacío => EasyRustCache::defaultDirectory()
+    uint64_t cacheMaxBytes = 512ull << 20;   // --cache-size=<MB>
+    bool cacheStats = false;                 // --cache-stats: imprimir aciertos/fallos
+    bool server = false;                     // --server: demonio de compilación en un socket Unix
+    bool noServer = false;                   // --no-server: no reenviar al demonio aunque esté activo
+    std::string socketPath;                  // Vacío => EasyRustProtocol::defaultSocketPath()
+    bool printIR = false;                    // --print-ir: imprimir el IR optimizado en stdout
+    bool statsJSON = false;                  // --stats=json: un registro JSON por archivo compilado
+    std::string statsFile;                   // --stats-file=<ruta>; vacío => stderr
+    unsigned traceMask = 0;                  // --trace=<categorías>: ver EasyRustTrace.h
+    int traceLevel = 1;                      // --trace-level=<n>: 1 = visitantes, 2 = detalle
+    std::string traceChrome;                 // --trace-chrome=<archivo>: eventos en formato Chrome trace
+
+    // Convierte "-O0".."-O3", "-Os" al nivel de LLVM
+    static bool parseOptLevel(const std::string &arg, llvm::OptimizationLevel &level)
+    {
+        if (arg == "-O0")
+            level = llvm::OptimizationLevel::O0;
+        else if (arg == "-O1")
+            level = llvm::OptimizationLevel::O1;
+        else if (arg == "-O2")
+            level = llvm::OptimizationLevel::O2;
+        else if (arg == "-O3")
+            level = llvm::OptimizationLevel::O3;
+        else if (arg == "-Os")
+            level = llvm::OptimizationLevel::Os;
+        else
+            return false;
+        return true;
+    }
+
+    static void printUsage(const char *prog)
+    {
+        std::cerr << "Uso: " << prog << " [opciones] [archivo.hrust | directorio]...\n"
+                  << "  -j<n> | -j <n>                Compilar hasta n archivos en paralelo\n"
+                  << "  -O0 | -O1 | -O2 | -O3 | -Os   Nivel de optimización (por defecto -O1)\n"
+                  << "  --passes=<pipeline>          Pipeline de pases personalizado (ej. \"mem2reg,instcombine\")\n"
+                  << "  --ssa                        Construir SSA al generar el IR (variables en registros aun con -O0)\n"
+                  << "  --no-fold                    No plegar ni propagar constantes antes de generar el IR\n"
+                  << "  --profile-generate[=<arch>]  Instrumentar el ejecutable; al terminar escribe <base>.profraw\n"
+                  << "  --profile-use=<arch>         Optimizar con un perfil combinado con llvm-profdata merge\n"
+                  << "  --lto=full|thin              Con import: enlazar los módulos antes de optimizar (full, por\n"
+                  << "                               defecto) u optimizarlos en paralelo con sus resúmenes (thin)\n"
+                  << "  --partitions=<n>             Dividir el módulo en n partes y optimizarlas y compilarlas en\n"
+                  << "                               paralelo (un objeto por parte)\n"
+                  << "  --codegen-threads=<n>        Generar el IR de las funciones en n hilos (0: uno por núcleo);\n"
+                  << "                               solo en archivos con muchas funciones\n"
+                  << "  --incremental                Compilar cada función a su objeto en <base>.inc/ y reutilizar\n"
+                  << "                               los de las funciones que no cambiaron\n"
+                  << "  --emit-llvm                  Guardar el IR (.ll) antes y después de optimizar\n"
+                  << "  -c                           Generar solo el archivo objeto (.o), sin enlazar\n"
+                  << "  --run                        Ejecutar el programa con el JIT (ORC) sin generar binario\n"
+                  << "  --tiered                     JIT por niveles: -O0 y recompilación de funciones calientes\n"
+                  << "  --tier-level=O1|O2|O3|Os     Nivel de las funciones promovidas (por defecto O2)\n"
+                  << "  --tier-threshold=<n>         Llamadas antes de promover una función (por defecto 1000)\n"
+                  << "  --cache                      Reutilizar objetos compilados de la caché en disco\n"
+                  << "  --cache-dir=<dir>            Directorio de la caché (implica --cache)\n"
+                  << "  --cache-size=<MB>            Tamaño máximo de la caché (por defecto 512 MB)\n"
+                  << "  --cache-stats                Imprimir aciertos y fallos de la caché\n"
+                  << "  --server                     Iniciar el demonio de compilación (socket Unix)\n"
+                  << "  --socket=<ruta>              Socket del demonio (por defecto $XDG_RUNTIME_DIR/easyrust.sock)\n"
+                  << "  --no-server                  Compilar localmente aunque el demonio esté activo\n"
+                  << "  --print-ir                   Imprimir el IR optimizado en stdout en lugar de compilar\n"
+                  << "  --stats=json                 Tiempos, memoria y contadores por fase en JSON (uno por archivo)\n"
+                  << "  --stats-file=<ruta>          Agregar los registros JSON a un archivo en lugar de stderr\n"
+                  << "  --trace=<categorías>         Trazar parse,codegen,types,calls (o all) en stderr\n"
+                  << "  --trace-level=<n>            1 = entrada a los visitantes, 2 = detalle (por defecto 1)\n"
+                  << "  --trace-chrome=<archivo>     Guardar la duración de fases y visitantes en formato Chrome trace\n";
+    }
+
+    // Opciones de la generación de IR, separadas por comas ("" = por defecto).
+    // Viajan al servidor de compilación y forman parte de la clave de la caché.
+    std::string codegenFlags() const
+    {
+        std::string flags;
+        auto add = [&](const char *flag)
+        {
+            if (!flags.empty())
+                flags += ",";
+            flags += flag;
+        };
+        if (directSSA)
+            add("ssa");
+        if (!foldConstants)
+            add("nofold");
+        if (internalLinkage)
+            add("internal");
+        return flags;
+    }
+
+    // Inversa de codegenFlags(); false si hay una opción desconocida
+    bool applyCodegenFlags(const std::string &flags)
+    {
+        directSSA = false;
+        foldConstants = true;
+        internalLinkage = false;
+        size_t start = 0;
+        while (start < flags.size())
+        {
+            size_t end = flags.find(',', start);
+            if (end == std::string::npos)
+                end = flags.size();
+            std::string flag = flags.substr(start, end - start);
+            if (flag == "ssa")
+                directSSA = true;
+            else if (flag == "nofold")
+                foldConstants = false;
+            else if (flag == "internal")
+                internalLinkage = true;
+            else if (!flag.empty())
+                return false;
+            start = end + 1;
+        }
+        return true;
+    }
+
+    // Todo lo que cambia el objeto generado, para la clave de la caché
+    std::string optimizationKey() const
+    {
+        return optLevelName + "|" + passPipeline + "|" + codegenFlags();
+    }
+
+    // Retorna false si algún argumento no es válido
+    bool parse(int argc, const char *argv[])
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (parseOptLevel(arg, optLevel))
+            {
+                optLevelName = arg.substr(1);
+            }
+            else if (arg.rfind("--passes=", 0) == 0)
+            {
+                passPipeline = arg.substr(std::string("--passes=").size());
+            }
+            else if (arg == "--ssa")
+            {
+                directSSA = true;
+            }
+            else if (arg == "--no-fold")
+            {
+                foldConstants = false;
+            }
+            else if (arg == "--emit-llvm")
+            {
+                emitLLVM = true;
+            }
+            else if (arg == "-c")
+            {
+                compileOnly = true;
+            }
+            else if (arg == "--run")
+            {
+                run = true;
+            }
+            else if (arg == "--tiered")
+            {
+                run = true;
+                tiered = true;
+            }
+            else if (arg.rfind("--tier-level=", 0) == 0)
+            {
+                if (!parseOptLevel("-" + arg.substr(std::string("--tier-level=").size()), tierLevel))
+                {
+                    std::cerr << "Error: Nivel de promoción no válido en " << arg << "\n";
+                    return false;
+                }
+            }
+            else if (arg.rfind("--tier-threshold=", 0) == 0)
+            {
+                try
+                {
+                    tierThreshold = std::stoull(arg.substr(std::string("--tier-threshold=").size()));
+                }
+                catch (const std::exception &)
+                {
+                    std::cerr << "Error: Umbral no válido en " << arg << "\n";
+                    return false;
+                }
+            }
+            else if (arg == "--cache")
+            {
+                useCache = true;
+            }
+            else if (arg.rfind("--cache-dir=", 0) == 0)
+            {
+                useCache = true;
+                cacheDir = arg.substr(std::string("--cache-dir=").size());
+            }
+            else if (arg.rfind("--cache-size=", 0) == 0)
+            {
+                try
+                {
+                    cacheMaxBytes = std::stoull(arg.substr(std::string("--cache-size=").size())) << 20;
+                }
+                catch (const std::exception &)
+                {
+                    std::cerr << "Error: Tamaño de caché no válido en " << arg << "\n";
+                    return false;
+                }
+            }
+            else if (arg == "--cache-stats")
+            {
+                cacheStats = true;
+            }
+            else if (arg.rfind("-j", 0) == 0)
+            {
+                std::string value = arg.substr(2);
+                if (value.empty() && i + 1 < argc)
+                    value = argv[++i];
+                try
+                {
+                    jobs = std::stoul(value);
+                }
+                catch (const std::exception &)
+                {
+                    std::cerr << "Error: Número de trabajos no válido en " << arg << "\n";
+                    return false;
+                }
+            }
+            else if (arg == "--profile-generate" || arg.rfind("--profile-generate=", 0) == 0)
+            {
+                profileGenerate = true;
+                if (arg.size() > std::string("--profile-generate").size())
+                    profileOutput = arg.substr(std::string("--profile-generate=").size());
+            }
+            else if (arg.rfind("--profile-use=", 0) == 0)
+            {
+                profileUse = arg.substr(std::string("--profile-use=").size());
+            }
+            else if (arg == "--lto=full" || arg == "--lto=thin")
+            {
+                thinLTO = arg == "--lto=thin";
+            }
+            else if (arg.rfind("--partitions=", 0) == 0)
+            {
+                try
+                {
+                    partitions = std::stoul(arg.substr(std::string("--partitions=").size()));
+                }
+                catch (const std::exception &)
+                {
+                    std::cerr << "Error: Número de particiones no válido en " << arg << "\n";
+                    return false;
+                }
+            }
+            else if (arg.rfind("--codegen-threads=", 0) == 0)
+            {
+                try
+                {
+                    codegenThreads = std::stoul(arg.substr(std::string("--codegen-threads=").size()));
+                }
+                catch (const std::exception &)
+                {
+                    std::cerr << "Error: Número de hilos no válido en " << arg << "\n";
+                    return false;
+                }
+            }
+            else if (arg == "--incremental")
+            {
+                incremental = true;
+            }
+            else if (arg == "--server")
+            {
+                server = true;
+            }
+            else if (arg == "--stats=json")
+            {
+                statsJSON = true;
+            }
+            else if (arg.rfind("--stats-file=", 0) == 0)
+            {
+                statsJSON = true;
+                statsFile = arg.substr(std::string("--stats-file=").size());
+            }
+            else if (arg.rfind("--trace=", 0) == 0)
+            {
+                if (!EasyRustTrace::parseCategories(arg.substr(std::string("--trace=").size()), traceMask))
+                {
+                    std::cerr << "Error: Categoría de trazado no válida en " << arg << "\n";
+                    return false;
+                }
+            }
+            else if (arg.rfind("--trace-level=", 0) == 0)
+            {
+                try
+                {
+                    traceLevel = std::stoi(arg.substr(std::string("--trace-level=").size()));
+                }
+                catch (const std::exception &)
+                {
+                    std::cerr << "Error: Nivel de trazado no válido en " << arg << "\n";
+                    return false;
+                }
+            }
+            else if (arg.rfind("--trace-chrome=", 0) == 0)
+            {
+                traceChrome = arg.substr(std::string("--trace-chrome=").size());
+            }
+            else if (arg == "--print-ir")
+            {
+                printIR = true;
+            }
+            else if (arg == "--no-server")
+            {
+                noServer = true;
+            }
+            else if (arg.rfind("--socket=", 0) == 0)
+            {
+                socketPath = arg.substr(std::string("--socket=").size());
+            }
+            else if (arg == "-h" || arg == "--help")
+            {
+                return false;
+            }
+            else if (!arg.empty() && arg[0] == '-')
+            {
+                std::cerr << "Error: Opción desconocida " << arg << "\n";
+                return false;
+            }
+            else
+            {
+                inputFiles.push_back(arg);
+            }
+        }
+        // El perfil lo escribe y lo lee un ejecutable generado por el enlazador
+        if (profileGenerate && !profileUse.empty())
+        {
+            std::cerr << "Error: --profile-generate y --profile-use son excluyentes\n";
+            return false;
+        }
+        if ((profileGenerate || !profileUse.empty()) && (run || tiered || !passPipeline.empty()))
+        {
+            std::cerr << "Error: Los perfiles (PGO) no se pueden combinar con --run, --tiered ni --passes\n";
+            return false;
+        }
+        // El resultado son los objetos de <base>.inc/ enlazados en <base>.out
+        if (incremental && (compileOnly || run || tiered || profileGenerate || !profileUse.empty()))
+        {
+            std::cerr << "Error: --incremental no se puede combinar con -c, --run, --tiered ni los perfiles (PGO)\n";
+            return false;
+        }
+        // Las particiones son objetos separados: el JIT usa un solo módulo y
+        // --lto=thin e --incremental ya dividen el programa a su manera
+        if (partitions > 1 && (run || tiered || thinLTO || incremental))
+        {
+            std::cerr << "Error: --partitions no se puede combinar con --run, --tiered, --lto=thin ni --incremental\n";
+            return false;
+        }
+        // Con -c el objeto se puede enlazar con otros y el JIT por niveles
+        // reemplaza las funciones por nombre: solo ahí se exportan
+        internalLinkage = !compileOnly && !tiered;
+        return true;
+    }
+};
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+// Divide un módulo en módulos más chicos que se optimizan y compilan por
+// separado: en paralelo (--partitions=<n>) o uno por función (--incremental).
+// Cada parte define sus funciones y lleva su propia copia de lo que usa del
+// runtime y de las constantes (linkonce_odr o privados); las funciones de otras
+// partes quedan como declaraciones o, si son pequeñas, como copias
+// available_externally que el inliner puede integrar y que luego se descartan.
+// No se usa llvm::SplitModule porque deja cada función linkonce_odr del
+// runtime en una sola parte (y GlobalDCE la borra si ahí no se usa) y reparte
+// por hash del nombre, sin equilibrar el tamaño.
+class EasyRustPartitioner
+{
+public:
+    // main y las funciones de usuario; el runtime se copia a cada parte que lo usa
+    static bool isPartitioned(const llvm::Function &function)
+    {
+        return !function.isDeclaration() && !function.isDiscardableIfUnused();
+    }
+
+    // Las funciones internas pueden quedar en otra parte que quien las llama:
+    // pasan a ser externas, ocultas fuera del ejecutable. Antes se borran las
+    // que nadie usa, porque una vez externas GlobalDCE ya no puede hacerlo.
+    static void externalize(llvm::Module &module)
+    {
+        for (bool erased = true; erased;)
+        {
+            erased = false;
+            for (llvm::Function &function : llvm::make_early_inc_range(module))
+            {
+                if (!function.isDeclaration() && function.hasLocalLinkage() && function.use_empty())
+                {
+                    function.eraseFromParent();
+                    erased = true;
+                }
+            }
+        }
+        for (llvm::Function &function : module)
+        {
+            if (!function.isDeclaration() && function.hasInternalLinkage())
+            {
+                function.setLinkage(llvm::GlobalValue::ExternalLinkage);
+                function.setVisibility(llvm::GlobalValue::HiddenVisibility);
+            }
+        }
+    }
+
+    // Reparte las funciones en hasta `count` grupos de tamaño parecido: de la
+    // más grande a la más chica, cada una al grupo con menos instrucciones
+    static std::vector<std::vector<llvm::Function *>> partition(llvm::Module &module, unsigned count)
+    {
+        std::vector<llvm::Function *> functions;
+        for (llvm::Function &function : module)
+            if (isPartitioned(function))
+                functions.push_back(&function);
+        std::vector<unsigned> order(functions.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b)
+                         { return functions[a]->getInstructionCount() > functions[b]->getInstructionCount(); });
+
+        count = std::max<size_t>(1, std::min<size_t>(count, functions.size()));
+        std::vector<std::vector<unsigned>> groups(count);
+        std::vector<uint64_t> sizes(count, 0);
+        for (unsigned index : order)
+        {
+            size_t smallest = std::min_element(sizes.begin(), sizes.end()) - sizes.begin();
+            groups[smallest].push_back(index);
+            sizes[smallest] += std::max(1u, functions[index]->getInstructionCount());
+        }
+
+        // Dentro de cada grupo, en el orden del módulo para que la salida sea determinista
+        std::vector<std::vector<llvm::Function *>> partitions;
+        for (std::vector<unsigned> &group : groups)
+        {
+            if (group.empty())
+                continue;
+            std::sort(group.begin(), group.end());
+            partitions.emplace_back();
+            for (unsigned index : group)
+                partitions.back().push_back(functions[index]);
+        }
+        return partitions;
+    }
+
+    // Módulo con la definición de `members` y solo lo que usan. Recorre lo
+    // alcanzable desde esas funciones en lugar de clonar el módulo entero, que
+    // con miles de partes haría cuadrático el costo. Las funciones de otras
+    // partes llamadas directamente y con hasta `importLimit` instrucciones se
+    // copian como available_externally; `imported` cuenta cuántas.
+    static std::unique_ptr<llvm::Module> extract(llvm::Module &source, llvm::ArrayRef<llvm::Function *> members,
+                                                 unsigned importLimit = 0, unsigned *imported = nullptr)
+    {
+        auto part = std::make_unique<llvm::Module>(members.front()->getName(), source.getContext());
+        part->setTargetTriple(source.getTargetTriple());
+        part->setDataLayout(source.getDataLayout());
+
+        enum class Kind
+        {
+            Definition,
+            Import,
+            Declaration
+        };
+        llvm::SmallPtrSet<const llvm::GlobalValue *, 16> memberSet(members.begin(), members.end());
+        auto classify = [&](const llvm::GlobalValue *value, bool fromMember)
+        {
+            if (memberSet.count(value) || (!value->isDeclaration() && value->isDiscardableIfUnused()))
+                return Kind::Definition;
+            auto *function = llvm::dyn_cast<llvm::Function>(value);
+            if (fromMember && function && isPartitioned(*function) && function->getName() != "main" &&
+                !function->hasFnAttribute(llvm::Attribute::NoInline) &&
+                function->getInstructionCount() <= importLimit)
+                return Kind::Import;
+            return Kind::Declaration;
+        };
+
+        // Clausura de los valores globales que necesitan las definiciones. Los
+        // miembros van primero en la lista, así que todo lo que llaman
+        // directamente se clasifica antes de recorrer una copia importada.
+        std::vector<llvm::GlobalValue *> needed;
+        llvm::DenseMap<const llvm::GlobalValue *, Kind> kinds;
+        for (llvm::Function *member : members)
+        {
+            needed.push_back(member);
+            kinds[member] = Kind::Definition;
+        }
+        std::vector<const llvm::Constant *> constants;
+        auto use = [&](const llvm::Value *value, bool fromMember)
+        {
+            if (auto *constant = llvm::dyn_cast<llvm::Constant>(value))
+                constants.push_back(constant);
+            while (!constants.empty())
+            {
+                const llvm::Constant *constant = constants.back();
+                constants.pop_back();
+                if (auto *global = llvm::dyn_cast<llvm::GlobalValue>(constant))
+                {
+                    if (kinds.try_emplace(global, classify(global, fromMember)).second)
+                        needed.push_back(const_cast<llvm::GlobalValue *>(global));
+                    continue;
+                }
+                for (const llvm::Value *operand : constant->operands())
+                    if (auto *nested = llvm::dyn_cast<llvm::Constant>(operand))
+                        constants.push_back(nested);
+            }
+        };
+        for (size_t i = 0; i < needed.size(); i++)
+        {
+            llvm::GlobalValue *global = needed[i];
+            if (kinds[global] == Kind::Declaration)
+                continue;
+            bool fromMember = memberSet.count(global);
+            if (auto *variable = llvm::dyn_cast<llvm::GlobalVariable>(global))
+                use(variable->getInitializer(), fromMember);
+            else if (auto *function = llvm::dyn_cast<llvm::Function>(global))
+                for (const llvm::Instruction &inst : llvm::instructions(*function))
+                    for (const llvm::Value *operand : inst.operands())
+                        use(operand, fromMember);
+        }
+
+        // Primero todas las declaraciones, así los cuerpos pueden referirse unos a otros
+        llvm::ValueToValueMapTy map;
+        unsigned importCount = 0;
+        for (llvm::GlobalValue *global : needed)
+        {
+            Kind kind = kinds[global];
+            llvm::GlobalValue::LinkageTypes linkage = kind == Kind::Definition ? global->getLinkage()
+                                                      : kind == Kind::Import ? llvm::GlobalValue::AvailableExternallyLinkage
+                                                                             : llvm::GlobalValue::ExternalLinkage;
+            llvm::GlobalValue *copy;
+            if (auto *function = llvm::dyn_cast<llvm::Function>(global))
+            {
+                auto *copied = llvm::Function::Create(function->getFunctionType(), linkage,
+                                                      function->getAddressSpace(), function->getName(), part.get());
+                copied->copyAttributesFrom(function);
+                copy = copied;
+            }
+            else
+            {
+                auto *variable = llvm::cast<llvm::GlobalVariable>(global);
+                auto *copied = new llvm::GlobalVariable(*part, variable->getValueType(), variable->isConstant(),
+                                                        linkage, nullptr, variable->getName(), nullptr,
+                                                        variable->getThreadLocalMode(),
+                                                        variable->getType()->getAddressSpace());
+                copied->copyAttributesFrom(variable);
+                copy = copied;
+            }
+            if (kind != Kind::Definition)
+                copy->setVisibility(llvm::GlobalValue::DefaultVisibility);
+            importCount += kind == Kind::Import;
+            map[global] = copy;
+        }
+        for (llvm::GlobalValue *global : needed)
+        {
+            if (kinds[global] == Kind::Declaration)
+                continue;
+            if (auto *variable = llvm::dyn_cast<llvm::GlobalVariable>(global))
+            {
+                llvm::cast<llvm::GlobalVariable>(map[variable])
+                    ->setInitializer(llvm::MapValue(variable->getInitializer(), map));
+                continue;
+            }
+            auto *function = llvm::cast<llvm::Function>(global);
+            auto *copy = llvm::cast<llvm::Function>(map[function]);
+            auto argument = copy->arg_begin();
+            for (const llvm::Argument &original : function->args())
+            {
+                argument->setName(original.getName());
+                map[&original] = &*argument++;
+            }
+            llvm::SmallVector<llvm::ReturnInst *, 8> returns;
+            llvm::CloneFunctionInto(copy, function, map, llvm::CloneFunctionChangeType::DifferentModule, returns);
+        }
+        // CloneFunctionInto deja un llvm.dbg.cu vacío aunque no haya información de depuración
+        if (llvm::NamedMDNode *units = part->getNamedMetadata("llvm.dbg.cu"); units && units->getNumOperands() == 0)
+            part->eraseNamedMetadata(units);
+        if (imported)
+            *imported = importCount;
+        return part;
+    }
+};
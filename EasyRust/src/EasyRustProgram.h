@@ -0,0 +1,456 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Analysis/ModuleSummaryAnalysis.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "EasyRustAST.h"
+#include "EasyRustDriver.h"
+
+// Programa de varios archivos: `import "util.hrust";` hace visibles las
+// funciones de otro archivo. Cada archivo se genera en su propio módulo, que
+// se guarda como bitcode junto con su resumen (ModuleSummaryIndex: tamaño de
+// cada función y a quién llama), de modo que un import sin cambios sale de la
+// caché sin parsearlo. Después los módulos se combinan de una de dos formas:
+//
+//  - LTO completo: llvm::Linker une todo en un solo módulo antes de optimizar
+//    (inlining entre módulos; las funciones que nadie usa ni se copian).
+//  - Estilo ThinLTO (--lto=thin): cada módulo se optimiza y compila por
+//    separado, en paralelo, y solo importa copias available_externally de
+//    las funciones pequeñas que llama según los resúmenes.
+//
+// La generación de cada módulo (parseo y EasyRustDriver) la hace EasyRustCompiler.
+class EasyRustProgram
+{
+public:
+    struct Unit
+    {
+        std::string path;            // Ruta normalizada; vacía para stdin
+        std::string name;            // Nombre del archivo sin extensión (objetos de --lto=thin)
+        std::string source;
+        std::vector<size_t> imports; // Índices en `units`
+        std::string interface;       // Firmas exportadas, ver interfaceOf()
+        std::string key;             // Clave del bitcode en la caché
+        std::string bitcode;         // Módulo sin optimizar con su resumen
+    };
+
+    // Funciones de hasta este tamaño (instrucciones) se importan en --lto=thin,
+    // igual que el -import-instr-limit por defecto de LLVM
+    static constexpr unsigned ImportInstructionLimit = 100;
+
+private:
+    std::vector<Unit> units; // Postorden: cada archivo después de lo que importa; el principal al final
+
+    // Resúmenes de --lto=thin
+    struct FunctionInfo
+    {
+        size_t unit;
+        unsigned instructions;
+        std::vector<llvm::GlobalValue::GUID> callees;
+    };
+    llvm::DenseMap<llvm::GlobalValue::GUID, FunctionInfo> functions;
+    std::vector<llvm::DenseSet<llvm::GlobalValue::GUID>> thinImports; // Por unidad
+    llvm::DenseSet<llvm::GlobalValue::GUID> exported; // Llamadas desde otro módulo: no pueden ser internas
+
+    // DFS desde `index`; `stack` detecta los ciclos
+    bool visit(size_t index, std::vector<size_t> &stack, std::map<std::string, size_t> &byPath,
+               std::vector<size_t> &order, std::string &error)
+    {
+        stack.push_back(index);
+        std::filesystem::path dir = units[index].path.empty() ? std::filesystem::current_path()
+                                                              : std::filesystem::path(units[index].path).parent_path();
+        for (const std::string &importPath : scanImports(units[index].source))
+        {
+            std::string path = std::filesystem::weakly_canonical(dir / importPath).string();
+            auto found = byPath.find(path);
+            if (found == byPath.end())
+            {
+                Unit unit;
+                unit.path = path;
+                unit.name = std::filesystem::path(path).stem().string();
+                std::ifstream in(path, std::ios::binary);
+                if (!in.is_open())
+                {
+                    error = "No se pudo abrir el archivo importado " + importPath + " (desde " +
+                            displayName(index) + ")";
+                    return false;
+                }
+                unit.source.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                units.push_back(std::move(unit));
+                found = byPath.emplace(path, units.size() - 1).first;
+                units[index].imports.push_back(found->second);
+                if (!visit(found->second, stack, byPath, order, error))
+                    return false;
+                continue;
+            }
+            if (std::find(stack.begin(), stack.end(), found->second) != stack.end())
+            {
+                error = "Importación circular: " + displayName(index) + " importa " + displayName(found->second);
+                return false;
+            }
+            if (std::find(units[index].imports.begin(), units[index].imports.end(), found->second) ==
+                units[index].imports.end())
+                units[index].imports.push_back(found->second);
+        }
+        stack.pop_back();
+        order.push_back(index);
+        return true;
+    }
+
+    std::unique_ptr<llvm::Module> parseUnit(size_t index, llvm::LLVMContext &context, std::string &error) const
+    {
+        llvm::MemoryBufferRef buffer(units[index].bitcode, displayName(index));
+        auto parsed = llvm::parseBitcodeFile(buffer, context);
+        if (!parsed)
+        {
+            error = displayName(index) + ": " + llvm::toString(parsed.takeError());
+            return nullptr;
+        }
+        return std::move(*parsed);
+    }
+
+public:
+    // Rutas de los `import "ruta";` del código, sin parsearlo: se saltan los
+    // comentarios y las cadenas, igual que el lexer
+    static std::vector<std::string> scanImports(const std::string &source)
+    {
+        std::vector<std::string> imports;
+        size_t i = 0;
+        auto isIdent = [&](size_t at)
+        { return at < source.size() && (std::isalnum(static_cast<unsigned char>(source[at])) || source[at] == '_'); };
+        while (i < source.size())
+        {
+            if (source.compare(i, 2, "//") == 0)
+            {
+                i = source.find('\n', i);
+                if (i == std::string::npos)
+                    break;
+            }
+            else if (source[i] == '"')
+            {
+                size_t end = source.find_first_of("\"\n", i + 1);
+                i = end == std::string::npos ? source.size() : end + 1;
+            }
+            else if (isIdent(i))
+            {
+                size_t start = i;
+                while (isIdent(i))
+                    i++;
+                if (source.compare(start, i - start, "import") != 0)
+                    continue;
+                size_t quote = source.find_first_not_of(" \t\r\n", i);
+                if (quote == std::string::npos || source[quote] != '"')
+                    continue;
+                size_t end = source.find_first_of("\"\n", quote + 1);
+                if (end == std::string::npos || source[end] != '"')
+                    continue;
+                imports.push_back(source.substr(quote + 1, end - quote - 1));
+                i = end + 1;
+            }
+            else
+            {
+                i++;
+            }
+        }
+        return imports;
+    }
+
+    // Lee recursivamente los archivos importados desde `inputFile` (vacío => stdin)
+    bool load(const std::string &inputFile, const std::string &source, std::string &error)
+    {
+        units.clear();
+        Unit root;
+        if (!inputFile.empty())
+        {
+            root.path = std::filesystem::weakly_canonical(inputFile).string();
+            root.name = std::filesystem::path(inputFile).stem().string();
+        }
+        root.source = source;
+        units.push_back(std::move(root));
+
+        std::map<std::string, size_t> byPath;
+        if (!units[0].path.empty())
+            byPath.emplace(units[0].path, 0);
+        std::vector<size_t> stack, order;
+        if (!visit(0, stack, byPath, order, error))
+            return false;
+
+        // Reordenar en postorden y traducir los índices
+        std::vector<size_t> position(units.size());
+        for (size_t i = 0; i < order.size(); i++)
+            position[order[i]] = i;
+        std::vector<Unit> sorted(units.size());
+        for (size_t i = 0; i < units.size(); i++)
+        {
+            for (size_t &dependency : units[i].imports)
+                dependency = position[dependency];
+            sorted[position[i]] = std::move(units[i]);
+        }
+        units = std::move(sorted);
+        return true;
+    }
+
+    std::vector<Unit> &getUnits()
+    {
+        return units;
+    }
+
+    std::string displayName(size_t index) const
+    {
+        return units[index].path.empty() ? "<stdin>" : units[index].path;
+    }
+
+    // Firmas de las funciones de nivel superior, una por línea:
+    // `nombre retorno parámetro...` (los tipos como se escribieron, sin espacios)
+    static std::string interfaceOf(const EasyRustAST::Context &ast)
+    {
+        std::string text;
+        for (const EasyRustAST::Stmt *stmt : ast.getProgram())
+        {
+            const auto *decl = llvm::dyn_cast<EasyRustAST::FunctionDecl>(stmt);
+            if (!decl)
+                continue;
+            text += ast.name(decl->name).str() + " " + decl->returnType.spelling.str();
+            for (const EasyRustAST::Param &param : decl->params)
+                text += " " + param.type.spelling.str();
+            text += "\n";
+        }
+        return text;
+    }
+
+    // Inversa de la escritura de un tipo: int, float, bool, string, void, [T; N], [T]
+    static EasyRustAST::TypeSpec parseType(llvm::StringRef spelling)
+    {
+        EasyRustAST::TypeSpec spec{EasyRustAST::typeKindFromName(spelling), spelling};
+        if (spelling.size() > 2 && spelling.front() == '[' && spelling.back() == ']')
+        {
+            llvm::StringRef inner = spelling.drop_front().drop_back();
+            auto [element, length] = inner.split(';');
+            spec.kind = EasyRustAST::TypeKind::Array;
+            spec.element = EasyRustAST::typeKindFromName(element.trim());
+            if (spec.element == EasyRustAST::TypeKind::Void)
+                spec.element = EasyRustAST::TypeKind::Unknown;
+            if (!length.empty() && length.trim().getAsInteger(10, spec.arrayLength))
+                spec.element = EasyRustAST::TypeKind::Unknown;
+        }
+        return spec;
+    }
+
+    // Declara en `driver` las funciones de los módulos que importa la unidad
+    bool declareImports(size_t index, EasyRustDriver &driver) const
+    {
+        bool ok = true;
+        for (size_t dependency : units[index].imports)
+        {
+            llvm::SmallVector<llvm::StringRef, 16> lines;
+            llvm::StringRef(units[dependency].interface).split(lines, '\n', -1, false);
+            for (llvm::StringRef line : lines)
+            {
+                llvm::SmallVector<llvm::StringRef, 8> fields;
+                line.split(fields, ' ', -1, false);
+                std::vector<EasyRustAST::TypeSpec> params;
+                for (llvm::StringRef field : llvm::ArrayRef<llvm::StringRef>(fields).drop_front(2))
+                    params.push_back(parseType(field));
+                ok &= driver.declareImportedFunction(fields[0], parseType(fields[1]), params);
+            }
+        }
+        return ok;
+    }
+
+    // Una función definida en dos archivos haría fallar al enlazador
+    bool checkDuplicates(std::string &error) const
+    {
+        llvm::StringMap<size_t> definedIn;
+        for (size_t i = 0; i < units.size(); i++)
+        {
+            llvm::SmallVector<llvm::StringRef, 16> lines;
+            llvm::StringRef(units[i].interface).split(lines, '\n', -1, false);
+            for (llvm::StringRef line : lines)
+            {
+                llvm::StringRef name = line.split(' ').first;
+                auto inserted = definedIn.try_emplace(name, i);
+                if (!inserted.second && inserted.first->second != i)
+                {
+                    error = "La función " + name.str() + " está definida en " + displayName(inserted.first->second) +
+                            " y en " + displayName(i);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Bitcode del módulo con su resumen (lo que lee planThinImports)
+    static std::string writeBitcode(const llvm::Module &module)
+    {
+        llvm::ProfileSummaryInfo psi(module);
+        llvm::ModuleSummaryIndex index = llvm::buildModuleSummaryIndex(module, nullptr, &psi);
+        std::string bitcode;
+        llvm::raw_string_ostream os(bitcode);
+        llvm::WriteBitcodeToFile(module, os, false, &index);
+        os.flush();
+        return bitcode;
+    }
+
+    // LTO completo: enlaza todos los módulos en el del archivo principal. Se
+    // recorren en orden topológico inverso (quien importa antes que lo
+    // importado) con LinkOnlyNeeded, así que solo se copian las funciones
+    // alcanzables desde main.
+    llvm::orc::ThreadSafeModule linkFull(std::string &error) const
+    {
+        auto context = std::make_unique<llvm::LLVMContext>();
+        std::unique_ptr<llvm::Module> program = parseUnit(units.size() - 1, *context, error);
+        if (!program)
+            return {};
+        llvm::Linker linker(*program);
+        for (size_t i = units.size() - 1; i-- > 0;)
+        {
+            std::unique_ptr<llvm::Module> unit = parseUnit(i, *context, error);
+            if (!unit)
+                return {};
+            if (linker.linkInModule(std::move(unit), llvm::Linker::LinkOnlyNeeded))
+            {
+                error = "No se pudo enlazar " + displayName(i);
+                return {};
+            }
+        }
+        return llvm::orc::ThreadSafeModule(std::move(program), std::move(context));
+    }
+
+    // --lto=thin: lee los resúmenes y decide qué importa cada unidad. Una
+    // función llamada desde otro módulo (o desde una copia importada) se exporta.
+    bool planThinImports(std::string &error)
+    {
+        functions.clear();
+        exported.clear();
+        thinImports.assign(units.size(), {});
+        for (size_t i = 0; i < units.size(); i++)
+        {
+            auto index = llvm::getModuleSummaryIndex(llvm::MemoryBufferRef(units[i].bitcode, displayName(i)));
+            if (!index)
+            {
+                error = displayName(i) + ": " + llvm::toString(index.takeError());
+                return false;
+            }
+            for (const auto &entry : **index)
+            {
+                for (const auto &summary : entry.second.SummaryList)
+                {
+                    const auto *function = llvm::dyn_cast<llvm::FunctionSummary>(summary.get());
+                    if (!function || !llvm::GlobalValue::isExternalLinkage(summary->linkage()))
+                        continue;
+                    FunctionInfo info{i, function->instCount(), {}};
+                    for (const auto &call : function->calls())
+                        info.callees.push_back(call.first.getGUID());
+                    functions[entry.first] = std::move(info);
+                }
+            }
+        }
+
+        for (const auto &[guid, caller] : functions)
+        {
+            for (llvm::GlobalValue::GUID callee : caller.callees)
+            {
+                auto found = functions.find(callee);
+                if (found == functions.end() || found->second.unit == caller.unit)
+                    continue;
+                exported.insert(callee);
+                if (found->second.instructions > ImportInstructionLimit)
+                    continue;
+                // La copia importada puede llamar a funciones de su módulo
+                thinImports[caller.unit].insert(callee);
+                for (llvm::GlobalValue::GUID nested : found->second.callees)
+                    exported.insert(nested);
+            }
+        }
+        return true;
+    }
+
+    // Funciones de la unidad que usa otra unidad (forman parte de la clave de su objeto)
+    std::string thinKey(size_t index) const
+    {
+        std::string key = units[index].key;
+        for (size_t dependency : units[index].imports)
+            key += "|" + units[dependency].key;
+        std::vector<llvm::GlobalValue::GUID> visible;
+        for (const auto &[guid, info] : functions)
+            if (info.unit == index && exported.contains(guid))
+                visible.push_back(guid);
+        std::sort(visible.begin(), visible.end());
+        for (llvm::GlobalValue::GUID guid : visible)
+            key += "|" + std::to_string(guid);
+        return key;
+    }
+
+    // --lto=thin: módulo de la unidad con las copias available_externally de
+    // las funciones que importa. Con `internalize`, las funciones que ningún
+    // otro módulo llama quedan internas.
+    std::unique_ptr<llvm::Module> thinModule(size_t index, llvm::LLVMContext &context, bool internalize,
+                                             unsigned &imported, std::string &error) const
+    {
+        std::unique_ptr<llvm::Module> module = parseUnit(index, context, error);
+        if (!module)
+            return nullptr;
+        imported = 0;
+        for (size_t i = 0; i < units.size(); i++)
+        {
+            bool needed = llvm::any_of(thinImports[index], [&](llvm::GlobalValue::GUID guid)
+                                       { return functions.find(guid)->second.unit == i; });
+            if (i == index || !needed)
+                continue;
+            std::unique_ptr<llvm::Module> source = parseUnit(i, context, error);
+            if (!source)
+                return nullptr;
+            for (llvm::Function &function : *source)
+            {
+                if (!EasyRustDriver::isUserFunction(function))
+                    continue;
+                if (thinImports[index].contains(function.getGUID()))
+                {
+                    function.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+                    imported++;
+                }
+                else
+                {
+                    function.deleteBody();
+                }
+            }
+            if (llvm::Linker::linkModules(*module, std::move(source), llvm::Linker::LinkOnlyNeeded))
+            {
+                error = "No se pudieron importar funciones de " + displayName(i);
+                return nullptr;
+            }
+        }
+        if (internalize)
+        {
+            for (llvm::Function &function : *module)
+                if (EasyRustDriver::isUserFunction(function) && !exported.contains(function.getGUID()))
+                    function.setLinkage(llvm::GlobalValue::InternalLinkage);
+        }
+        return module;
+    }
+};
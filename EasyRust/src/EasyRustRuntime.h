@@ -0,0 +1,614 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+// Runtime de EasyRust. Se emite como IR dentro de cada módulo, así no hay una
+// biblioteca aparte que enlazar ni símbolos que registrar en el JIT. Las
+// funciones y su estado tienen enlace linkonce_odr: si se unen varios módulos
+// queda una sola copia, y el JIT por niveles puede dejarlas como declaraciones.
+//
+// Cadenas: un par {ptr datos, i64 longitud} que se pasa por valor. Los datos
+// siempre terminan en '\0' (para printf), pero la longitud nunca se recalcula.
+// Los resultados de concatenar viven en un arena que crece por bloques y se
+// libera al terminar el proceso.
+//
+// Arreglos: {ptr elementos, i64 longitud}, con un tipo con nombre por tipo de
+// elemento (easyrust.array.double, ...) para distinguirlos entre sí y de las
+// cadenas. Los elementos son contiguos; el arreglo se pasa por referencia.
+//
+// Salida: print escribe en un buffer propio de OutputBuffer bytes, con una
+// función por tipo (sin printf ni conversión de int a double). El buffer se
+// vacía con write(2) cuando se llena y al salir de main.
+class EasyRustRuntime
+{
+private:
+    llvm::Module &module;
+    llvm::LLVMContext &context;
+    llvm::StructType *stringType;
+    llvm::DenseMap<llvm::Type *, llvm::StructType *> arrayTypes; // Elemento -> arreglo
+    llvm::DenseMap<llvm::Type *, llvm::Type *> arrayElements;    // Arreglo -> elemento
+    llvm::Function *allocFunc = nullptr;
+    llvm::StringMap<llvm::GlobalVariable *> constantPool; // Literales y formatos, uno por texto
+
+    // Variable global del runtime (una sola copia aunque se unan módulos)
+    llvm::GlobalVariable *runtimeGlobal(llvm::StringRef name, llvm::Type *type)
+    {
+        if (llvm::GlobalVariable *existing = module.getGlobalVariable(name))
+            return existing;
+        auto *global = new llvm::GlobalVariable(module, type, false, llvm::GlobalValue::LinkOnceODRLinkage,
+                                                llvm::Constant::getNullValue(type), name);
+        global->setVisibility(llvm::GlobalValue::HiddenVisibility);
+        return global;
+    }
+
+    llvm::GlobalVariable *arenaGlobal(llvm::StringRef name)
+    {
+        return runtimeGlobal(name, llvm::PointerType::getUnqual(context));
+    }
+
+    // Función del runtime ya definida o nullptr; si no existe la crea vacía en `created`
+    llvm::Function *runtimeFunction(llvm::StringRef name, llvm::FunctionType *type, llvm::Function *&created)
+    {
+        created = nullptr;
+        if (llvm::Function *existing = module.getFunction(name))
+            return existing;
+        created = llvm::Function::Create(type, llvm::Function::LinkOnceODRLinkage, name, module);
+        created->setVisibility(llvm::GlobalValue::HiddenVisibility);
+        return created;
+    }
+
+    // {ptr, i64} con nombre (el mismo si ya existe en el contexto)
+    llvm::StructType *namedPair(llvm::StringRef name)
+    {
+        if (llvm::StructType *existing = llvm::StructType::getTypeByName(context, name))
+            return existing;
+        return llvm::StructType::create(
+            context, {llvm::PointerType::getUnqual(context), llvm::Type::getInt64Ty(context)}, name);
+    }
+
+    llvm::GlobalVariable *outputBuffer()
+    {
+        return runtimeGlobal("easyrust.out.buf",
+                             llvm::ArrayType::get(llvm::Type::getInt8Ty(context), OutputBuffer));
+    }
+
+    llvm::GlobalVariable *outputLength()
+    {
+        return runtimeGlobal("easyrust.out.len", llvm::Type::getInt64Ty(context));
+    }
+
+    // void easyrust_flush(): escribe el buffer en la salida estándar
+    llvm::Function *getFlushFunction()
+    {
+        llvm::Function *function;
+        llvm::Function *existing = runtimeFunction(
+            "easyrust_flush", llvm::FunctionType::get(llvm::Type::getVoidTy(context), false), function);
+        if (!function)
+            return existing;
+
+        llvm::Type *i32Ty = llvm::Type::getInt32Ty(context);
+        llvm::Type *i64Ty = llvm::Type::getInt64Ty(context);
+        llvm::Type *i8Ty = llvm::Type::getInt8Ty(context);
+        llvm::PointerType *ptrTy = llvm::PointerType::getUnqual(context);
+        llvm::FunctionCallee writeFunc =
+            module.getOrInsertFunction("write", llvm::FunctionType::get(i64Ty, {i32Ty, ptrTy, i64Ty}, false));
+        llvm::GlobalVariable *buffer = outputBuffer();
+        llvm::GlobalVariable *length = outputLength();
+
+        llvm::BasicBlock *entry = llvm::BasicBlock::Create(context, "entry", function);
+        llvm::BasicBlock *loop = llvm::BasicBlock::Create(context, "loop", function);
+        llvm::BasicBlock *write = llvm::BasicBlock::Create(context, "write", function);
+        llvm::BasicBlock *done = llvm::BasicBlock::Create(context, "done", function);
+        llvm::IRBuilder<> b(entry);
+        llvm::Value *total = b.CreateLoad(i64Ty, length, "total");
+        b.CreateBr(loop);
+
+        // write puede escribir menos de lo pedido: se repite hasta terminar o fallar
+        b.SetInsertPoint(loop);
+        llvm::PHINode *written = b.CreatePHI(i64Ty, 2, "written");
+        written->addIncoming(llvm::ConstantInt::get(i64Ty, 0), entry);
+        llvm::Value *remaining = b.CreateSub(total, written, "remaining");
+        b.CreateCondBr(b.CreateICmpSGT(remaining, llvm::ConstantInt::get(i64Ty, 0)), write, done);
+
+        b.SetInsertPoint(write);
+        llvm::Value *result = b.CreateCall(
+            writeFunc, {llvm::ConstantInt::get(i32Ty, 1), b.CreateGEP(i8Ty, buffer, written), remaining}, "result");
+        written->addIncoming(b.CreateAdd(written, result), write);
+        b.CreateCondBr(b.CreateICmpSGT(result, llvm::ConstantInt::get(i64Ty, 0)), loop, done);
+
+        b.SetInsertPoint(done);
+        b.CreateStore(llvm::ConstantInt::get(i64Ty, 0), length);
+        b.CreateRetVoid();
+        return function;
+    }
+
+    // ptr easyrust_out_reserve(i64 n): lugar para n bytes (n <= OutputBuffer)
+    // al final del buffer, vaciándolo antes si no alcanza
+    llvm::Function *getReserveFunction()
+    {
+        llvm::Type *i64Ty = llvm::Type::getInt64Ty(context);
+        llvm::Type *i8Ty = llvm::Type::getInt8Ty(context);
+        llvm::PointerType *ptrTy = llvm::PointerType::getUnqual(context);
+        llvm::Function *function;
+        llvm::Function *existing =
+            runtimeFunction("easyrust_out_reserve", llvm::FunctionType::get(ptrTy, {i64Ty}, false), function);
+        if (!function)
+            return existing;
+        llvm::Function *flush = getFlushFunction();
+        llvm::GlobalVariable *buffer = outputBuffer();
+        llvm::GlobalVariable *length = outputLength();
+
+        llvm::BasicBlock *entry = llvm::BasicBlock::Create(context, "entry", function);
+        llvm::BasicBlock *full = llvm::BasicBlock::Create(context, "full", function);
+        llvm::BasicBlock *ready = llvm::BasicBlock::Create(context, "ready", function);
+        llvm::IRBuilder<> b(entry);
+        llvm::Value *used = b.CreateLoad(i64Ty, length, "used");
+        llvm::Value *needed = b.CreateAdd(used, function->getArg(0), "needed");
+        b.CreateCondBr(b.CreateICmpUGT(needed, llvm::ConstantInt::get(i64Ty, OutputBuffer)), full, ready);
+
+        b.SetInsertPoint(full);
+        b.CreateCall(flush);
+        b.CreateBr(ready);
+
+        b.SetInsertPoint(ready);
+        llvm::PHINode *offset = b.CreatePHI(i64Ty, 2, "offset");
+        offset->addIncoming(used, entry);
+        offset->addIncoming(llvm::ConstantInt::get(i64Ty, 0), full);
+        b.CreateRet(b.CreateGEP(i8Ty, buffer, offset));
+        return function;
+    }
+
+    // Suma `count` bytes ya escritos (después de reservarlos) a la longitud del buffer
+    void advance(llvm::IRBuilderBase &b, llvm::Value *count)
+    {
+        llvm::Type *i64Ty = llvm::Type::getInt64Ty(context);
+        llvm::GlobalVariable *length = outputLength();
+        b.CreateStore(b.CreateAdd(b.CreateLoad(i64Ty, length), count), length);
+    }
+
+    // void easyrust_print_int(i32): dígitos de derecha a izquierda en un buffer local
+    llvm::Function *getPrintIntFunction()
+    {
+        llvm::Type *i32Ty = llvm::Type::getInt32Ty(context);
+        llvm::Type *i64Ty = llvm::Type::getInt64Ty(context);
+        llvm::Type *i8Ty = llvm::Type::getInt8Ty(context);
+        llvm::Function *function;
+        llvm::Function *existing = runtimeFunction(
+            "easyrust_print_int", llvm::FunctionType::get(llvm::Type::getVoidTy(context), {i32Ty}, false), function);
+        if (!function)
+            return existing;
+        llvm::Function *reserve = getReserveFunction();
+
+        // "-2147483648\n" ocupa 12 bytes
+        const uint64_t digitsSize = 12;
+        llvm::BasicBlock *entry = llvm::BasicBlock::Create(context, "entry", function);
+        llvm::BasicBlock *loop = llvm::BasicBlock::Create(context, "digits", function);
+        llvm::BasicBlock *done = llvm::BasicBlock::Create(context, "done", function);
+        llvm::IRBuilder<> b(entry);
+        llvm::Value *digits = b.CreateAlloca(llvm::ArrayType::get(i8Ty, digitsSize), nullptr, "text");
+        llvm::Value *value = b.CreateSExt(function->getArg(0), i64Ty, "value");
+        llvm::Value *negative = b.CreateICmpSLT(value, llvm::ConstantInt::get(i64Ty, 0), "negative");
+        llvm::Value *magnitude = b.CreateSelect(negative, b.CreateNeg(value), value, "magnitude");
+        b.CreateStore(llvm::ConstantInt::get(i8Ty, '\n'),
+                      b.CreateGEP(i8Ty, digits, llvm::ConstantInt::get(i64Ty, digitsSize - 1)));
+        b.CreateBr(loop);
+
+        b.SetInsertPoint(loop);
+        llvm::PHINode *rest = b.CreatePHI(i64Ty, 2, "rest");
+        llvm::PHINode *pos = b.CreatePHI(i64Ty, 2, "pos");
+        rest->addIncoming(magnitude, entry);
+        pos->addIncoming(llvm::ConstantInt::get(i64Ty, digitsSize - 1), entry);
+        llvm::Value *next = b.CreateSub(pos, llvm::ConstantInt::get(i64Ty, 1), "next");
+        llvm::Value *quotient = b.CreateUDiv(rest, llvm::ConstantInt::get(i64Ty, 10), "quotient");
+        llvm::Value *digit = b.CreateSub(rest, b.CreateMul(quotient, llvm::ConstantInt::get(i64Ty, 10)));
+        b.CreateStore(b.CreateAdd(b.CreateTrunc(digit, i8Ty), llvm::ConstantInt::get(i8Ty, '0')),
+                      b.CreateGEP(i8Ty, digits, next));
+        rest->addIncoming(quotient, loop);
+        pos->addIncoming(next, loop);
+        b.CreateCondBr(b.CreateICmpNE(quotient, llvm::ConstantInt::get(i64Ty, 0)), loop, done);
+
+        // Como mucho hay 10 dígitos, así que next - 1 siempre está dentro del buffer
+        b.SetInsertPoint(done);
+        llvm::Value *signPos = b.CreateSub(next, llvm::ConstantInt::get(i64Ty, 1));
+        b.CreateStore(llvm::ConstantInt::get(i8Ty, '-'), b.CreateGEP(i8Ty, digits, signPos));
+        llvm::Value *start = b.CreateSelect(negative, signPos, next, "start");
+        llvm::Value *count = b.CreateSub(llvm::ConstantInt::get(i64Ty, digitsSize), start, "count");
+        llvm::Value *out = b.CreateCall(reserve, {count}, "out");
+        b.CreateMemCpy(out, llvm::MaybeAlign(1), b.CreateGEP(i8Ty, digits, start), llvm::MaybeAlign(1), count);
+        advance(b, count);
+        b.CreateRetVoid();
+        return function;
+    }
+
+    // void easyrust_print_float(double): mismo formato que antes ("%lf\n")
+    llvm::Function *getPrintFloatFunction()
+    {
+        llvm::Type *i32Ty = llvm::Type::getInt32Ty(context);
+        llvm::Type *i64Ty = llvm::Type::getInt64Ty(context);
+        llvm::Type *doubleTy = llvm::Type::getDoubleTy(context);
+        llvm::PointerType *ptrTy = llvm::PointerType::getUnqual(context);
+        llvm::Function *function;
+        llvm::Function *existing = runtimeFunction(
+            "easyrust_print_float", llvm::FunctionType::get(llvm::Type::getVoidTy(context), {doubleTy}, false),
+            function);
+        if (!function)
+            return existing;
+        llvm::Function *reserve = getReserveFunction();
+        llvm::FunctionCallee snprintfFunc =
+            module.getOrInsertFunction("snprintf", llvm::FunctionType::get(i32Ty, {ptrTy, i64Ty, ptrTy}, true));
+
+        // El double más grande con %lf ocupa unos 320 caracteres
+        llvm::Value *space = llvm::ConstantInt::get(i64Ty, 512);
+        llvm::IRBuilder<> b(llvm::BasicBlock::Create(context, "entry", function));
+        llvm::Value *out = b.CreateCall(reserve, {space}, "out");
+        llvm::Value *written =
+            b.CreateCall(snprintfFunc, {out, space, constantString("%lf\n", "fmt"), function->getArg(0)}, "written");
+        advance(b, b.CreateZExt(written, i64Ty));
+        b.CreateRetVoid();
+        return function;
+    }
+
+    // void easyrust_print_bool(i1): "true" o "false"
+    llvm::Function *getPrintBoolFunction()
+    {
+        llvm::Type *i64Ty = llvm::Type::getInt64Ty(context);
+        llvm::Function *function;
+        llvm::Function *existing = runtimeFunction(
+            "easyrust_print_bool",
+            llvm::FunctionType::get(llvm::Type::getVoidTy(context), {llvm::Type::getInt1Ty(context)}, false),
+            function);
+        if (!function)
+            return existing;
+        llvm::Function *reserve = getReserveFunction();
+
+        llvm::IRBuilder<> b(llvm::BasicBlock::Create(context, "entry", function));
+        llvm::Value *flag = function->getArg(0);
+        llvm::Value *text = b.CreateSelect(flag, constantString("true\n", "bool"), constantString("false\n", "bool"));
+        llvm::Value *count = b.CreateSelect(flag, llvm::ConstantInt::get(i64Ty, 5), llvm::ConstantInt::get(i64Ty, 6));
+        llvm::Value *out = b.CreateCall(reserve, {count}, "out");
+        b.CreateMemCpy(out, llvm::MaybeAlign(1), text, llvm::MaybeAlign(1), count);
+        advance(b, count);
+        b.CreateRetVoid();
+        return function;
+    }
+
+    // void easyrust_print_str(ptr, i64): copia por tramos de a lo sumo
+    // OutputBuffer bytes, así una cadena más grande que el buffer también sirve
+    llvm::Function *getPrintStringFunction()
+    {
+        llvm::Type *i64Ty = llvm::Type::getInt64Ty(context);
+        llvm::Type *i8Ty = llvm::Type::getInt8Ty(context);
+        llvm::PointerType *ptrTy = llvm::PointerType::getUnqual(context);
+        llvm::Function *function;
+        llvm::Function *existing = runtimeFunction(
+            "easyrust_print_str", llvm::FunctionType::get(llvm::Type::getVoidTy(context), {ptrTy, i64Ty}, false),
+            function);
+        if (!function)
+            return existing;
+        llvm::Function *reserve = getReserveFunction();
+        llvm::Value *data = function->getArg(0);
+        llvm::Value *size = function->getArg(1);
+
+        llvm::BasicBlock *entry = llvm::BasicBlock::Create(context, "entry", function);
+        llvm::BasicBlock *loop = llvm::BasicBlock::Create(context, "loop", function);
+        llvm::BasicBlock *copy = llvm::BasicBlock::Create(context, "copy", function);
+        llvm::BasicBlock *done = llvm::BasicBlock::Create(context, "done", function);
+        llvm::IRBuilder<> b(entry);
+        b.CreateBr(loop);
+
+        b.SetInsertPoint(loop);
+        llvm::PHINode *copied = b.CreatePHI(i64Ty, 2, "copied");
+        copied->addIncoming(llvm::ConstantInt::get(i64Ty, 0), entry);
+        llvm::Value *remaining = b.CreateSub(size, copied, "remaining");
+        b.CreateCondBr(b.CreateICmpUGT(remaining, llvm::ConstantInt::get(i64Ty, 0)), copy, done);
+
+        b.SetInsertPoint(copy);
+        llvm::Value *limit = llvm::ConstantInt::get(i64Ty, OutputBuffer);
+        llvm::Value *piece = b.CreateSelect(b.CreateICmpULT(remaining, limit), remaining, limit, "piece");
+        llvm::Value *out = b.CreateCall(reserve, {piece}, "out");
+        b.CreateMemCpy(out, llvm::MaybeAlign(1), b.CreateGEP(i8Ty, data, copied), llvm::MaybeAlign(1), piece);
+        advance(b, piece);
+        copied->addIncoming(b.CreateAdd(copied, piece), copy);
+        b.CreateBr(loop);
+
+        b.SetInsertPoint(done);
+        llvm::Value *newline = b.CreateCall(reserve, {llvm::ConstantInt::get(i64Ty, 1)}, "newline");
+        b.CreateStore(llvm::ConstantInt::get(i8Ty, '\n'), newline);
+        advance(b, llvm::ConstantInt::get(i64Ty, 1));
+        b.CreateRetVoid();
+        return function;
+    }
+
+    // ptr easyrust_str_alloc(i64 size): reserva `size` bytes del arena.
+    // Los pedidos grandes van directo a malloc para no descartar el bloque actual.
+    llvm::Function *getAllocFunction()
+    {
+        if (allocFunc)
+            return allocFunc;
+        llvm::Type *i64Ty = llvm::Type::getInt64Ty(context);
+        llvm::Type *i8Ty = llvm::Type::getInt8Ty(context);
+        llvm::PointerType *ptrTy = llvm::PointerType::getUnqual(context);
+        llvm::FunctionCallee mallocFunc =
+            module.getOrInsertFunction("malloc", llvm::FunctionType::get(ptrTy, {i64Ty}, false));
+
+        allocFunc = llvm::Function::Create(llvm::FunctionType::get(ptrTy, {i64Ty}, false),
+                                           llvm::Function::LinkOnceODRLinkage, "easyrust_str_alloc", module);
+        allocFunc->setVisibility(llvm::GlobalValue::HiddenVisibility);
+        llvm::Argument *size = allocFunc->getArg(0);
+        size->setName("size");
+        llvm::GlobalVariable *cur = arenaGlobal("easyrust.arena.cur");
+        llvm::GlobalVariable *end = arenaGlobal("easyrust.arena.end");
+
+        llvm::BasicBlock *entry = llvm::BasicBlock::Create(context, "entry", allocFunc);
+        llvm::BasicBlock *fast = llvm::BasicBlock::Create(context, "fast", allocFunc);
+        llvm::BasicBlock *slow = llvm::BasicBlock::Create(context, "slow", allocFunc);
+        llvm::BasicBlock *large = llvm::BasicBlock::Create(context, "large", allocFunc);
+        llvm::BasicBlock *refill = llvm::BasicBlock::Create(context, "refill", allocFunc);
+        llvm::IRBuilder<> b(entry);
+
+        llvm::Value *curPtr = b.CreateLoad(ptrTy, cur, "cur");
+        llvm::Value *endPtr = b.CreateLoad(ptrTy, end, "end");
+        llvm::Value *avail = b.CreateSub(b.CreatePtrToInt(endPtr, i64Ty), b.CreatePtrToInt(curPtr, i64Ty), "avail");
+        b.CreateCondBr(b.CreateICmpULE(size, avail), fast, slow);
+
+        b.SetInsertPoint(fast);
+        b.CreateStore(b.CreateGEP(i8Ty, curPtr, size, "next"), cur);
+        b.CreateRet(curPtr);
+
+        b.SetInsertPoint(slow);
+        llvm::Value *chunk = llvm::ConstantInt::get(i64Ty, ArenaChunk);
+        b.CreateCondBr(b.CreateICmpUGT(size, b.CreateLShr(chunk, 2)), large, refill);
+
+        b.SetInsertPoint(large);
+        b.CreateRet(b.CreateCall(mallocFunc, {size}, "block"));
+
+        b.SetInsertPoint(refill);
+        llvm::Value *block = b.CreateCall(mallocFunc, {chunk}, "block");
+        b.CreateStore(b.CreateGEP(i8Ty, block, size), cur);
+        b.CreateStore(b.CreateGEP(i8Ty, block, chunk), end);
+        b.CreateRet(block);
+        return allocFunc;
+    }
+
+public:
+    // Tamaño de cada bloque del arena de cadenas
+    static constexpr uint64_t ArenaChunk = 64 * 1024;
+    // Tamaño del buffer de salida de print
+    static constexpr uint64_t OutputBuffer = 64 * 1024;
+
+    explicit EasyRustRuntime(llvm::Module &module)
+        : module(module), context(module.getContext()),
+          stringType(namedPair("easyrust.str"))
+    {
+    }
+
+    llvm::StructType *getStringType() const
+    {
+        return stringType;
+    }
+
+    bool isString(llvm::Value *value) const
+    {
+        return value->getType() == stringType;
+    }
+
+    llvm::StructType *getArrayType(llvm::Type *element)
+    {
+        llvm::StructType *&type = arrayTypes[element];
+        if (!type)
+        {
+            std::string name;
+            llvm::raw_string_ostream os(name);
+            os << "easyrust.array.";
+            if (element == stringType)
+                os << "str";
+            else
+                element->print(os);
+            type = namedPair(os.str());
+            arrayElements[type] = element;
+        }
+        return type;
+    }
+
+    // Tipo de los elementos si `type` es un arreglo, si no nullptr
+    llvm::Type *arrayElementType(llvm::Type *type) const
+    {
+        return arrayElements.lookup(type);
+    }
+
+    // Bytes que ocupa un elemento (con el data layout del módulo, o el por defecto)
+    uint64_t elementSize(llvm::Type *element) const
+    {
+        return module.getDataLayout().getTypeAllocSize(element);
+    }
+
+    // Arreglo {datos, longitud}
+    llvm::Value *makeArray(llvm::IRBuilderBase &builder, llvm::StructType *arrayType, llvm::Value *data,
+                           llvm::Value *length)
+    {
+        llvm::Value *array = builder.CreateInsertValue(llvm::PoisonValue::get(arrayType), data, 0);
+        return builder.CreateInsertValue(array, length, 1, "array");
+    }
+
+    llvm::Value *arrayData(llvm::IRBuilderBase &builder, llvm::Value *array)
+    {
+        return builder.CreateExtractValue(array, 0, "array.data");
+    }
+
+    // Longitud (i64); si el arreglo se acaba de construir se usa el valor
+    // insertado, que suele ser constante
+    llvm::Value *arrayLength(llvm::IRBuilderBase &builder, llvm::Value *array)
+    {
+        if (auto *insert = llvm::dyn_cast<llvm::InsertValueInst>(array))
+            if (insert->getIndices()[0] == 1)
+                return insert->getInsertedValueOperand();
+        return builder.CreateExtractValue(array, 1, "array.len");
+    }
+
+    // Elementos en el heap (arreglos dinámicos o grandes); no se liberan
+    llvm::Value *allocateElements(llvm::IRBuilderBase &builder, llvm::Type *element, llvm::Value *length)
+    {
+        llvm::Type *i64Ty = llvm::Type::getInt64Ty(context);
+        llvm::FunctionCallee mallocFunc =
+            module.getOrInsertFunction("malloc", llvm::FunctionType::get(llvm::PointerType::getUnqual(context), {i64Ty}, false));
+        llvm::Value *bytes = builder.CreateMul(length, llvm::ConstantInt::get(i64Ty, elementSize(element)), "bytes");
+        return builder.CreateCall(mallocFunc, {bytes}, "elements");
+    }
+
+    // void easyrust_panic(ptr formato, i64, i64): vacía la salida, escribe el
+    // mensaje en stderr y termina con código 101. Es cold y noreturn para que
+    // los chequeos no estorben al optimizador en el camino normal.
+    llvm::Function *getPanicFunction()
+    {
+        llvm::Type *i32Ty = llvm::Type::getInt32Ty(context);
+        llvm::Type *i64Ty = llvm::Type::getInt64Ty(context);
+        llvm::PointerType *ptrTy = llvm::PointerType::getUnqual(context);
+        llvm::Function *function;
+        llvm::Function *existing = runtimeFunction(
+            "easyrust_panic", llvm::FunctionType::get(llvm::Type::getVoidTy(context), {ptrTy, i64Ty, i64Ty}, false),
+            function);
+        if (!function)
+            return existing;
+        function->addFnAttr(llvm::Attribute::NoReturn);
+        function->addFnAttr(llvm::Attribute::Cold);
+        function->addFnAttr(llvm::Attribute::NoInline);
+        llvm::FunctionCallee dprintfFunc =
+            module.getOrInsertFunction("dprintf", llvm::FunctionType::get(i32Ty, {i32Ty, ptrTy}, true));
+        llvm::FunctionCallee exitFunc = module.getOrInsertFunction(
+            "exit", llvm::FunctionType::get(llvm::Type::getVoidTy(context), {i32Ty}, false));
+
+        llvm::IRBuilder<> b(llvm::BasicBlock::Create(context, "entry", function));
+        b.CreateCall(getFlushFunction());
+        b.CreateCall(dprintfFunc, {llvm::ConstantInt::get(i32Ty, 2), function->getArg(0), function->getArg(1),
+                                   function->getArg(2)});
+        b.CreateCall(exitFunc, {llvm::ConstantInt::get(i32Ty, 101)});
+        b.CreateUnreachable();
+        return function;
+    }
+
+    // Si `ok` es falso se llama a easyrust_panic con el mensaje (formato con dos %lld)
+    void emitCheck(llvm::IRBuilderBase &builder, llvm::Value *ok, llvm::StringRef format, llvm::Value *a,
+                   llvm::Value *b)
+    {
+        if (auto *constant = llvm::dyn_cast<llvm::ConstantInt>(ok))
+            if (constant->isOne())
+                return;
+        llvm::Function *function = builder.GetInsertBlock()->getParent();
+        llvm::BasicBlock *fail = llvm::BasicBlock::Create(context, "check.fail", function);
+        llvm::BasicBlock *cont = llvm::BasicBlock::Create(context, "check.ok", function);
+        llvm::MDBuilder weights(context);
+        builder.CreateCondBr(ok, cont, fail, weights.createBranchWeights(2000, 1));
+
+        builder.SetInsertPoint(fail);
+        builder.CreateCall(getPanicFunction(), {constantString(format, "panic_fmt"), a, b});
+        builder.CreateUnreachable();
+        builder.SetInsertPoint(cont);
+    }
+
+    // Texto constante terminado en '\0'. Textos iguales comparten el mismo
+    // global en todo el módulo (literales repetidos, formatos).
+    llvm::GlobalVariable *constantString(llvm::StringRef value, llvm::StringRef name)
+    {
+        llvm::GlobalVariable *&global = constantPool[value];
+        if (global)
+            return global;
+        llvm::Constant *init = llvm::ConstantDataArray::getString(context, value);
+        global = new llvm::GlobalVariable(module, init->getType(), true, llvm::GlobalValue::PrivateLinkage, init,
+                                          name);
+        global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+        global->setAlignment(llvm::Align(1));
+        return global;
+    }
+
+    // Literal de cadena: {datos constantes, longitud}
+    llvm::Constant *stringLiteral(llvm::StringRef value)
+    {
+        llvm::Constant *data = constantString(value, "string_literal");
+        return llvm::ConstantStruct::get(
+            stringType, {data, llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), value.size())});
+    }
+
+    llvm::Value *data(llvm::IRBuilderBase &builder, llvm::Value *str)
+    {
+        return builder.CreateExtractValue(str, 0, "str.data");
+    }
+
+    llvm::Value *length(llvm::IRBuilderBase &builder, llvm::Value *str)
+    {
+        return builder.CreateExtractValue(str, 1, "str.len");
+    }
+
+    // Concatena todas las partes con una sola reserva del tamaño exacto y un
+    // memcpy por parte (a + b + c + d no crea cadenas intermedias)
+    llvm::Value *concat(llvm::IRBuilderBase &builder, llvm::ArrayRef<llvm::Value *> parts)
+    {
+        llvm::Type *i64Ty = llvm::Type::getInt64Ty(context);
+        llvm::Type *i8Ty = llvm::Type::getInt8Ty(context);
+
+        std::vector<llvm::Value *> lengths;
+        llvm::Value *total = nullptr;
+        for (llvm::Value *part : parts)
+        {
+            lengths.push_back(length(builder, part));
+            total = total ? builder.CreateAdd(total, lengths.back(), "concat.len") : lengths.back();
+        }
+        llvm::Value *buffer = builder.CreateCall(
+            getAllocFunction(), {builder.CreateAdd(total, llvm::ConstantInt::get(i64Ty, 1))}, "concat.buf");
+
+        llvm::Value *offset = nullptr;
+        for (size_t i = 0; i < parts.size(); i++)
+        {
+            llvm::Value *dest = offset ? builder.CreateGEP(i8Ty, buffer, offset) : buffer;
+            builder.CreateMemCpy(dest, llvm::MaybeAlign(1), data(builder, parts[i]), llvm::MaybeAlign(1), lengths[i]);
+            offset = offset ? builder.CreateAdd(offset, lengths[i]) : lengths[i];
+        }
+        builder.CreateStore(llvm::ConstantInt::get(i8Ty, 0), builder.CreateGEP(i8Ty, buffer, total));
+
+        llvm::Value *result = builder.CreateInsertValue(llvm::PoisonValue::get(stringType), buffer, 0);
+        return builder.CreateInsertValue(result, total, 1, "concat");
+    }
+
+    // print: llama al escritor del tipo del valor; false si el tipo no se puede imprimir
+    bool emitPrint(llvm::IRBuilderBase &builder, llvm::Value *value)
+    {
+        llvm::Type *type = value->getType();
+        if (type->isIntegerTy(1))
+            builder.CreateCall(getPrintBoolFunction(), {value});
+        else if (type->isIntegerTy(32))
+            builder.CreateCall(getPrintIntFunction(), {value});
+        else if (type->isDoubleTy())
+            builder.CreateCall(getPrintFloatFunction(), {value});
+        else if (isString(value))
+            builder.CreateCall(getPrintStringFunction(), {data(builder, value), length(builder, value)});
+        else
+            return false;
+        return true;
+    }
+
+    // Vacía la salida pendiente antes de cada retorno de `main`. Se agrega
+    // siempre: lo que imprimen las funciones de otros módulos (import,
+    // --codegen-threads) va al mismo buffer aunque main no imprima.
+    void flushBeforeReturns(llvm::Function &main)
+    {
+        llvm::Function *flush = getFlushFunction();
+        for (llvm::BasicBlock &block : main)
+            if (auto *ret = llvm::dyn_cast_or_null<llvm::ReturnInst>(block.getTerminator()))
+                llvm::CallInst::Create(flush, "", ret);
+    }
+};
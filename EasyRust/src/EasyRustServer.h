@@ -0,0 +1,428 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "EasyRustBackend.h"
+#include "EasyRustCache.h"
+#include "EasyRustCompiler.h"
+#include "EasyRustDiagnostics.h"
+#include "EasyRustOptions.h"
+
+// Protocolo del servidor de compilación (socket Unix local). Cada mensaje es
+// una secuencia de tramas "<longitud u64><bytes>":
+//   saludo:    "EASYRUST3", identidad del compilador (versión y LLVM)
+//   respuesta: "ok", o "version" si el servidor es de otra compilación
+//   solicitud: modo ("obj" | "ir"), nivel ("O0".."Os"), pipeline,
+//              opciones de generación (EasyRustOptions::codegenFlags), código fuente
+//   respuesta: estado ("ok" | "error"), diagnósticos, contenido (objeto o IR), µs en el servidor
+namespace EasyRustProtocol
+{
+    inline const char *Magic = "EASYRUST3";
+    inline const uint64_t MaxFrame = 256ull << 20;
+    inline const int RequestTimeoutSeconds = 30; // Por lectura o escritura en el servidor
+
+    // Un demonio iniciado desde otra compilación genera otro código: el
+    // cliente solo le reenvía trabajo si la identidad coincide
+    inline std::string compilerIdentity()
+    {
+        return std::string(EASYRUST_COMPILER_VERSION) + " LLVM " + LLVM_VERSION_STRING;
+    }
+
+    inline std::string defaultSocketPath()
+    {
+        if (const char *env = std::getenv("EASYRUST_SOCKET"))
+            return env;
+        if (const char *runtime = std::getenv("XDG_RUNTIME_DIR"))
+            return std::string(runtime) + "/easyrust.sock";
+        return "/tmp/easyrust-" + std::to_string(getuid()) + ".sock";
+    }
+
+    inline bool writeAll(int fd, const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL); // Sin SIGPIPE si el otro extremo cierra
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    inline bool readAll(int fd, char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t n = ::read(fd, data, size);
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    inline bool sendFrame(int fd, llvm::StringRef data)
+    {
+        uint64_t size = data.size();
+        return writeAll(fd, reinterpret_cast<const char *>(&size), sizeof(size)) &&
+               writeAll(fd, data.data(), data.size());
+    }
+
+    inline bool recvFrame(int fd, std::string &data)
+    {
+        uint64_t size = 0;
+        if (!readAll(fd, reinterpret_cast<char *>(&size), sizeof(size)) || size > MaxFrame)
+            return false;
+        data.resize(size);
+        return readAll(fd, data.data(), size);
+    }
+
+    inline int connectTo(const std::string &path)
+    {
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path))
+            return -1;
+        addr.sun_family = AF_UNIX;
+        std::copy(path.begin(), path.end(), addr.sun_path);
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // Envía el saludo; true si el servidor es de esta misma compilación
+    inline bool handshake(int fd)
+    {
+        std::string reply;
+        return sendFrame(fd, Magic) && sendFrame(fd, compilerIdentity()) && recvFrame(fd, reply) && reply == "ok";
+    }
+}
+
+// Demonio de compilación (--server): mantiene inicializados ANTLR y los
+// targets de LLVM y atiende solicitudes con un grupo fijo de hilos; cada hilo
+// reutiliza sus TargetMachine por nivel de optimización.
+class EasyRustServer
+{
+private:
+    std::string socketPath;
+    EasyRustOptions baseOptions;
+    std::unique_ptr<EasyRustCache> cache;
+
+    std::mutex queueMutex;
+    std::condition_variable queueCond;
+    std::deque<int> pending;
+    std::atomic<uint64_t> requestCount{0};
+    std::mutex logMutex;
+
+    void handle(int fd, std::map<std::string, EasyRustBackend> &backends)
+    {
+        std::string magic, identity, mode, level, pipeline, flags, source;
+        if (!EasyRustProtocol::recvFrame(fd, magic) || magic != EasyRustProtocol::Magic ||
+            !EasyRustProtocol::recvFrame(fd, identity))
+            return;
+        if (identity != EasyRustProtocol::compilerIdentity())
+        {
+            EasyRustProtocol::sendFrame(fd, "version");
+            std::lock_guard<std::mutex> lock(logMutex);
+            std::cerr << "Cliente de otra versión rechazado (" << identity << ")\n";
+            return;
+        }
+        // Un cliente que solo comprueba la versión cierra la conexión aquí
+        if (!EasyRustProtocol::sendFrame(fd, "ok") ||
+            !EasyRustProtocol::recvFrame(fd, mode) || !EasyRustProtocol::recvFrame(fd, level) ||
+            !EasyRustProtocol::recvFrame(fd, pipeline) || !EasyRustProtocol::recvFrame(fd, flags) ||
+            !EasyRustProtocol::recvFrame(fd, source))
+            return;
+        auto start = std::chrono::steady_clock::now();
+
+        // Los errores de sintaxis y de generación vuelven al cliente, no a la consola del demonio
+        std::string captured;
+        EasyRustDiagnostics::Capture capture(captured);
+        EasyRustOptions options = baseOptions;
+        options.passPipeline = pipeline;
+        options.emitLLVM = false;
+        std::string error;
+        std::ostringstream log;
+        std::string payload;
+        bool ok = EasyRustOptions::parseOptLevel("-" + level, options.optLevel);
+        if (!ok)
+            error = "Nivel de optimización no válido: " + level;
+        else
+            options.optLevelName = level;
+        if (ok && !options.applyCodegenFlags(flags))
+        {
+            ok = false;
+            error = "Opciones de generación no válidas: " + flags;
+        }
+
+        EasyRustBackend *backend = nullptr;
+        if (ok)
+        {
+            auto found = backends.find(level);
+            if (found == backends.end())
+            {
+                found = backends.emplace(level, EasyRustBackend()).first;
+                if (!found->second.init(options.optLevel, error))
+                {
+                    backends.erase(found);
+                    ok = false;
+                }
+            }
+            if (ok)
+                backend = &found->second;
+        }
+
+        if (ok && mode == "ir")
+        {
+            ok = EasyRustCompiler::compileToIR(source, options, *backend, payload, error);
+        }
+        else if (ok)
+        {
+            llvm::SmallVector<char, 0> object;
+            ok = EasyRustCompiler::compileSource(source, options, *backend, cache.get(), "", object, log, error);
+            payload.assign(object.begin(), object.end());
+        }
+
+        capture.flush();
+        std::string diagnostics = captured + log.str();
+        if (!ok)
+            diagnostics += "Error: " + error + "\n";
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+        EasyRustProtocol::sendFrame(fd, ok ? "ok" : "error");
+        EasyRustProtocol::sendFrame(fd, diagnostics);
+        EasyRustProtocol::sendFrame(fd, payload);
+        EasyRustProtocol::sendFrame(fd, std::to_string(micros));
+
+        uint64_t id = ++requestCount;
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::cerr << "Solicitud #" << id << " (" << mode << ", -" << level << "): "
+                  << micros / 1000.0 << " ms" << (ok ? "" : " [error]") << "\n";
+    }
+
+    void workerLoop()
+    {
+        std::map<std::string, EasyRustBackend> backends; // Un TargetMachine por nivel y por hilo
+        while (true)
+        {
+            int fd;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCond.wait(lock, [&]
+                               { return !pending.empty(); });
+                fd = pending.front();
+                pending.pop_front();
+            }
+            handle(fd, backends);
+            ::close(fd);
+        }
+    }
+
+public:
+    EasyRustServer(std::string socketPath, const EasyRustOptions &options)
+        : socketPath(std::move(socketPath)), baseOptions(options)
+    {
+        if (options.useCache)
+            cache = std::make_unique<EasyRustCache>(
+                options.cacheDir.empty() ? EasyRustCache::defaultDirectory() : options.cacheDir,
+                options.cacheMaxBytes);
+    }
+
+    // Bucle principal; solo retorna si no se pudo abrir el socket
+    bool serve(unsigned jobs, std::string &error)
+    {
+        EasyRustBackend::initializeTargets();
+
+        // Calentar ANTLR (deserialización del ATN) y LLVM antes de aceptar clientes
+        EasyRustCompiler::generateModule("let x : int = 0;", baseOptions);
+
+        sockaddr_un addr{};
+        if (socketPath.size() >= sizeof(addr.sun_path))
+        {
+            error = "Ruta de socket demasiado larga: " + socketPath;
+            return false;
+        }
+        addr.sun_family = AF_UNIX;
+        std::copy(socketPath.begin(), socketPath.end(), addr.sun_path);
+
+        // Solo se borra un socket obsoleto: si otro demonio responde, o la ruta
+        // no es un socket, no se toca
+        struct stat existing;
+        if (::lstat(socketPath.c_str(), &existing) == 0)
+        {
+            if (!S_ISSOCK(existing.st_mode))
+            {
+                error = socketPath + " existe y no es un socket";
+                return false;
+            }
+            int probe = EasyRustProtocol::connectTo(socketPath);
+            if (probe >= 0)
+            {
+                ::close(probe);
+                error = "Ya hay un servidor escuchando en " + socketPath;
+                return false;
+            }
+            ::unlink(socketPath.c_str());
+        }
+
+        int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd < 0)
+        {
+            error = "No se pudo crear el socket";
+            return false;
+        }
+        // Solo el usuario que lo inició puede usar el demonio (en /tmp lo verían todos)
+        mode_t previousMask = ::umask(0177);
+        bool bound = ::bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+        ::umask(previousMask);
+        if (!bound || ::chmod(socketPath.c_str(), 0600) != 0 || ::listen(listenFd, 64) != 0)
+        {
+            error = "No se pudo escuchar en " + socketPath;
+            ::close(listenFd);
+            return false;
+        }
+
+        for (unsigned i = 0; i < jobs; i++)
+            std::thread(&EasyRustServer::workerLoop, this).detach();
+        std::cerr << "Servidor de compilación escuchando en " << socketPath << " con " << jobs << " hilos\n";
+
+        while (true)
+        {
+            int fd = ::accept(listenFd, nullptr, nullptr);
+            if (fd < 0)
+                continue;
+            // Un cliente que se conecta y no envía nada no retiene a un hilo para siempre
+            timeval timeout{EasyRustProtocol::RequestTimeoutSeconds, 0};
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                pending.push_back(fd);
+            }
+            queueCond.notify_one();
+        }
+    }
+};
+
+// Cliente ligero: reenvía la compilación al servidor si está en ejecución
+class EasyRustClient
+{
+public:
+    // El servidor está en ejecución y es de esta misma compilación del
+    // compilador; si no, se compila localmente
+    static bool available(const std::string &socketPath)
+    {
+        int fd = EasyRustProtocol::connectTo(socketPath);
+        if (fd < 0)
+            return false;
+        bool same = EasyRustProtocol::handshake(fd);
+        ::close(fd);
+        return same;
+    }
+
+    // Envía una solicitud y espera la respuesta. Retorna false si falló la
+    // comunicación o el servidor es de otra versión.
+    static bool request(const std::string &socketPath, const std::string &mode, const EasyRustOptions &options,
+                        const std::string &source, bool &ok, std::string &diagnostics,
+                        std::string &payload, double &serverMs)
+    {
+        int fd = EasyRustProtocol::connectTo(socketPath);
+        if (fd < 0)
+            return false;
+        std::string status, micros;
+        bool sent = EasyRustProtocol::handshake(fd) &&
+                    EasyRustProtocol::sendFrame(fd, mode) &&
+                    EasyRustProtocol::sendFrame(fd, options.optLevelName) &&
+                    EasyRustProtocol::sendFrame(fd, options.passPipeline) &&
+                    EasyRustProtocol::sendFrame(fd, options.codegenFlags()) &&
+                    EasyRustProtocol::sendFrame(fd, source);
+        bool received = sent && EasyRustProtocol::recvFrame(fd, status) &&
+                        EasyRustProtocol::recvFrame(fd, diagnostics) &&
+                        EasyRustProtocol::recvFrame(fd, payload) &&
+                        EasyRustProtocol::recvFrame(fd, micros);
+        ::close(fd);
+        if (!received)
+            return false;
+        ok = status == "ok";
+        serverMs = std::atof(micros.c_str()) / 1000.0;
+        return true;
+    }
+
+    // Equivalente a EasyRustCompiler::compileFile pero compilando en el servidor
+    static EasyRustCompiler::FileResult compileFile(const std::string &socketPath, const std::string &inputFile,
+                                                    const EasyRustOptions &options)
+    {
+        EasyRustCompiler::FileResult result;
+        std::ostringstream log;
+        std::string error;
+
+        std::string source;
+        if (!EasyRustCompiler::readSource(inputFile, source))
+        {
+            result.errors = "Error: No se pudo abrir el archivo " + inputFile + "\n";
+            return result;
+        }
+        // El servidor solo recibe el código: los import se resuelven y compilan aquí
+        if (!EasyRustProgram::scanImports(source).empty())
+            return EasyRustCompiler::compileFile(inputFile, options, nullptr);
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok = false;
+        std::string diagnostics, object;
+        double serverMs = 0;
+        // El servidor se detuvo o se reemplazó por otra versión desde que se comprobó
+        if (!request(socketPath, "obj", options, source, ok, diagnostics, object, serverMs))
+        {
+            EasyRustBackend::initializeTargets();
+            result = EasyRustCompiler::compileFile(inputFile, options, nullptr);
+            result.log = "El servidor " + socketPath + " no respondió; compilado localmente\n" + result.log;
+            return result;
+        }
+        double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!ok)
+        {
+            result.errors = diagnostics;
+            return result;
+        }
+        log << diagnostics;
+        log << "Compilado por el servidor en " << totalMs << " ms (servidor: " << serverMs << " ms)\n";
+
+        std::string base_name = EasyRustCompiler::baseName(inputFile);
+        if (!EasyRustCompiler::writeOutputs(base_name, llvm::ArrayRef<char>(object.data(), object.size()),
+                                            options, log, error))
+        {
+            result.log = log.str();
+            result.errors = "Error: " + error + "\n";
+            return result;
+        }
+        result.ok = true;
+        result.log = log.str();
+        return result;
+    }
+};
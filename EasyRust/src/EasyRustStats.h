@@ -0,0 +1,177 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "llvm/IR/Module.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+
+// Métricas de una compilación (--stats=json): tiempo de pared, tiempo de CPU
+// del hilo y memoria por fase, contadores y tiempos de los pases de LLVM.
+// Se serializa como un registro JSON de una línea por archivo compilado.
+class EasyRustStats
+{
+private:
+    struct Phase
+    {
+        std::string name;
+        double wallMs;
+        double cpuMs;
+        long rssDeltaKb;       // Crecimiento del RSS durante la fase (negativo si se liberó memoria)
+        long processPeakRssKb; // Máximo del proceso hasta el final de la fase, no de la fase
+    };
+
+    std::string file;
+    std::vector<Phase> phases;
+    std::map<std::string, uint64_t> counters;
+    std::map<std::string, uint64_t> functionInstructions;
+    std::map<std::string, std::pair<double, uint64_t>> passTimes; // ms acumulados, ejecuciones
+
+    // CPU del hilo actual (la compilación en lote usa un hilo por archivo)
+    static double threadCpuMs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+    }
+
+    // RSS actual del proceso en KB (/proc/self/statm). Es del proceso: con
+    // -j incluye lo que asignan a la vez las compilaciones de otros archivos.
+    static long currentRssKb()
+    {
+        std::ifstream statm("/proc/self/statm");
+        long size = 0, resident = 0;
+        if (!(statm >> size >> resident))
+            return 0;
+        return resident * (sysconf(_SC_PAGESIZE) / 1024);
+    }
+
+    // RSS máximo del proceso en KB
+    static long processPeakRssKb()
+    {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+public:
+    // Mide una fase desde su construcción hasta su destrucción. Acepta
+    // nullptr para que el código instrumentado no tenga que comprobarlo.
+    class Scope
+    {
+    private:
+        EasyRustStats *stats;
+        std::string name;
+        std::chrono::steady_clock::time_point wallStart;
+        double cpuStart;
+        long rssStart;
+
+    public:
+        Scope(EasyRustStats *stats, std::string name)
+            : stats(stats), name(std::move(name))
+        {
+            if (!stats)
+                return;
+            wallStart = std::chrono::steady_clock::now();
+            cpuStart = threadCpuMs();
+            rssStart = currentRssKb();
+        }
+
+        ~Scope()
+        {
+            if (!stats)
+                return;
+            double wall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+            stats->phases.push_back(
+                {name, wall, threadCpuMs() - cpuStart, currentRssKb() - rssStart, processPeakRssKb()});
+        }
+    };
+
+    explicit EasyRustStats(std::string file) : file(std::move(file)) {}
+
+    void setCounter(const std::string &name, uint64_t value)
+    {
+        counters[name] = value;
+    }
+
+    void addPassTime(const std::string &pass, double ms)
+    {
+        auto &entry = passTimes[pass];
+        entry.first += ms;
+        entry.second++;
+    }
+
+    // Tiempo de pared acumulado por fase (usado por el banco de pruebas)
+    std::map<std::string, double> phaseWallMs() const
+    {
+        std::map<std::string, double> totals;
+        for (const Phase &phase : phases)
+            totals[phase.name] += phase.wallMs;
+        return totals;
+    }
+
+    // Instrucciones de IR por función definida
+    void recordModule(const llvm::Module &module)
+    {
+        uint64_t total = 0;
+        for (const llvm::Function &function : module)
+        {
+            if (function.isDeclaration())
+                continue;
+            functionInstructions[function.getName().str()] = function.getInstructionCount();
+            total += function.getInstructionCount();
+        }
+        counters["ir_instructions"] = total;
+        counters["ir_functions"] = functionInstructions.size();
+    }
+
+    std::string toJSON() const
+    {
+        llvm::json::Array phaseArray;
+        for (const Phase &phase : phases)
+            phaseArray.push_back(llvm::json::Object{
+                {"name", phase.name},
+                {"wall_ms", phase.wallMs},
+                {"cpu_ms", phase.cpuMs},
+                {"rss_delta_kb", static_cast<int64_t>(phase.rssDeltaKb)},
+                {"process_peak_rss_kb", static_cast<int64_t>(phase.processPeakRssKb)}});
+
+        llvm::json::Object counterObject;
+        for (const auto &[name, value] : counters)
+            counterObject[name] = static_cast<int64_t>(value);
+
+        llvm::json::Object functionObject;
+        for (const auto &[name, value] : functionInstructions)
+            functionObject[name] = static_cast<int64_t>(value);
+
+        llvm::json::Array passArray;
+        for (const auto &[name, entry] : passTimes)
+            passArray.push_back(llvm::json::Object{
+                {"name", name},
+                {"ms", entry.first},
+                {"runs", static_cast<int64_t>(entry.second)}});
+
+        llvm::json::Object record{
+            {"file", file},
+            {"phases", std::move(phaseArray)},
+            {"counters", std::move(counterObject)},
+            {"ir_instructions_per_function", std::move(functionObject)},
+            {"passes", std::move(passArray)},
+            {"process_peak_rss_kb", static_cast<int64_t>(processPeakRssKb())}};
+
+        std::string out;
+        llvm::raw_string_ostream os(out);
+        os << llvm::json::Value(std::move(record));
+        os.flush();
+        return out;
+    }
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "llvm/IR/Type.h"
+#include "llvm/IR/Value.h"
+
+#include "EasyRustAST.h"
+
+// Tabla de símbolos con ámbitos léxicos, indexada por el id del símbolo
+// internado (sin hashear cadenas). Las declaraciones se apilan; cada símbolo
+// apunta a su declaración visible y cada entrada recuerda la que ocultó, así
+// que abrir un ámbito es O(1) y cerrarlo deshace solo lo que se declaró en él.
+//
+// Las funciones abren un ámbito "de función": desde adentro no se ven las
+// variables locales de main ni de otra función.
+class EasyRustSymbolTable
+{
+public:
+    struct Entry
+    {
+        EasyRustAST::TypeSpec type;
+        llvm::Type *llvmType;
+        llvm::Value *storage; // AllocaInst de la variable (nullptr con SSA directo)
+        unsigned variable;    // Id único de la declaración (las redeclaraciones son otra variable)
+        EasyRustAST::Symbol symbol;
+        int previous; // Declaración que esta oculta (-1 si ninguna)
+    };
+
+private:
+    std::vector<Entry> entries;
+    std::vector<int> visible;       // Por símbolo: índice en `entries` o -1
+    std::vector<size_t> scopeStart; // Tamaño de `entries` al abrir cada ámbito
+    std::vector<size_t> functionStart;
+    unsigned variableCount = 0;
+
+public:
+    explicit EasyRustSymbolTable(unsigned symbolCount = 0) : visible(symbolCount, -1) {}
+
+    void pushScope()
+    {
+        scopeStart.push_back(entries.size());
+    }
+
+    void popScope()
+    {
+        size_t start = scopeStart.back();
+        scopeStart.pop_back();
+        while (entries.size() > start)
+        {
+            visible[entries.back().symbol.id] = entries.back().previous;
+            entries.pop_back();
+        }
+    }
+
+    void pushFunction()
+    {
+        functionStart.push_back(entries.size());
+        pushScope();
+    }
+
+    void popFunction()
+    {
+        popScope();
+        functionStart.pop_back();
+    }
+
+    // Declara (o redeclara en el mismo ámbito) una variable; retorna su id
+    unsigned declare(EasyRustAST::Symbol symbol, EasyRustAST::TypeSpec type, llvm::Type *llvmType,
+                     llvm::Value *storage)
+    {
+        if (symbol.id >= visible.size())
+            visible.resize(symbol.id + 1, -1);
+        int current = visible[symbol.id];
+        size_t start = scopeStart.empty() ? 0 : scopeStart.back();
+        if (current >= 0 && static_cast<size_t>(current) >= start)
+        {
+            Entry &entry = entries[current];
+            entry.type = type;
+            entry.llvmType = llvmType;
+            entry.storage = storage;
+            entry.variable = variableCount++;
+            return entry.variable;
+        }
+        entries.push_back({type, llvmType, storage, variableCount++, symbol, current});
+        visible[symbol.id] = static_cast<int>(entries.size() - 1);
+        return entries.back().variable;
+    }
+
+    // Declaración visible o nullptr. El puntero es válido hasta la próxima declaración.
+    const Entry *lookup(EasyRustAST::Symbol symbol) const
+    {
+        if (symbol.id >= visible.size())
+            return nullptr;
+        int index = visible[symbol.id];
+        size_t barrier = functionStart.empty() ? 0 : functionStart.back();
+        if (index < 0 || static_cast<size_t>(index) < barrier)
+            return nullptr;
+        return &entries[index];
+    }
+};
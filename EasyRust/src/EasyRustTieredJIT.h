@@ -0,0 +1,330 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include "EasyRustJIT.h"
+#include "EasyRustOptimizer.h"
+
+// Compilación por niveles sobre ORC (modo --tiered):
+//  - Nivel 0: todo el módulo se compila a -O0. Cada función de usuario se
+//    renombra a `<f>.t0` y su nombre original pasa a ser un stub que cuenta
+//    las entradas y salta indirectamente a través de `<f>.ptr`.
+//  - Cuando el contador llega al umbral, el stub avisa al runtime y un hilo
+//    en segundo plano recompila la función a nivel alto (`<f>.t2`) y
+//    actualiza `<f>.ptr`, de modo que las siguientes llamadas usan la nueva versión.
+class EasyRustTieredJIT
+{
+private:
+    struct TieredFunction
+    {
+        std::string name;
+        uint64_t *counter = nullptr;         // `<f>.count` dentro del código JIT
+        std::atomic<void *> *slot = nullptr; // `<f>.ptr` dentro del código JIT
+        double requestedAt = -1;             // ms desde el inicio
+        double promotedAt = -1;
+    };
+
+    EasyRustJIT jit; // Nivel 0
+    llvm::OptimizationLevel tierLevel;
+    uint64_t threshold;
+    std::chrono::steady_clock::time_point start;
+
+    std::unique_ptr<llvm::TargetMachine> targetMachine; // PassBuilder del hilo de fondo
+    llvm::SmallVector<char, 0> bitcode;                 // Módulo original, antes de instrumentar
+    std::vector<TieredFunction> functions;
+
+    std::thread worker;
+    std::mutex queueMutex;
+    std::condition_variable queueCond;
+    std::deque<uint32_t> queue;
+    bool stopping = false;
+
+    static EasyRustTieredJIT *&active()
+    {
+        static EasyRustTieredJIT *instance = nullptr;
+        return instance;
+    }
+
+    // Llamado desde el código JIT cuando una función supera el umbral
+    static void tierRequest(uint32_t id)
+    {
+        EasyRustTieredJIT *self = active();
+        if (!self || id >= self->functions.size())
+            return;
+        self->functions[id].requestedAt = self->elapsedMs();
+        {
+            std::lock_guard<std::mutex> lock(self->queueMutex);
+            self->queue.push_back(id);
+        }
+        self->queueCond.notify_one();
+    }
+
+    double elapsedMs() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Reemplaza cada función de usuario por un stub con contador y salto indirecto
+    void instrument(llvm::Module &module, const std::vector<std::string> &userFunctions)
+    {
+        llvm::LLVMContext &ctx = module.getContext();
+        llvm::Type *i32Ty = llvm::Type::getInt32Ty(ctx);
+        llvm::Type *i64Ty = llvm::Type::getInt64Ty(ctx);
+        llvm::PointerType *ptrTy = llvm::PointerType::getUnqual(ctx);
+        llvm::FunctionCallee requestFunc = module.getOrInsertFunction(
+            "easyrust_tier_request", llvm::FunctionType::get(llvm::Type::getVoidTy(ctx), {i32Ty}, false));
+
+        for (const std::string &name : userFunctions)
+        {
+            llvm::Function *impl = module.getFunction(name);
+            if (!impl || impl->isDeclaration())
+                continue;
+            uint32_t id = functions.size();
+            functions.push_back({name});
+
+            impl->setName(name + ".t0");
+            llvm::Function *stub = llvm::Function::Create(
+                impl->getFunctionType(), llvm::Function::ExternalLinkage, name, module);
+            impl->replaceAllUsesWith(stub);
+
+            auto *counter = new llvm::GlobalVariable(
+                module, i64Ty, false, llvm::GlobalValue::ExternalLinkage,
+                llvm::ConstantInt::get(i64Ty, 0), name + ".count");
+            auto *slot = new llvm::GlobalVariable(
+                module, ptrTy, false, llvm::GlobalValue::ExternalLinkage, impl, name + ".ptr");
+            slot->setAlignment(llvm::Align(8));
+
+            llvm::BasicBlock *entry = llvm::BasicBlock::Create(ctx, "entry", stub);
+            llvm::BasicBlock *notify = llvm::BasicBlock::Create(ctx, "tier.notify", stub);
+            llvm::BasicBlock *dispatch = llvm::BasicBlock::Create(ctx, "tier.call", stub);
+            llvm::IRBuilder<> b(entry);
+
+            llvm::Value *count = b.CreateAdd(b.CreateLoad(i64Ty, counter), llvm::ConstantInt::get(i64Ty, 1), "count");
+            b.CreateStore(count, counter);
+            b.CreateCondBr(b.CreateICmpEQ(count, llvm::ConstantInt::get(i64Ty, threshold)), notify, dispatch);
+
+            b.SetInsertPoint(notify);
+            b.CreateCall(requestFunc, {llvm::ConstantInt::get(i32Ty, id)});
+            b.CreateBr(dispatch);
+
+            b.SetInsertPoint(dispatch);
+            llvm::LoadInst *target = b.CreateLoad(ptrTy, slot, "target");
+            target->setAtomic(llvm::AtomicOrdering::Monotonic);
+            target->setAlignment(llvm::Align(8));
+            std::vector<llvm::Value *> args;
+            for (auto &arg : stub->args())
+                args.push_back(&arg);
+            llvm::CallInst *call = b.CreateCall(impl->getFunctionType(), target, args);
+            call->setTailCall();
+            if (stub->getReturnType()->isVoidTy())
+                b.CreateRetVoid();
+            else
+                b.CreateRet(call);
+        }
+    }
+
+    // Construye un módulo con solo `<f>.t2` (el resto como declaraciones,
+    // resueltas a los stubs ya cargados), lo optimiza y actualiza `<f>.ptr`
+    bool promote(TieredFunction &fn, std::string &error)
+    {
+        auto ctx = std::make_unique<llvm::LLVMContext>();
+        llvm::MemoryBufferRef buffer(llvm::StringRef(bitcode.data(), bitcode.size()), "tier");
+        auto parsed = llvm::parseBitcodeFile(buffer, *ctx);
+        if (!parsed)
+        {
+            error = llvm::toString(parsed.takeError());
+            return false;
+        }
+        std::unique_ptr<llvm::Module> module = std::move(*parsed);
+
+        for (llvm::Function &f : *module)
+        {
+            if (f.isDeclaration())
+                continue;
+            if (f.getName() == fn.name)
+                f.setName(fn.name + ".t2");
+            else
+                f.deleteBody();
+        }
+        if (llvm::Function *mainDecl = module->getFunction("main"))
+            if (mainDecl->use_empty())
+                mainDecl->eraseFromParent();
+
+        llvm::orc::LLJIT &lljit = jit.getLLJIT();
+        module->setTargetTriple(lljit.getTargetTriple().str());
+        module->setDataLayout(lljit.getDataLayout());
+        EasyRustOptimizer optimizer(tierLevel, "", targetMachine.get());
+        if (!optimizer.run(*module, error))
+            return false;
+
+        if (llvm::Error err = lljit.addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(ctx))))
+        {
+            error = llvm::toString(std::move(err));
+            return false;
+        }
+        auto address = lljit.lookup(fn.name + ".t2");
+        if (!address)
+        {
+            error = llvm::toString(address.takeError());
+            return false;
+        }
+        fn.slot->store(address->toPtr<void *>(), std::memory_order_release);
+        fn.promotedAt = elapsedMs();
+        return true;
+    }
+
+    void workerLoop()
+    {
+        while (true)
+        {
+            uint32_t id;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCond.wait(lock, [&]
+                               { return stopping || !queue.empty(); });
+                if (stopping)
+                    return;
+                id = queue.front();
+                queue.pop_front();
+            }
+            std::string error;
+            if (!promote(functions[id], error))
+                std::cerr << "Error: No se pudo promover " << functions[id].name << ": " << error << "\n";
+        }
+    }
+
+public:
+    EasyRustTieredJIT(llvm::OptimizationLevel tierLevel, uint64_t threshold,
+                      std::chrono::steady_clock::time_point start)
+        : tierLevel(tierLevel), threshold(threshold), start(start) {}
+
+    ~EasyRustTieredJIT()
+    {
+        stop();
+    }
+
+    bool init(std::string &error)
+    {
+        if (!jit.init(llvm::OptimizationLevel::O0, "", error))
+            return false;
+
+        auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+        if (!jtmb)
+        {
+            error = llvm::toString(jtmb.takeError());
+            return false;
+        }
+        auto tm = jtmb->createTargetMachine();
+        if (!tm)
+        {
+            error = llvm::toString(tm.takeError());
+            return false;
+        }
+        targetMachine = std::move(*tm);
+
+        // Exponer el gancho del runtime al código JIT
+        llvm::orc::LLJIT &lljit = jit.getLLJIT();
+        llvm::orc::SymbolMap symbols;
+        symbols[lljit.mangleAndIntern("easyrust_tier_request")] = llvm::orc::ExecutorSymbolDef(
+            llvm::orc::ExecutorAddr::fromPtr(&EasyRustTieredJIT::tierRequest),
+            llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+        if (llvm::Error err = lljit.getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(symbols))))
+        {
+            error = llvm::toString(std::move(err));
+            return false;
+        }
+        active() = this;
+        return true;
+    }
+
+    // Guarda el módulo original, lo instrumenta y lo agrega al JIT a -O0
+    bool addModule(llvm::orc::ThreadSafeModule tsm, const std::vector<std::string> &userFunctions,
+                   std::string &error)
+    {
+        tsm.withModuleDo([&](llvm::Module &module)
+                         {
+            llvm::raw_svector_ostream os(bitcode);
+            llvm::WriteBitcodeToFile(module, os);
+            instrument(module, userFunctions); });
+
+        if (!jit.addModule(std::move(tsm), error))
+            return false;
+
+        // Direcciones de contadores y punteros indirectos para el hilo de fondo
+        llvm::orc::LLJIT &lljit = jit.getLLJIT();
+        for (TieredFunction &fn : functions)
+        {
+            auto counter = lljit.lookup(fn.name + ".count");
+            if (!counter)
+            {
+                error = llvm::toString(counter.takeError());
+                return false;
+            }
+            auto slot = lljit.lookup(fn.name + ".ptr");
+            if (!slot)
+            {
+                error = llvm::toString(slot.takeError());
+                return false;
+            }
+            fn.counter = counter->toPtr<uint64_t *>();
+            fn.slot = slot->toPtr<std::atomic<void *> *>();
+        }
+
+        worker = std::thread(&EasyRustTieredJIT::workerLoop, this);
+        return true;
+    }
+
+    bool lookupMain(int (*&mainPtr)(), std::string &error)
+    {
+        return jit.lookupMain(mainPtr, error);
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueCond.notify_one();
+        if (worker.joinable())
+            worker.join();
+        if (active() == this)
+            active() = nullptr;
+    }
+
+    // Resumen de funciones promovidas y en qué momento
+    void printSummary(std::ostream &os) const
+    {
+        os << "Resumen de compilación por niveles (umbral " << threshold << " llamadas):\n";
+        for (const TieredFunction &fn : functions)
+        {
+            os << "  " << fn.name << ": " << (fn.counter ? *fn.counter : 0) << " llamadas";
+            if (fn.promotedAt >= 0)
+                os << ", solicitada a los " << fn.requestedAt << " ms, promovida a los "
+                   << fn.promotedAt << " ms\n";
+            else if (fn.requestedAt >= 0)
+                os << ", solicitada a los " << fn.requestedAt << " ms, no promovida\n";
+            else
+                os << ", nivel 0\n";
+        }
+    }
+};
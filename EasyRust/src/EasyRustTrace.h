@@ -0,0 +1,244 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+
+// Trazado estructurado del compilador (reemplaza a los mensajes "Debug:").
+//
+//  - Categorías: parse, codegen, types, calls (--trace=codegen,types o --trace=all)
+//  - Nivel: 1 = entrada a cada visitante, 2 = detalle dentro de los visitantes (--trace-level=N)
+//  - --trace-chrome=<archivo>: eventos en formato Chrome trace (chrome://tracing, Perfetto)
+//
+// Con EASYRUST_NO_TRACE (por defecto en builds Release) las macros no generan
+// código. Si no, cuando el trazado está apagado cada punto cuesta una carga atómica.
+enum class TraceCategory : unsigned
+{
+    Parse = 1u << 0,
+    Codegen = 1u << 1,
+    Types = 1u << 2,
+    Calls = 1u << 3,
+    All = 0xFu
+};
+
+class EasyRustTrace
+{
+private:
+    struct Event
+    {
+        std::string name;
+        TraceCategory category;
+        uint64_t startUs;
+        uint64_t durationUs;
+        uint64_t thread;
+    };
+
+    static std::atomic<unsigned> &categoryMask()
+    {
+        static std::atomic<unsigned> mask{0};
+        return mask;
+    }
+
+    static std::atomic<int> &verbosity()
+    {
+        static std::atomic<int> level{1};
+        return level;
+    }
+
+    static std::atomic<bool> &chromeEnabled()
+    {
+        static std::atomic<bool> enabled{false};
+        return enabled;
+    }
+
+    static std::mutex &eventMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::vector<Event> &events()
+    {
+        static std::vector<Event> list;
+        return list;
+    }
+
+    static uint64_t nowUs()
+    {
+        static const auto origin = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    static uint64_t threadId()
+    {
+        return std::hash<std::thread::id>{}(std::this_thread::get_id()) & 0xFFFF;
+    }
+
+public:
+    static const char *categoryName(TraceCategory category)
+    {
+        switch (category)
+        {
+        case TraceCategory::Parse:
+            return "parse";
+        case TraceCategory::Codegen:
+            return "codegen";
+        case TraceCategory::Types:
+            return "types";
+        case TraceCategory::Calls:
+            return "calls";
+        default:
+            return "all";
+        }
+    }
+
+    // "codegen,types" o "all"; retorna false si alguna categoría no existe
+    static bool parseCategories(const std::string &list, unsigned &mask)
+    {
+        mask = 0;
+        size_t start = 0;
+        while (start <= list.size())
+        {
+            size_t end = list.find(',', start);
+            std::string name = list.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            if (name == "all")
+                mask |= static_cast<unsigned>(TraceCategory::All);
+            else if (name == "parse")
+                mask |= static_cast<unsigned>(TraceCategory::Parse);
+            else if (name == "codegen")
+                mask |= static_cast<unsigned>(TraceCategory::Codegen);
+            else if (name == "types")
+                mask |= static_cast<unsigned>(TraceCategory::Types);
+            else if (name == "calls")
+                mask |= static_cast<unsigned>(TraceCategory::Calls);
+            else if (!name.empty())
+                return false;
+            if (end == std::string::npos)
+                break;
+            start = end + 1;
+        }
+        return true;
+    }
+
+    // Se llama antes de registrar con atexit la escritura de la traza: los
+    // estáticos construidos después de registrarla se destruirían antes
+    static void configure(unsigned mask, int level, bool chrome)
+    {
+        categoryMask() = mask;
+        verbosity() = level;
+        eventMutex();
+        events();
+        nowUs();
+        chromeEnabled() = chrome;
+    }
+
+    static bool enabled(TraceCategory category, int level)
+    {
+        return (categoryMask().load(std::memory_order_relaxed) & static_cast<unsigned>(category)) &&
+               level <= verbosity().load(std::memory_order_relaxed);
+    }
+
+    static bool recording()
+    {
+        return chromeEnabled().load(std::memory_order_relaxed);
+    }
+
+    static void log(TraceCategory category, const std::string &message)
+    {
+        llvm::errs() << "[" << categoryName(category) << "] " << message << "\n";
+    }
+
+    static void record(const char *name, TraceCategory category, uint64_t startUs, uint64_t endUs)
+    {
+        std::lock_guard<std::mutex> lock(eventMutex());
+        events().push_back({name, category, startUs, endUs - startUs, threadId()});
+    }
+
+    // Escribe los eventos acumulados en formato Chrome trace
+    static bool writeChromeTrace(const std::string &filename)
+    {
+        llvm::json::Array traceEvents;
+        {
+            std::lock_guard<std::mutex> lock(eventMutex());
+            for (const Event &event : events())
+                traceEvents.push_back(llvm::json::Object{
+                    {"name", event.name},
+                    {"cat", categoryName(event.category)},
+                    {"ph", "X"},
+                    {"ts", static_cast<int64_t>(event.startUs)},
+                    {"dur", static_cast<int64_t>(event.durationUs)},
+                    {"pid", 1},
+                    {"tid", static_cast<int64_t>(event.thread)}});
+        }
+        std::error_code ec;
+        llvm::raw_fd_ostream out(filename, ec);
+        if (ec)
+            return false;
+        out << llvm::json::Value(llvm::json::Object{{"traceEvents", std::move(traceEvents)}});
+        return true;
+    }
+
+    // Marca la duración de un visitante o fase: lo registra para Chrome trace
+    // y, a nivel 1, imprime la entrada
+    class Scope
+    {
+    private:
+        const char *name;
+        TraceCategory category;
+        uint64_t startUs = 0;
+        bool active;
+
+    public:
+        Scope(TraceCategory category, const char *name)
+            : name(name), category(category), active(recording())
+        {
+            if (enabled(category, 1))
+                log(category, std::string("Entrando a ") + name);
+            if (active)
+                startUs = nowUs();
+        }
+
+        ~Scope()
+        {
+            if (active)
+                record(name, category, startUs, nowUs());
+        }
+    };
+};
+
+#ifndef EASYRUST_NO_TRACE
+#define ER_TRACE_CONCAT_(a, b) a##b
+#define ER_TRACE_CONCAT(a, b) ER_TRACE_CONCAT_(a, b)
+// Mensaje de detalle: el operando se evalúa solo si la categoría y el nivel están activos
+#define ER_TRACE(category, level, message)                                  \
+    do                                                                      \
+    {                                                                       \
+        if (EasyRustTrace::enabled(TraceCategory::category, level))         \
+        {                                                                   \
+            std::string er_trace_text;                                      \
+            llvm::raw_string_ostream er_trace_os(er_trace_text);            \
+            er_trace_os << message;                                         \
+            EasyRustTrace::log(TraceCategory::category, er_trace_os.str()); \
+        }                                                                   \
+    } while (0)
+#define ER_TRACE_SCOPE(category, name) \
+    EasyRustTrace::Scope ER_TRACE_CONCAT(er_trace_scope_, __LINE__)(TraceCategory::category, name)
+#else
+#define ER_TRACE(category, level, message) \
+    do                                     \
+    {                                      \
+    } while (0)
+#define ER_TRACE_SCOPE(category, name) \
+    do                                 \
+    {                                  \
+    } while (0)
+#endif
@@ -1,86 +1,258 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
-#include <iostream>
 #include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "EasyRustLexer.h"
 #include "EasyRustParser.h"
 #include "EasyRustDriver.h"
+#include "EasyRustBackend.h"
+#include "EasyRustCache.h"
+#include "EasyRustCompiler.h"
+#include "EasyRustJIT.h"
+#include "EasyRustTieredJIT.h"
+#include "EasyRustOptimizer.h"
+#include "EasyRustOptions.h"
+#include "EasyRustProgram.h"
+#include "EasyRustServer.h"
+#include "EasyRustTrace.h"
 
 using namespace antlr4;
 using namespace std;
 
-int main(int argc, const char *argv[]) {
+// --trace-chrome: se escribe al salir para cubrir todos los modos (lote, --run, --print-ir)
+static string traceChromeFile;
 
-    ifstream ifile;
+static void writeChromeTrace() {
+    if (!EasyRustTrace::writeChromeTrace(traceChromeFile))
+        cerr << "Error: No se pudo escribir la traza " << traceChromeFile << endl;
+}
 
-    if (argc > 1) {
-        ifile.open(argv[1]);
-        if (!ifile.is_open()) {
-            cerr << "Error: No se pudo abrir el archivo " << argv[1] << endl;
-            return EXIT_FAILURE;
-        }
+// Modo --run: compila con LLJIT y llama a main en el mismo proceso
+static int runWithJIT(llvm::orc::ThreadSafeModule module, const EasyRustOptions &options,
+                      chrono::steady_clock::time_point start) {
+    string error;
+    EasyRustJIT jit;
+    if (!jit.init(options.optLevel, options.passPipeline, error) ||
+        !jit.addModule(std::move(module), error)) {
+        cerr << "Error: JIT: " << error << endl;
+        return EXIT_FAILURE;
     }
 
-    istream &stream = argc > 1 ? ifile : cin;
-    
-    ANTLRInputStream input(stream);
-    EasyRustLexer lexer(&input);
-    CommonTokenStream tokens(&lexer);
-    EasyRustParser parser(&tokens);
-
-    tree::ParseTree *tree = parser.program();
-    EasyRustDriver *driver = new EasyRustDriver();
-    driver->visit(tree);
-
-    // Obtener el código IR generado
-    string ir_code = driver->getIR();
-
-    // Definir nombres de archivos
-    string input_filename = argc > 1 ? string(argv[1]) : "stdin";
-    size_t last_dot = input_filename.find_last_of('.');
-    string base_name = (last_dot == string::npos) ? input_filename : input_filename.substr(0, last_dot);
-    string ir_filename = base_name + ".ll";
-    string optimized_ir = base_name + "_opt.ll";
-    string asm_filename = base_name + ".s";
-    string exec_filename = base_name + ".out";
-
-    // Guardar el IR en un archivo
-    ofstream ir_file(ir_filename);
-    if (!ir_file.is_open()) {
-        cerr << "Error: No se pudo crear el archivo IR " << ir_filename << endl;
+    int (*mainPtr)() = nullptr;
+    if (!jit.lookupMain(mainPtr, error)) {
+        cerr << "Error: No se encontró main en el JIT: " << error << endl;
         return EXIT_FAILURE;
     }
-    ir_file << ir_code;
-    ir_file.close();
-    cout << "IR guardado en " << ir_filename << endl;
-
-    // Optimizar el IR (Nivel 1)
-    string cmd_opt = "opt -S -O1 " + ir_filename + " -o " + optimized_ir;
-    cout << "Ejecutando optimización: " << cmd_opt << endl;
-    if (system(cmd_opt.c_str()) != 0) {
-        cerr << "Error: Optimización fallida." << endl;
+
+    // Tiempo desde el inicio del compilador hasta la primera instrucción del programa
+    auto elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start);
+    cerr << "Tiempo hasta la primera instrucción: " << elapsed.count() << " ms" << endl;
+
+    int result = mainPtr();
+    fflush(stdout);
+    return result;
+}
+
+// Modo --tiered: todo a -O0 con contadores; las funciones calientes se
+// recompilan en segundo plano y se reemplazan mediante un stub indirecto
+static int runTiered(EasyRustDriver *driver, const EasyRustOptions &options,
+                     chrono::steady_clock::time_point start) {
+    string error;
+    EasyRustTieredJIT jit(options.tierLevel, options.tierThreshold, start);
+    vector<string> userFunctions = driver->getUserFunctions();
+    if (!jit.init(error) || !jit.addModule(driver->takeModule(), userFunctions, error)) {
+        cerr << "Error: JIT por niveles: " << error << endl;
         return EXIT_FAILURE;
     }
-    cout << "IR optimizado guardado en " << optimized_ir << endl;
 
-    //  Compilar el IR optimizado a assembler
-    string cmd_llc = "llc " + optimized_ir + " -o " + asm_filename;
-    cout << "Compilando a assembler: " << cmd_llc << endl;
-    if (system(cmd_llc.c_str()) != 0) {
-        cerr << "Error: Compilación a assembler fallida." << endl;
+    int (*mainPtr)() = nullptr;
+    if (!jit.lookupMain(mainPtr, error)) {
+        cerr << "Error: No se encontró main en el JIT: " << error << endl;
         return EXIT_FAILURE;
     }
-    cout << "Assembler guardado en " << asm_filename << endl;
 
-    //Generar el ejecutable final usando clang
-    string cmd_clang = "clang " + asm_filename + " -o " + exec_filename + " -no-pie";
-    cout << "Generando ejecutable: " << cmd_clang << endl;
-    if (system(cmd_clang.c_str()) != 0) {
-        cerr << "Error: Generación del ejecutable fallida." << endl;
+    auto elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start);
+    cerr << "Tiempo hasta la primera instrucción: " << elapsed.count() << " ms" << endl;
+
+    int result = mainPtr();
+    fflush(stdout);
+    jit.stop();
+    jit.printSummary(cerr);
+    return result;
+}
+
+int main(int argc, const char *argv[]) {
+
+    auto start = chrono::steady_clock::now();
+
+    EasyRustOptions options;
+    if (!options.parse(argc, argv)) {
+        EasyRustOptions::printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // configure construye los eventos de la traza antes de registrar writeChromeTrace
+    EasyRustTrace::configure(options.traceMask, options.traceLevel, !options.traceChrome.empty());
+    if (!options.traceChrome.empty()) {
+        traceChromeFile = options.traceChrome;
+        atexit(writeChromeTrace);
+    }
+
+    string error;
+    string socketPath = options.socketPath.empty() ? EasyRustProtocol::defaultSocketPath() : options.socketPath;
+    unsigned jobs = options.jobs ? options.jobs : max(1u, thread::hardware_concurrency());
+
+    if (options.server) {
+        EasyRustServer server(socketPath, options);
+        server.serve(jobs, error);
+        cerr << "Error: " << error << endl;
         return EXIT_FAILURE;
     }
-    cout << "Ejecutable generado: " << exec_filename << endl;
 
-    return EXIT_SUCCESS;
+    vector<string> inputs;
+    if (!EasyRustCompiler::expandInputs(options.inputFiles, inputs, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+    if (inputs.empty())
+        inputs.push_back(""); // stdin
+
+    if (options.run) {
+        if (inputs.size() > 1) {
+            cerr << "Error: --run acepta un solo archivo de entrada" << endl;
+            return EXIT_FAILURE;
+        }
+        string source;
+        if (!EasyRustCompiler::readSource(inputs[0], source)) {
+            cerr << "Error: No se pudo abrir el archivo " << inputs[0] << endl;
+            return EXIT_FAILURE;
+        }
+        // Con import se enlazan todos los módulos (LTO completo) antes del JIT
+        if (!EasyRustProgram::scanImports(source).empty()) {
+            if (options.tiered) {
+                cerr << "Error: --tiered no admite programas con import" << endl;
+                return EXIT_FAILURE;
+            }
+            EasyRustProgram program;
+            ostringstream log;
+            llvm::orc::ThreadSafeModule linked;
+            if (program.load(inputs[0], source, error) &&
+                EasyRustCompiler::generateUnits(program, options, nullptr, log, error))
+                linked = EasyRustCompiler::linkProgram(program, options, error);
+            if (!linked) {
+                cerr << "Error: " << error << endl;
+                return EXIT_FAILURE;
+            }
+            return runWithJIT(std::move(linked), options, start);
+        }
+        EasyRustDriver *driver = EasyRustCompiler::generateModule(source, options).release();
+        if (!driver) {
+            cerr << "Error: " << EasyRustCompiler::CodegenFailed << endl;
+            return EXIT_FAILURE;
+        }
+        if (options.tiered)
+            return runTiered(driver, options, start);
+        return runWithJIT(driver->takeModule(), options, start);
+    }
+
+    // Si el demonio está activo se le reenvía la compilación (el IR con
+    // --emit-llvm se escribe localmente, --stats=json y --trace miden este
+    // proceso y los perfiles de PGO son archivos locales, así que esos casos no
+    // se reenvían; tampoco --incremental, cuyo estado vive junto al fuente, ni
+    // --partitions, que genera varios objetos; con --codegen-threads se compila
+    // aquí para usar los hilos pedidos)
+    bool tracing = options.traceMask || !options.traceChrome.empty();
+    bool profiling = options.profileGenerate || !options.profileUse.empty();
+    bool useServer = !options.noServer && !options.emitLLVM && !options.statsJSON && !tracing && !profiling &&
+                     !options.incremental && options.partitions <= 1 && options.codegenThreads == 1 &&
+                     EasyRustClient::available(socketPath);
+
+    // --print-ir: IR optimizado en stdout (pensado para integraciones con editores)
+    if (options.printIR) {
+        EasyRustBackend backend;
+        for (const string &input : inputs) {
+            string source, ir, diagnostics;
+            if (!EasyRustCompiler::readSource(input, source)) {
+                cerr << "Error: No se pudo abrir el archivo " << input << endl;
+                return EXIT_FAILURE;
+            }
+            bool ok = false;
+            double serverMs = 0;
+            if (useServer && EasyRustClient::request(socketPath, "ir", options, source, ok, diagnostics, ir, serverMs)) {
+                if (!ok) {
+                    cerr << diagnostics;
+                    return EXIT_FAILURE;
+                }
+            } else if ((!backend.getTargetMachine() && !backend.init(options.optLevel, error)) ||
+                       !EasyRustCompiler::compileToIR(source, options, backend, ir, error)) {
+                cerr << "Error: " << error << endl;
+                return EXIT_FAILURE;
+            }
+            cout << ir;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // Costos de arranque compartidos por todo el lote
+    unique_ptr<EasyRustCache> cache;
+    if (!useServer)
+        EasyRustBackend::initializeTargets();
+    if (!useServer && options.useCache)
+        cache = make_unique<EasyRustCache>(
+            options.cacheDir.empty() ? EasyRustCache::defaultDirectory() : options.cacheDir,
+            options.cacheMaxBytes);
+
+    // Cada hilo toma el siguiente archivo; cada compilación usa su propio
+    // EasyRustDriver/LLVMContext y su propio TargetMachine
+    vector<EasyRustCompiler::FileResult> results(inputs.size());
+    jobs = min<size_t>(jobs, inputs.size());
+    atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < inputs.size(); i = next++)
+            results[i] = useServer ? EasyRustClient::compileFile(socketPath, inputs[i], options)
+                                   : EasyRustCompiler::compileFile(inputs[i], options, cache.get());
+    };
+    if (jobs <= 1) {
+        worker();
+    } else {
+        vector<thread> pool;
+        for (unsigned t = 0; t < jobs; t++)
+            pool.emplace_back(worker);
+        for (auto &t : pool)
+            t.join();
+    }
+
+    // Imprimir los resultados en el orden de entrada
+    ofstream statsFile;
+    if (!options.statsFile.empty())
+        statsFile.open(options.statsFile, ios::app);
+    ostream &statsOut = statsFile.is_open() ? statsFile : cerr;
+    int failures = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (inputs.size() > 1)
+            cout << "== " << inputs[i] << endl;
+        cout << results[i].log;
+        cerr << results[i].errors;
+        if (!results[i].stats.empty())
+            statsOut << results[i].stats << "\n";
+        if (!results[i].ok)
+            failures++;
+    }
+    if (inputs.size() > 1)
+        cout << "Compilados " << inputs.size() - failures << " de " << inputs.size()
+             << " archivos con " << jobs << " hilos" << endl;
+
+    if (cache && options.cacheStats)
+        cache->printStats(cerr);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
 }